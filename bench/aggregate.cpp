@@ -0,0 +1,63 @@
+#include "aggregate.hpp"
+#include "ccapi.hpp"
+#include "measure.hpp"
+#include "stats.hpp"
+
+#include <random>
+#include <thread>
+
+#include <fmt/format.h>
+
+template<typename Body>
+void
+report(const char *name, std::size_t count, Body body) {
+    auto [checksum, elapsed] = measure::once(body);
+    fmt::print("{:<28} {:>8.1f} ms  {:>7.1f} Mvotes/s  (checksum {})\n", name, elapsed, count / elapsed / 1000, checksum);
+}
+
+int main(int argc, char **argv) {
+    std::size_t count = argc > 1 ? std::max(1, atoi(argv[1])) : 5000000;
+    std::size_t users = argc > 2 ? std::max(1, atoi(argv[2])) : 20000;
+
+    // skewed like a real server, a few players cast most of the votes
+    std::mt19937_64 random(1);
+    std::uniform_real_distribution<double> uniform;
+    ccapi::VoteColumns votes;
+    votes.reserve(count);
+    std::int64_t date = 1500000000;
+    for (std::size_t index = 0; index < count; ++index) {
+        auto skewed = uniform(random);
+        auto user = static_cast<std::size_t>(skewed * skewed * skewed * static_cast<double>(users));
+        date += static_cast<std::int64_t>(uniform(random) * 60);
+        votes.push_back(fmt::format("player{}", user), date, uniform(random) < 0.8);
+    }
+    const auto middle = votes[count / 2].date;
+    fmt::print("{} votes of {} users\n", count, votes.table().size());
+
+    report("single thread", count, [&] {
+        return ccapi::countVotes(votes.view(), INT64_MIN, INT64_MAX, 1).top(10).front().count;
+    });
+    report("single thread, half", count, [&] {
+        return ccapi::countVotes(votes.view(), middle, INT64_MAX, 1).top(10).front().count;
+    });
+    report(fmt::format("{} threads", std::thread::hardware_concurrency()).c_str(), count, [&] {
+        return ccapi::countVotes(votes.view()).top(10).front().count;
+    });
+    report("all of top-k", count, [&] {
+        auto counter = ccapi::countVotes(votes.view());
+        return ccapi::topVoters(counter, votes.table(), counter.size()).size();
+    });
+    report("histogram, single thread", count, [&] {
+        return ccapi::voteHistogram(votes.view(), INT64_MIN, INT64_MAX, 1).delivered;
+    });
+    report("histogram, half", count, [&] {
+        return ccapi::voteHistogram(votes.view(), middle, INT64_MAX, 1).delivered;
+    });
+    report(fmt::format("histogram, {} threads", std::thread::hardware_concurrency()).c_str(), count, [&] {
+        return ccapi::voteHistogram(votes.view()).delivered;
+    });
+    report("streaks", count, [&] {
+        return ccapi::voteStreaks(votes.view()).front().longest;
+    });
+    return 0;
+}
@@ -0,0 +1,47 @@
+#include "async.hpp"
+#include "measure.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <fmt/format.h>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print("Usage: bench-async <slug> [requests] [connections]\n");
+        return 0;
+    }
+    std::string slug { argv[1] };
+    int requests = argc > 2 ? std::max(1, atoi(argv[2])) : 1000;
+    int connections = argc > 3 ? std::max(1, atoi(argv[3])) : 16;
+
+    try {
+        // a session without the response cache, which would answer all but the first request
+        ccapi::Client client;
+        ccapi::AsyncClient async(client, connections);
+
+        // every request is outstanding at once, served by one event-loop thread
+        auto start = measure::Clock::now();
+        std::vector<ccapi::Future<ccapi::ServerInfo>> futures;
+        futures.reserve(requests);
+        for (int index = 0; index < requests; ++index)
+            futures.push_back(async.serverInfo(slug));
+        auto submitted = measure::since(start);
+
+        std::size_t failed = 0;
+        for (auto &future : futures) {
+            try {
+                future.get();
+            } catch (std::exception &) {
+                ++failed;
+            }
+        }
+        auto elapsed = measure::since(start);
+        fmt::print("requests: {}  connections: {}  failed: {}  submitted in: {:.2f} ms  total: {:.2f} ms  {:.1f} requests/s\n",
+                   requests, connections, failed, submitted, elapsed, requests / elapsed * 1000);
+    } catch (std::exception &ex) {
+        fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,41 @@
+#include "ccapi.hpp"
+#include "measure.hpp"
+
+#include <algorithm>
+#include <vector>
+
+#include <fmt/format.h>
+
+void
+report(const char *name, const std::vector<double> &samples) {
+    fmt::print("{:<6} calls: {:>4}  mean: {:>8.2f} ms  p50: {:>8.2f} ms  min: {:>8.2f} ms  max: {:>8.2f} ms\n",
+               name, samples.size(), measure::mean(samples), measure::median(samples), samples.front(), samples.back());
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print("Usage: bench-connection <slug> [iterations]\n");
+        return 0;
+    }
+    std::string slug { argv[1] };
+    std::size_t iterations = argc > 2 ? std::max(1, atoi(argv[2])) : 20;
+
+    try {
+        // every call gets its own session: DNS, TCP and TLS handshake each time
+        report("cold", measure::times(iterations, [&] {
+            ccapi::Client client;
+            ccapi::serverInfo(slug, client);
+        }));
+
+        // one session, primed before measuring
+        ccapi::Client client;
+        ccapi::serverInfo(slug, client);
+        report("warm", measure::times(iterations, [&] {
+            ccapi::serverInfo(slug, client);
+        }));
+    } catch (std::exception &ex) {
+        fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,206 @@
+#include "decode.hpp"
+#include "fixtures.hpp"
+#include "measure.hpp"
+#include "render.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <new>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace api = ccapi::api;
+using measure::sink;
+
+// every allocation of the process, so that a decode can report how many it needed
+static std::atomic<std::size_t> allocations{0};
+
+void *operator new(std::size_t size) {
+    ++allocations;
+    if (auto pointer = std::malloc(size ? size : 1))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+// the array forms are replaced as well, so that every new is paired with a delete of the same family, and none of
+// the deletes is inlined, where the compiler would see free() called on memory of operator new
+void *operator new[](std::size_t size) { return operator new(size); }
+[[gnu::noinline]] void operator delete(void *pointer) noexcept { std::free(pointer); }
+[[gnu::noinline]] void operator delete(void *pointer, std::size_t) noexcept { std::free(pointer); }
+[[gnu::noinline]] void operator delete[](void *pointer) noexcept { std::free(pointer); }
+[[gnu::noinline]] void operator delete[](void *pointer, std::size_t) noexcept { std::free(pointer); }
+
+// received bodies reach the decoders in chunks of this size, as curl hands them over
+static constexpr std::size_t CHUNK = 16 * 1024;
+
+struct Measurement {
+    double ms;                // median time of a call
+    std::size_t allocations;  // made by the last call
+};
+
+/**
+ * @returns Median time of a call, repeated for at least a few hundred milliseconds
+ */
+template<typename Call>
+Measurement
+timed(Call call) {
+    std::size_t allocated = 0;
+    auto samples = measure::repeat([&] {
+        auto before = allocations.load();
+        call();
+        allocated = allocations.load() - before;
+    });
+    return {measure::median(samples), allocated};
+}
+
+void
+report(const char *name, std::size_t rows, std::size_t bytes, Measurement measurement) {
+    auto ms = measurement.ms;
+    fmt::print("{:<28} rows: {:>9}  size: {:>9.2f} MB  median: {:>9.3f} ms  {:>8.1f} MB/s  {:>7.2f} M rows/s  allocations: {:>7}\n",
+               name, rows, bytes / 1e6, ms, bytes / 1e3 / ms, rows / 1e3 / ms, measurement.allocations);
+}
+
+/**
+ * @param fed Receives the bytes fed before the decoder stopped, in whole chunks, the rest of the body would not be
+ *            transferred
+ */
+template<typename T>
+T
+decode_streamed(std::string_view body, ccapi::detail::StreamDecoder<T> decoder, std::size_t *fed = nullptr) {
+    ccapi::detail::JsonStream stream(*decoder.handler);
+    std::size_t offset = 0;
+    for (; offset < body.size() && !stream.stopped(); offset += CHUNK)
+        stream.feed(body.data() + offset, std::min(CHUNK, body.size() - offset));
+    stream.finish();
+    if (fed)
+        *fed = std::min(offset, body.size());
+    return decoder.result();
+}
+
+void
+bench_listings(const std::string &votes, const std::string &voters, const std::string &player, const std::string &month,
+               std::size_t rows, std::FILE *null) {
+    constexpr auto ALL = std::numeric_limits<std::size_t>::max();
+    report("server votes", rows, votes.size(), timed([&] {
+        sink = ccapi::detail::decode(api::ServerVotes{"bench"}, votes).votes.size();
+    }));
+    report("server votes newest first", rows, votes.size(), timed([&] {
+        sink = ccapi::detail::decode(api::ServerVotesMonth{"bench", 1, 2021}, votes).votes.size();
+    }));
+    report("server votes streamed", rows, votes.size(), timed([&] {
+        sink = decode_streamed(votes, ccapi::detail::stream_decoder(api::ServerVotes{"bench"}, ALL)).votes.size();
+    }));
+    // limited decoders are measured against the part of the body they read
+    std::size_t fed = 0;
+    decode_streamed(votes, ccapi::detail::stream_decoder(api::ServerVotes{"bench"}, 100), &fed);
+    report("server votes limit 100", std::min<std::size_t>(rows, 100), fed, timed([&] {
+        sink = decode_streamed(votes, ccapi::detail::stream_decoder(api::ServerVotes{"bench"}, 100)).votes.size();
+    }));
+
+    auto voter_rows = ccapi::detail::decode(api::TopVoters{"bench"}, voters).size();
+    report("top voters", voter_rows, voters.size(), timed([&] {
+        sink = ccapi::detail::decode(api::TopVoters{"bench"}, voters).size();
+    }));
+    decode_streamed(voters, ccapi::detail::stream_decoder(api::TopVoters{"bench"}, 100), &fed);
+    report("top voters limit 100", std::min<std::size_t>(voter_rows, 100), fed, timed([&] {
+        sink = decode_streamed(voters, ccapi::detail::stream_decoder(api::TopVoters{"bench"}, 100)).size();
+    }));
+
+    auto player_rows = ccapi::detail::decode(api::UserVotes{"player", "bench"}, player).votes.size();
+    report("player votes", player_rows, player.size(), timed([&] {
+        sink = ccapi::detail::decode(api::UserVotes{"player", "bench"}, player).votes.size();
+    }));
+    auto month_rows = ccapi::detail::decode(api::UserVotesMonth{"player", "bench", 1, 2021}, month).votes.size();
+    report("player votes of a month", month_rows, month.size(), timed([&] {
+        sink = ccapi::detail::decode(api::UserVotesMonth{"player", "bench", 1, 2021}, month).votes.size();
+    }));
+
+    // rendering of the whole listing, as cc-cli votes --limit all writes it to a pipe
+    auto decoded = ccapi::detail::decode(api::ServerVotes{"bench"}, votes);
+    for (auto [name, format] : {std::pair("render text", Format::text), std::pair("render json", Format::json),
+                                std::pair("render ndjson", Format::ndjson), std::pair("render csv", Format::csv)}) {
+        auto render = [&, format = format](std::FILE *file) {
+            Output out(file, format);
+            out.begin("bench", 1);
+            renderServerVotes(out, "bench", decoded, decoded.votes.size());
+        };
+        // the size is taken once from a real file, the null device does not keep a position
+        std::size_t written = 0;
+        if (auto file = std::tmpfile()) {
+            render(file);
+            written = static_cast<std::size_t>(std::max(0L, std::ftell(file)));
+            std::fclose(file);
+        }
+        report(name, rows, written, timed([&] { render(null); }));
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (std::string_view(argv[1]) == "-h" || std::string_view(argv[1]) == "--help")) {
+        fmt::print("Usage: bench-decode [votes] [users]\n"
+                   "       bench-decode --fixtures <directory>\n");
+        return 0;
+    }
+
+    std::FILE *null = std::fopen(
+#ifdef _WIN32
+            "NUL",
+#else
+            "/dev/null",
+#endif
+            "wb");
+    if (!null) {
+        fmt::print("Failed to open the null device\n");
+        return 1;
+    }
+
+    try {
+        if (argc > 2 && std::string_view(argv[1]) == "--fixtures") {
+            std::filesystem::path directory { argv[2] };
+            auto load = [&](const std::string &name) {
+                auto body = fixtures::recorded(directory, name);
+                if (!body)
+                    throw std::runtime_error(fmt::format("Missing fixture {}.json in {}", name, directory.string()));
+                return *body;
+            };
+            auto server = load("server"), next = load("next-vote"), votes = load("votes");
+            fmt::print("recorded fixtures of {}\n", directory.string());
+            report("server info", 1, server.size(), timed([&] { sink = ccapi::detail::decode(api::ServerInfo{"bench"}, server).votes; }));
+            report("next vote", 1, next.size(), timed([&] { sink = ccapi::detail::decode(api::NextVote{"player", "bench"}, next).next_vote; }));
+            bench_listings(votes, load("voters"), load("player"), load("player-month"),
+                           ccapi::detail::decode(api::ServerVotes{"bench"}, votes).votes.size(), null);
+            std::fclose(null);
+            return 0;
+        }
+
+        std::size_t largest = argc > 1 ? std::max(1L, atol(argv[1])) : 1000000;
+        std::size_t users = argc > 2 ? std::max(1L, atol(argv[2])) : 20000;
+
+        auto server = fixtures::serverInfo("bench");
+        auto next = fixtures::nextVote("player");
+        report("server info", 1, server.size(), timed([&] { sink = ccapi::detail::decode(api::ServerInfo{"bench"}, server).votes; }));
+        report("next vote", 1, next.size(), timed([&] { sink = ccapi::detail::decode(api::NextVote{"player", "bench"}, next).next_vote; }));
+
+        // from a quiet month to the whole history of a busy server
+        std::vector<std::size_t> sizes;
+        for (std::size_t size = 1000; size < largest; size *= 10)
+            sizes.push_back(size);
+        sizes.push_back(largest);
+        for (auto size : sizes) {
+            fmt::print("\n{} votes, {} users\n", size, std::min(users, size));
+            bench_listings(fixtures::serverVotes(size, std::min(users, size)),
+                           fixtures::topVoters(std::max<std::size_t>(1, std::min(users, size))),
+                           fixtures::playerVotes("player", std::max<std::size_t>(1, size / 100)),
+                           fixtures::playerVotes("player", std::max<std::size_t>(1, size / 1000), true), size, null);
+        }
+    } catch (std::exception &ex) {
+        fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+        return 1;
+    }
+    std::fclose(null);
+    return 0;
+}
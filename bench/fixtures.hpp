@@ -0,0 +1,118 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <optional>
+#include <string>
+
+#include <fmt/format.h>
+
+#include "timefmt.hpp"
+
+/**
+ * Response bodies shaped like the ones of the CzechCraft API, shared by the benchmarks and the mock server.
+ * Generated ones are the same on every run, recorded ones are read from a directory filled by record-fixtures.sh.
+ */
+namespace fixtures {
+
+    // splitmix64, so that generated listings do not depend on the standard library
+    class Random {
+    public:
+        explicit Random(std::uint64_t seed) : state(seed) {}
+
+        std::uint64_t next() {
+            auto value = (state += 0x9e3779b97f4a7c15);
+            value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+            value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+            return value ^ (value >> 31);
+        }
+
+        std::uint64_t below(std::uint64_t bound) { return next() % bound; }
+
+    private:
+        std::uint64_t state;
+    };
+
+    inline std::string username(std::size_t index) {
+        static constexpr const char *STEMS[] = {"Steve", "creeper", "xX_Pro", "henten", "WattMann", "aplayer", "Notch_fan"};
+        return fmt::format("{}{}", STEMS[index % std::size(STEMS)], index);
+    }
+
+    inline std::string serverInfo(const std::string &slug) {
+        return fmt::format(R"({{"address":"play.{}.eu","name":"{}","position":3,"slug":"{}","votes":123456}})",
+                           slug, slug, slug);
+    }
+
+    /**
+     * Appends votes in the order the API lists them, the oldest first, a few minutes apart.
+     * Few users cast most of the votes, like on a real server.
+     *
+     * @param user Author of every vote, or empty for votes of users from a pool of the given size
+     */
+    inline void appendVotes(std::string &body, std::size_t count, std::size_t users, const std::string &user,
+                            std::uint64_t seed) {
+        Random random(seed);
+        std::int64_t date = 1600000000;
+        char time[ccapi::TIME_LENGTH];
+        body += "\"data\":[";
+        for (std::size_t index = 0; index < count; ++index) {
+            date += static_cast<std::int64_t>(random.below(600)) + 1;
+            auto skewed = random.below(users) * random.below(users) / users;
+            fmt::format_to(std::back_inserter(body), R"({}{{"username":"{}","datetime":"{}","delivered":{}}})",
+                           index ? "," : "", user.empty() ? username(skewed) : user, ccapi::formatTime(date, time),
+                           random.below(5) ? "true" : "false");
+        }
+        body += ']';
+    }
+
+    /**
+     * @returns Listing of server votes, all-time or of a month
+     */
+    inline std::string serverVotes(std::size_t count, std::size_t users, std::uint64_t seed = 1) {
+        auto body = fmt::format(R"({{"vote_count":{},)", count);
+        appendVotes(body, count, users, {}, seed);
+        return body + '}';
+    }
+
+    /**
+     * @param monthly Whether to leave out the username and next vote date, as listings of a month do
+     */
+    inline std::string playerVotes(const std::string &user, std::size_t count, bool monthly = false) {
+        auto body = monthly ? fmt::format(R"({{"vote_count":{},)", count)
+                            : fmt::format(R"({{"username":"{}","vote_count":{},"next_vote":"2021-05-28 18:50:35",)",
+                                          user, count);
+        appendVotes(body, count, 1, user, 2);
+        return body + '}';
+    }
+
+    /**
+     * @returns Leaderboard, from the best voter
+     */
+    inline std::string topVoters(std::size_t count) {
+        std::string body = R"({"data":[)";
+        for (std::size_t index = 0; index < count; ++index) {
+            fmt::format_to(std::back_inserter(body), R"({}{{"username":"{}","votes":{}}})", index ? "," : "",
+                           username(index), count - index);
+        }
+        return body + "]}";
+    }
+
+    inline std::string nextVote(const std::string &user) {
+        return fmt::format(R"({{"username":"{}","next_vote":"2021-05-28 18:50:35"}})", user);
+    }
+
+    /**
+     * @param name One of server, votes, month, voters, player, player-month and next-vote
+     * @returns Recorded body, or nothing when the directory does not have it
+     */
+    inline std::optional<std::string> recorded(const std::filesystem::path &directory, const std::string &name) {
+        if (directory.empty())
+            return std::nullopt;
+        std::ifstream input(directory / (name + ".json"), std::ios::binary);
+        if (!input)
+            return std::nullopt;
+        return std::string(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+}
@@ -0,0 +1,97 @@
+#include "ccapi.hpp"
+#include "measure.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print("Usage: bench-http <base-url> [requests] [threads] [info|votes|month|voters|player|next]\n"
+                   "Start bench-mock-server first for an offline run, e.g. bench-http http://127.0.0.1:8765/api/\n");
+        return 0;
+    }
+    std::string base { argv[1] };
+    int requests = argc > 2 ? std::max(1, atoi(argv[2])) : 1000;
+    int threads = argc > 3 ? std::max(1, atoi(argv[3])) : 8;
+    std::string endpoint { argc > 4 ? argv[4] : "info" };
+
+    // a session without the response cache, every call goes through the whole transfer and decoding
+    ccapi::Client client;
+    client.setBaseUrl(base);
+    if (std::getenv("CC_CLI_NO_SCHEDULER"))
+        client.setScheduler(nullptr);
+    const std::string slug = "bench", username = "player";
+    std::function<std::size_t()> call;
+    if (endpoint == "info")
+        call = [&] { return ccapi::serverInfo(slug, client).slug.size(); };
+    else if (endpoint == "votes")
+        call = [&] { return ccapi::serverVotes(slug, client).votes.size(); };
+    else if (endpoint == "month")
+        call = [&] { return ccapi::serverVotes(slug, 1, 2021, client).votes.size(); };
+    else if (endpoint == "voters")
+        call = [&] { return ccapi::topVoters(slug, client).size(); };
+    else if (endpoint == "player")
+        call = [&] { return ccapi::userVotes(username, slug, client).votes.size(); };
+    else if (endpoint == "next")
+        call = [&] { return static_cast<std::size_t>(ccapi::nextVote(username, slug, client).next_vote != 0); };
+    else {
+        fmt::print("Unknown endpoint {}\n", endpoint);
+        return 0;
+    }
+
+    try {
+        call(); // opens the first connection before measuring
+    } catch (std::exception &ex) {
+        fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+        return 1;
+    }
+
+    std::atomic<int> next{0};
+    std::atomic<std::size_t> failed{0}, rows{0};
+    std::vector<std::vector<double>> samples(threads);
+    auto start = measure::Clock::now();
+    std::vector<std::thread> workers;
+    for (int index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index] {
+            while (next++ < requests) {
+                auto begin = measure::Clock::now();
+                try {
+                    rows += call();
+                } catch (std::exception &) {
+                    ++failed;
+                    continue;
+                }
+                samples[index].push_back(measure::since(begin));
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    auto elapsed = measure::since<std::ratio<1>>(start);
+
+    std::vector<double> latencies;
+    for (const auto &thread : samples)
+        latencies.insert(latencies.end(), thread.begin(), thread.end());
+    if (latencies.empty()) {
+        fmt::print("All {} requests failed\n", requests);
+        return 1;
+    }
+    std::sort(latencies.begin(), latencies.end());
+    fmt::print("{} x {} on {} threads  failed: {}  rows: {}\n", endpoint, requests, threads, failed.load(), rows.load());
+    fmt::print("p50: {:.2f} ms  p90: {:.2f} ms  p99: {:.2f} ms  max: {:.2f} ms  {:.1f} requests/s\n",
+               measure::median(latencies), measure::percentile(latencies, 0.9), measure::percentile(latencies, 0.99),
+               latencies.back(),
+               latencies.size() / elapsed);
+    if (auto scheduler = client.scheduler()) {
+        auto stats = scheduler->stats();
+        fmt::print("scheduler limit: {}  retries: {}  throttled: {}\n", stats.limit, stats.retries, stats.throttled);
+    }
+    return 0;
+}
@@ -0,0 +1,94 @@
+#include "measure.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#include <csignal>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+#ifdef _WIN32
+
+int main() {
+    fmt::print("bench-invocation needs Unix sockets and is not supported on Windows\n");
+    return 0;
+}
+
+#else
+
+// starts the program with its output discarded
+static pid_t spawn(const std::vector<std::string> &arguments) {
+    std::vector<char *> argv;
+    for (const auto &argument : arguments)
+        argv.push_back(const_cast<char *>(argument.c_str()));
+    argv.push_back(nullptr);
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid = -1;
+    if (posix_spawn(&pid, argv[0], &actions, nullptr, argv.data(), environ) != 0)
+        pid = -1;
+    posix_spawn_file_actions_destroy(&actions);
+    return pid;
+}
+
+static bool finish(pid_t pid) {
+    int status = 0;
+    return pid > 0 && waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void report(const char *name, const std::vector<std::string> &arguments, std::size_t iterations) {
+    int failed = 0;
+    auto samples = measure::times(iterations, [&] {
+        if (!finish(spawn(arguments)))
+            ++failed;
+    });
+    fmt::print("{:<16} runs: {:>4}  failed: {:>3}  mean: {:>8.2f} ms  p50: {:>8.2f} ms  p99: {:>8.2f} ms\n", name,
+               samples.size(), failed, measure::mean(samples), measure::median(samples),
+               measure::percentile(samples, 0.99));
+}
+
+int main(int argc, char **argv) {
+    if (argc < 3) {
+        fmt::print("Usage: bench-invocation <path to cc-cli> <slug> [iterations]\n");
+        return 0;
+    }
+    std::string program { argv[1] };
+    std::string slug { argv[2] };
+    std::size_t iterations = argc > 3 ? std::max(1, atoi(argv[3])) : 20;
+
+    // a daemon of its own, so a daemon already running is not disturbed
+    auto socket = fmt::format("/tmp/cc-cli-bench-{}.sock", getpid());
+    auto daemon = spawn({program, "serve", "--socket", socket});
+    if (daemon < 0) {
+        fmt::print("Failed to start {}\n", program);
+        return 1;
+    }
+    for (int attempt = 0; attempt < 100 && access(socket.c_str(), F_OK) != 0; ++attempt)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    // every invocation is a new process, --no-cache makes each of them go to the network
+    report("local", {program, "info", "--slug", slug, "--local", "--no-cache"}, iterations);
+    report("daemon", {program, "info", "--slug", slug, "--socket", socket, "--no-cache"}, iterations);
+    report("local, cached", {program, "info", "--slug", slug, "--local"}, iterations);
+    report("daemon, cached", {program, "info", "--slug", slug, "--socket", socket}, iterations);
+
+    kill(daemon, SIGTERM);
+    finish(daemon);
+    return 0;
+}
+
+#endif
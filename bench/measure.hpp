@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <numeric>
+#include <ratio>
+#include <utility>
+#include <vector>
+
+/**
+ * Timing shared by the benchmarks. Durations are doubles in the unit given as a std::ratio, milliseconds by default.
+ */
+namespace measure {
+
+    using Clock = std::chrono::steady_clock;
+
+    // keeps the results of measured calls from being optimized away
+    inline volatile std::size_t sink;
+
+    template<typename Unit = std::milli>
+    double since(Clock::time_point start) {
+        return std::chrono::duration<double, Unit>(Clock::now() - start).count();
+    }
+
+    template<typename Result>
+    struct Timed {
+        Result result;
+        double elapsed;
+    };
+
+    /**
+     * @returns What the call returned and how long it took
+     */
+    template<typename Unit = std::milli, typename Call>
+    auto once(Call call) {
+        auto start = Clock::now();
+        auto result = call();
+        return Timed<decltype(result)>{std::move(result), since<Unit>(start)};
+    }
+
+    /**
+     * @returns Durations of the given number of calls, sorted
+     */
+    template<typename Unit = std::milli, typename Call>
+    std::vector<double> times(std::size_t iterations, Call call) {
+        std::vector<double> samples;
+        samples.reserve(iterations);
+        for (std::size_t index = 0; index < iterations; ++index) {
+            auto start = Clock::now();
+            call();
+            samples.push_back(since<Unit>(start));
+        }
+        std::sort(samples.begin(), samples.end());
+        return samples;
+    }
+
+    /**
+     * Repeats the call for at least a few hundred milliseconds, and at least three times.
+     *
+     * @param limit Most calls made, for calls so fast the time would be spent mostly by the measuring
+     * @returns Durations of the calls, sorted
+     */
+    template<typename Unit = std::milli, typename Call>
+    std::vector<double> repeat(Call call, std::size_t limit = 10000) {
+        std::vector<double> samples;
+        auto started = Clock::now();
+        do {
+            auto start = Clock::now();
+            call();
+            samples.push_back(since<Unit>(start));
+        } while (samples.size() < 3 || (Clock::now() - started < std::chrono::milliseconds(300) && samples.size() < limit));
+        std::sort(samples.begin(), samples.end());
+        return samples;
+    }
+
+    /**
+     * @param sorted Samples sorted from the shortest, not empty
+     * @param rank From 0 for the shortest to 1 for the longest
+     */
+    inline double percentile(const std::vector<double> &sorted, double rank) {
+        return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(rank * static_cast<double>(sorted.size())))];
+    }
+
+    inline double median(const std::vector<double> &sorted) {
+        return percentile(sorted, 0.5);
+    }
+
+    inline double mean(const std::vector<double> &samples) {
+        return std::accumulate(samples.begin(), samples.end(), 0.0) / static_cast<double>(samples.size());
+    }
+}
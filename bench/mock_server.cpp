@@ -0,0 +1,336 @@
+#include "fixtures.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+#include <zlib.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN32
+
+int main() {
+    fmt::print("bench-mock-server needs POSIX sockets and is not supported on Windows\n");
+    return 0;
+}
+
+#else
+
+struct Options {
+    int port = 8765;
+    std::size_t votes = 100000;
+    std::size_t voters = 10000;
+    int delay = 0; // milliseconds before every response, to stand in for the network
+    int workers = 0; // requests processed at the same time, the rest queue up, 0 for no limit
+    int rate = 0; // requests answered per second, the rest get 429 with Retry-After, 0 for no limit
+    int failures = 0; // percent of requests answered with 503
+    std::filesystem::path fixtures;
+};
+
+struct Body {
+    std::string data;
+    std::string etag;
+    std::string gzip; // the same body compressed, sent to clients which accept it
+    std::string gzip_etag;
+};
+
+static std::string compress_gzip(const std::string &data) {
+    z_stream stream{};
+    // 15 bits of window with 16 added for the gzip wrapper instead of zlib
+    deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY);
+    std::string compressed(deflateBound(&stream, static_cast<uLong>(data.size())), '\0');
+    stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+    stream.avail_in = static_cast<uInt>(data.size());
+    stream.next_out = reinterpret_cast<Bytef *>(compressed.data());
+    stream.avail_out = static_cast<uInt>(compressed.size());
+    deflate(&stream, Z_FINISH);
+    compressed.resize(stream.total_out);
+    deflateEnd(&stream);
+    return compressed;
+}
+
+static std::shared_ptr<const Body> make_body(std::string data) {
+    std::uint64_t hash = 0xcbf29ce484222325; // FNV-1a
+    for (auto c : data)
+        hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    auto compressed = compress_gzip(data);
+    return std::make_shared<const Body>(Body{std::move(data), fmt::format("\"{:016x}\"", hash), std::move(compressed),
+                                             fmt::format("\"{:016x}-gzip\"", hash)});
+}
+
+/**
+ * Answers every endpoint of the API. Listings are built once at startup, the same for every slug,
+ * so responses are as cheap to produce as the transfer allows.
+ */
+class Responses {
+public:
+    explicit Responses(const Options &options) {
+        auto load = [&](const std::string &name, auto generate) {
+            auto recorded = fixtures::recorded(options.fixtures, name);
+            listings[name] = make_body(recorded ? std::move(*recorded) : generate());
+        };
+        load("votes", [&] { return fixtures::serverVotes(options.votes, options.voters); });
+        load("month", [&] { return fixtures::serverVotes(std::max<std::size_t>(1, options.votes / 12), options.voters, 3); });
+        load("voters", [&] { return fixtures::topVoters(options.voters); });
+        load("player", [&] { return fixtures::playerVotes("player", 50); });
+        load("player-month", [&] { return fixtures::playerVotes("player", 5, true); });
+        server = fixtures::recorded(options.fixtures, "server");
+        next_vote = fixtures::recorded(options.fixtures, "next-vote");
+    }
+
+    /**
+     * @param path Endpoint path, without the /api/ prefix
+     * @returns Body of the response, or nullptr when there is no such endpoint
+     */
+    std::shared_ptr<const Body> find(std::string_view path) const {
+        std::vector<std::string_view> parts;
+        for (std::size_t start = 0; start <= path.size();) {
+            auto end = std::min(path.find('/', start), path.size());
+            parts.push_back(path.substr(start, end - start));
+            start = end + 1;
+        }
+        if (parts.size() < 2 || parts[0] != "server" || parts[1].empty())
+            return nullptr;
+
+        const auto size = parts.size();
+        if (size == 2)
+            return make_body(server ? *server : fixtures::serverInfo(std::string(parts[1])));
+        if (size == 3 && parts[2] == "votes")
+            return listings.at("votes");
+        if (size == 5 && parts[2] == "votes")
+            return listings.at("month");
+        if (size == 3 && parts[2] == "voters")
+            return listings.at("voters");
+        if (size == 4 && parts[2] == "player")
+            return listings.at("player");
+        if (size == 5 && parts[2] == "player" && parts[4] == "next_vote")
+            return make_body(next_vote ? *next_vote : fixtures::nextVote(std::string(parts[3])));
+        if (size == 6 && parts[2] == "player")
+            return listings.at("player-month");
+        return nullptr;
+    }
+
+private:
+    std::map<std::string, std::shared_ptr<const Body>> listings;
+    std::optional<std::string> server;
+    std::optional<std::string> next_vote;
+};
+
+/**
+ * Stands in for the limits of the real API: a fixed number of workers, so latency grows once more requests
+ * are sent than it can process, and a rate limit per second.
+ */
+class Limits {
+public:
+    explicit Limits(const Options &options) : options(options), random(7) {}
+
+    enum class Verdict { serve, throttle, fail };
+
+    Verdict admit() {
+        std::lock_guard guard(lock);
+        auto second = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        if (second != window) {
+            window = second;
+            served = 0;
+        }
+        if (options.rate > 0 && served >= options.rate)
+            return Verdict::throttle;
+        ++served;
+        if (options.failures > 0 && random.below(100) < static_cast<std::uint64_t>(options.failures))
+            return Verdict::fail;
+        return Verdict::serve;
+    }
+
+    void work() {
+        if (options.workers <= 0) {
+            if (options.delay > 0)
+                std::this_thread::sleep_for(std::chrono::milliseconds(options.delay));
+            return;
+        }
+        std::unique_lock guard(lock);
+        idle.wait(guard, [&] { return busy < options.workers; });
+        ++busy;
+        guard.unlock();
+        if (options.delay > 0)
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.delay));
+        guard.lock();
+        --busy;
+        idle.notify_one();
+    }
+
+private:
+    const Options &options;
+    std::mutex lock;
+    std::condition_variable idle;
+    int busy = 0;
+    std::int64_t window = 0;
+    int served = 0;
+    fixtures::Random random;
+};
+
+static bool send_all(int fd, const char *data, std::size_t size) {
+    while (size > 0) {
+        auto sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent < 0 && errno == EINTR)
+            continue;
+        if (sent <= 0)
+            return false;
+        data += sent;
+        size -= static_cast<std::size_t>(sent);
+    }
+    return true;
+}
+
+static std::string_view header_value(std::string_view request, std::string_view name) {
+    for (std::size_t start = request.find("\r\n"); start != std::string_view::npos;) {
+        start += 2;
+        auto end = request.find("\r\n", start);
+        auto line = request.substr(start, end - start);
+        if (line.size() > name.size() && line[name.size()] == ':'
+            && std::equal(name.begin(), name.end(), line.begin(), [](char a, char b) { return std::tolower(a) == std::tolower(b); })) {
+            auto value = line.substr(name.size() + 1);
+            return value.substr(std::min(value.find_first_not_of(' '), value.size()));
+        }
+        start = end;
+    }
+    return {};
+}
+
+// one thread per connection, which is kept alive for as long as the client wants
+static void serve_connection(int fd, const Responses &responses, Limits &limits) {
+    std::string buffer;
+    char chunk[4096];
+    for (;;) {
+        std::size_t end;
+        while ((end = buffer.find("\r\n\r\n")) == std::string::npos) {
+            auto received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received < 0 && errno == EINTR)
+                continue;
+            if (received <= 0)
+                return;
+            buffer.append(chunk, static_cast<std::size_t>(received));
+        }
+        std::string request = buffer.substr(0, end + 2);
+        buffer.erase(0, end + 4);
+
+        // GET /api/server/slug HTTP/1.1
+        auto first_space = request.find(' ');
+        auto second_space = request.find(' ', first_space + 1);
+        std::string_view path(request);
+        path = path.substr(first_space + 1, second_space - first_space - 1);
+        path = path.substr(0, path.find('?'));
+        if (path.rfind("/api/", 0) == 0)
+            path.remove_prefix(5);
+        else if (!path.empty() && path.front() == '/')
+            path.remove_prefix(1);
+
+        auto verdict = limits.admit();
+        if (verdict == Limits::Verdict::serve)
+            limits.work();
+
+        auto body = responses.find(path);
+        std::string head;
+        std::string_view content;
+        if (verdict == Limits::Verdict::throttle) {
+            head = "HTTP/1.1 429 Too Many Requests\r\nRetry-After: 1\r\nContent-Length: 0\r\n\r\n";
+        } else if (verdict == Limits::Verdict::fail) {
+            head = "HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\n\r\n";
+        } else if (!body) {
+            head = "HTTP/1.1 404 Not Found\r\nContent-Length: 0\r\n\r\n";
+        } else {
+            const bool compressed = header_value(request, "Accept-Encoding").find("gzip") != std::string_view::npos;
+            const auto &etag = compressed ? body->gzip_etag : body->etag;
+            if (header_value(request, "If-None-Match") == etag) {
+                head = fmt::format("HTTP/1.1 304 Not Modified\r\nETag: {}\r\nContent-Length: 0\r\n\r\n", etag);
+            } else {
+                content = compressed ? body->gzip : body->data;
+                head = fmt::format("HTTP/1.1 200 OK\r\nContent-Type: application/json\r\n{}Vary: Accept-Encoding\r\n"
+                                   "ETag: {}\r\nContent-Length: {}\r\n\r\n",
+                                   compressed ? "Content-Encoding: gzip\r\n" : "", etag, content.size());
+            }
+        }
+        if (!send_all(fd, head.data(), head.size()) || !send_all(fd, content.data(), content.size()))
+            return;
+        if (header_value(request, "Connection") == "close")
+            return;
+    }
+}
+
+int main(int argc, char **argv) {
+    Options options;
+    for (int index = 1; index < argc; ++index) {
+        std::string_view arg = argv[index];
+        bool has_value = index + 1 < argc;
+        if (arg == "--port" && has_value)
+            options.port = atoi(argv[++index]);
+        else if (arg == "--votes" && has_value)
+            options.votes = std::max(1L, atol(argv[++index]));
+        else if (arg == "--voters" && has_value)
+            options.voters = std::max(1L, atol(argv[++index]));
+        else if (arg == "--delay" && has_value)
+            options.delay = std::max(0, atoi(argv[++index]));
+        else if (arg == "--workers" && has_value)
+            options.workers = std::max(0, atoi(argv[++index]));
+        else if (arg == "--rate" && has_value)
+            options.rate = std::max(0, atoi(argv[++index]));
+        else if (arg == "--failures" && has_value)
+            options.failures = std::clamp(atoi(argv[++index]), 0, 100);
+        else if (arg == "--fixtures" && has_value)
+            options.fixtures = argv[++index];
+        else {
+            fmt::print("Usage: bench-mock-server [--port 8765] [--votes 100000] [--voters 10000] [--delay ms] [--workers n]\n"
+                       "                         [--rate requests/s] [--failures percent] [--fixtures directory]\n");
+            return 0;
+        }
+    }
+
+    Responses responses(options);
+    Limits limits(options);
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK); // only reachable from this machine
+    address.sin_port = htons(static_cast<std::uint16_t>(options.port));
+    if (fd < 0 || bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0 || listen(fd, 128) != 0) {
+        fmt::print("Failed to listen on port {}\n", options.port);
+        return 1;
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    fmt::print("Serving http://127.0.0.1:{}/api/ with {} votes and {} voters\n", options.port, options.votes, options.voters);
+    std::fflush(stdout);
+    for (;;) {
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0)
+            continue;
+        setsockopt(client, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+        std::thread([client, &responses, &limits] {
+            serve_connection(client, responses, limits);
+            close(client);
+        }).detach();
+    }
+}
+
+#endif
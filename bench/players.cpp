@@ -0,0 +1,89 @@
+#include "aggregate.hpp"
+#include "batch.hpp"
+#include "fixtures.hpp"
+#include "measure.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+static void report(const char *name, double fetch, double lookup, const ccapi::Tracer &tracer, std::size_t votes) {
+    auto totals = tracer.totals();
+    fmt::print("{:<12}  {:>10.1f}  {:>10.1f}  {:>10.1f}  {:>8}  {:>12}  {:>10}\n", name, fetch, lookup, fetch + lookup,
+               totals.requests, totals.bytes, votes);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print("Usage: bench-players <base-url> [players] [parallel]\n"
+                   "Start bench-mock-server first for an offline run, e.g. bench-players http://127.0.0.1:8765/api/ 100 8\n"
+                   "Compares a request per player with one listing of the server votes indexed by player\n");
+        return 0;
+    }
+    std::string base { argv[1] };
+    std::size_t players = argc > 2 ? std::max(1, atoi(argv[2])) : 100;
+    std::size_t parallel = argc > 3 ? std::max(1, atoi(argv[3])) : 8;
+
+    const std::string slug = "bench";
+    std::vector<std::string> usernames;
+    for (std::size_t index = 0; index < players; ++index)
+        usernames.push_back(fixtures::username(index));
+
+    fmt::print("{} players, {} requests in parallel\n", players, parallel);
+    fmt::print("{:<12}  {:>10}  {:>10}  {:>10}  {:>8}  {:>12}  {:>10}\n", "mode", "fetch ms", "lookup ms", "total ms",
+               "requests", "bytes", "votes");
+    try {
+        // a session without the response cache, every request is transferred
+        ccapi::Client client;
+        client.setBaseUrl(base);
+        {
+            ccapi::Batch warmup(client); // opens the first connection before measuring
+            warmup.serverInfo(slug);
+            warmup.run();
+            warmup.get<ccapi::ServerInfo>(0);
+        }
+
+        {
+            auto tracer = std::make_shared<ccapi::Tracer>();
+            client.setTracer(tracer);
+            ccapi::Batch batch(client);
+            for (const auto &username : usernames)
+                batch.userVotes(username, slug);
+            auto start = measure::Clock::now();
+            batch.run(parallel);
+            auto fetch = measure::since(start);
+
+            start = measure::Clock::now();
+            std::size_t votes = 0;
+            for (std::size_t index = 0; index < players; ++index)
+                votes += batch.get<ccapi::PlayerInfo>(index).votes.size();
+            report("per player", fetch, measure::since(start), *tracer, votes);
+        }
+
+        {
+            auto tracer = std::make_shared<ccapi::Tracer>();
+            client.setTracer(tracer);
+            ccapi::Batch batch(client);
+            batch.serverVotes(slug);
+            auto start = measure::Clock::now();
+            batch.run(parallel);
+            auto fetch = measure::since(start);
+
+            start = measure::Clock::now();
+            ccapi::PlayerIndex index(batch.get<ccapi::VoteVector>(0).votes);
+            std::size_t votes = 0;
+            for (const auto &username : usernames)
+                votes += index.player(username, 0).votes.size();
+            report("indexed", fetch, measure::since(start), *tracer, votes);
+        }
+    } catch (std::exception &ex) {
+        fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,30 @@
+#!/bin/sh
+# Records responses of the live API for bench-decode and bench-mock-server.
+# Usage: record-fixtures.sh <directory> <slug> <username> [year] [month]
+set -e
+
+if [ $# -lt 3 ]; then
+    echo "Usage: record-fixtures.sh <directory> <slug> <username> [year] [month]"
+    exit 0
+fi
+
+directory=$1
+slug=$2
+username=$3
+year=${4:-$(date +%Y)}
+month=${5:-$(date +%-m)}
+api=${CC_CLI_API_URL:-https://czech-craft.eu/api/}
+
+mkdir -p "$directory"
+record() {
+    echo "$1 <- $api$2"
+    curl --fail --silent --show-error --compressed --output "$directory/$1.json" "$api$2"
+}
+
+record server "server/$slug"
+record votes "server/$slug/votes"
+record month "server/$slug/votes/$year/$month"
+record voters "server/$slug/voters"
+record player "server/$slug/player/$username"
+record player-month "server/$slug/player/$username/$year/$month"
+record next-vote "server/$slug/player/$username/next_vote"
@@ -0,0 +1,122 @@
+#include "ccapi.hpp"
+#include "measure.hpp"
+#include "results.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+struct Run {
+    std::vector<double> latencies; // sorted
+    double elapsed;                // seconds
+    std::size_t failed;
+};
+
+/**
+ * Every thread starts at the same time and makes its calls one after another, spread over the slugs.
+ */
+static Run run(int threads, int calls, std::size_t slugs, const std::function<void(const std::string &)> &call) {
+    std::atomic<bool> started{false};
+    std::atomic<std::size_t> failed{0};
+    std::vector<std::vector<double>> samples(threads);
+    std::vector<std::thread> workers;
+    for (int index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index] {
+            while (!started)
+                std::this_thread::yield();
+            for (int number = 0; number < calls; ++number) {
+                auto slug = fmt::format("bench{}", (index + number) % slugs);
+                auto begin = measure::Clock::now();
+                try {
+                    call(slug);
+                } catch (std::exception &) {
+                    ++failed;
+                    continue;
+                }
+                samples[index].push_back(measure::since(begin));
+            }
+        });
+    }
+    auto start = measure::Clock::now();
+    started = true;
+    for (auto &worker : workers)
+        worker.join();
+
+    Run result{{}, measure::since<std::ratio<1>>(start), failed};
+    for (const auto &thread : samples)
+        result.latencies.insert(result.latencies.end(), thread.begin(), thread.end());
+    std::sort(result.latencies.begin(), result.latencies.end());
+    return result;
+}
+
+static void report(const char *name, const Run &run, const ccapi::Tracer &tracer) {
+    if (run.latencies.empty()) {
+        fmt::print("{:<10}  all calls failed\n", name);
+        return;
+    }
+    fmt::print("{:<10}  {:>8}  {:>8.3f}  {:>8.3f}  {:>8.3f}  {:>10.1f}  {:>8}  {:>6}\n", name, run.latencies.size(),
+               measure::median(run.latencies), measure::percentile(run.latencies, 0.99), run.latencies.back(),
+               run.latencies.size() / run.elapsed, tracer.totals().requests, run.failed);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print("Usage: bench-results <base-url> [threads] [calls] [slugs] [info|voters]\n"
+                   "Start bench-mock-server first for an offline run, e.g. bench-results http://127.0.0.1:8765/api/ 32 200 4 voters\n"
+                   "Calls an endpoint from many threads at once, without and with the in-process result cache\n");
+        return 0;
+    }
+    std::string base { argv[1] };
+    int threads = argc > 2 ? std::max(1, atoi(argv[2])) : 32;
+    int calls = argc > 3 ? std::max(1, atoi(argv[3])) : 200;
+    std::size_t slugs = argc > 4 ? std::max(1, atoi(argv[4])) : 4;
+    std::string endpoint { argc > 5 ? argv[5] : "voters" };
+
+    std::function<void(ccapi::Client &, const std::string &)> call;
+    if (endpoint == "info")
+        call = [](ccapi::Client &client, const std::string &slug) { measure::sink = ccapi::serverInfo(slug, client).votes; };
+    else if (endpoint == "voters")
+        call = [](ccapi::Client &client, const std::string &slug) { measure::sink = ccapi::topVoters(slug, client).size(); };
+    else {
+        fmt::print("Unknown endpoint {}\n", endpoint);
+        return 0;
+    }
+
+    fmt::print("{} x {} on {} threads, {} slugs\n", endpoint, calls, threads, slugs);
+    fmt::print("{:<10}  {:>8}  {:>8}  {:>8}  {:>8}  {:>10}  {:>8}  {:>6}\n", "mode", "calls", "p50 ms", "p99 ms", "max ms",
+               "calls/s", "requests", "failed");
+    try {
+        // sessions without the response cache, every request which is not coalesced is transferred
+        for (bool cached : {false, true}) {
+            ccapi::Client client;
+            client.setBaseUrl(base);
+            call(client, "bench0"); // opens the first connection before measuring
+
+            auto results = std::make_shared<ccapi::ResultCache>();
+            if (cached)
+                client.setResults(results);
+            auto tracer = std::make_shared<ccapi::Tracer>();
+            client.setTracer(tracer);
+            report(cached ? "results" : "uncached", run(threads, calls, slugs, [&](const std::string &slug) {
+                call(client, slug);
+            }), *tracer);
+            if (cached) {
+                auto stats = results->stats();
+                fmt::print("hits: {}  misses: {}  coalesced: {}  entries: {}\n", stats.hits, stats.misses,
+                           stats.coalesced, stats.entries);
+            }
+        }
+    } catch (std::exception &ex) {
+        fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+        return 1;
+    }
+    return 0;
+}
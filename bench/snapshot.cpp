@@ -0,0 +1,80 @@
+#include "decode.hpp"
+#include "fixtures.hpp"
+#include "measure.hpp"
+#include "snapshot.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <filesystem>
+#include <vector>
+
+#include <fmt/format.h>
+
+namespace api = ccapi::api;
+using measure::sink;
+
+/**
+ * @returns Median time of a call in microseconds, repeated for at least a few hundred milliseconds
+ */
+template<typename Call>
+double
+timed(Call call) {
+    return measure::median(measure::repeat<std::micro>(call, 100000));
+}
+
+static void report(const char *name, double us) {
+    fmt::print("{:<32} {:>12.2f} us\n", name, us);
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1 && (std::string_view(argv[1]) == "-h" || std::string_view(argv[1]) == "--help")) {
+        fmt::print("Usage: bench-snapshot [votes] [users]\n"
+                   "Compares loading a vote history from the JSON listing and from a memory mapped snapshot\n");
+        return 0;
+    }
+    std::size_t count = argc > 1 ? std::max(1, atoi(argv[1])) : 1000000;
+    std::size_t users = argc > 2 ? std::max(1, atoi(argv[2])) : 20000;
+
+    auto body = fixtures::serverVotes(count, users);
+    auto decoded = ccapi::detail::decode(api::ServerVotes{"bench"}, body);
+    auto path = std::filesystem::temp_directory_path() / fmt::format("bench-snapshot-{}.ccbin", count);
+    ccapi::VoteSnapshot::write(path, decoded.votes, decoded.vote_count);
+    fmt::print("{} votes of {} users, JSON {:.2f} MB, snapshot {:.2f} MB\n", count, decoded.votes.table().size(),
+               body.size() / 1e6, std::filesystem::file_size(path) / 1e6);
+
+    report("decode JSON", timed([&] {
+        sink = ccapi::detail::decode(api::ServerVotes{"bench"}, body).votes.size();
+    }));
+    report("write snapshot", timed([&] {
+        ccapi::VoteSnapshot::write(path, decoded.votes, decoded.vote_count);
+    }));
+    report("open snapshot", timed([&] {
+        sink = ccapi::VoteSnapshot::open(path).size();
+    }));
+
+    auto snapshot = ccapi::VoteSnapshot::open(path);
+    report("count delivered", timed([&] {
+        std::size_t delivered = 0;
+        for (auto word : snapshot.delivered_column())
+            delivered += static_cast<std::size_t>(std::popcount(word));
+        sink = delivered;
+    }));
+    const auto middle = ccapi::fromEpoch(snapshot.date_column()[snapshot.size() / 2]);
+    const ccapi::YearMonth month{middle.tm_year + 1900, middle.tm_mon + 1};
+    report("seek a month", timed([&] {
+        auto [first, last] = snapshot.range(month, month);
+        sink = last - first;
+    }));
+    const auto username = fixtures::username(users / 2);
+    report("find a username", timed([&] {
+        sink = snapshot.find(username).value_or(0);
+    }));
+    report("copy into columns", timed([&] {
+        sink = snapshot.votes().size();
+    }));
+
+    std::error_code error;
+    std::filesystem::remove(path, error);
+    return 0;
+}
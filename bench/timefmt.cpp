@@ -0,0 +1,79 @@
+#include "measure.hpp"
+#include "timefmt.hpp"
+
+#include <ctime>
+#include <iomanip>
+#include <locale>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+// previous implementation, kept here as the baseline
+static std::tm legacy_parse(const std::string &text) {
+    std::tm tm{};
+    std::istringstream input(text.c_str());
+    input.imbue(std::locale(setlocale(LC_ALL, nullptr)));
+    input >> std::get_time(&tm, "%Y-%m-%d %H:%M:%S");
+    return tm;
+}
+
+static std::string legacy_format(const std::tm &tm) {
+    char buffer[32] = {0};
+    std::strftime(buffer, 32, "%Y-%m-%d %H:%M:%S", &tm);
+    return std::string(buffer);
+}
+
+template<typename Body>
+void
+report(const char *name, std::size_t count, Body body) {
+    auto [checksum, elapsed] = measure::once<std::nano>(body);
+    fmt::print("{:<16} {:>10.1f} ns/op  (checksum {})\n", name, elapsed / count, checksum);
+}
+
+int main(int argc, char **argv) {
+    std::size_t count = argc > 1 ? std::max(1, atoi(argv[1])) : 1000000;
+
+    std::vector<std::string> texts;
+    std::vector<std::int64_t> epochs;
+    texts.reserve(count);
+    epochs.reserve(count);
+    char buffer[ccapi::TIME_LENGTH];
+    for (std::size_t index = 0; index < count; ++index) {
+        epochs.push_back(1500000000 + static_cast<std::int64_t>(index) * 7919);
+        texts.emplace_back(ccapi::formatTime(epochs.back(), buffer));
+    }
+
+    report("legacy parse", count, [&] {
+        std::int64_t sum = 0;
+        for (const auto &text : texts)
+            sum += legacy_parse(text).tm_sec;
+        return sum;
+    });
+    report("parseTime", count, [&] {
+        std::int64_t sum = 0;
+        for (const auto &text : texts)
+            sum += *ccapi::parseTime(text) % 60;
+        return sum;
+    });
+
+    std::vector<std::tm> tms;
+    tms.reserve(count);
+    for (auto epoch : epochs)
+        tms.push_back(ccapi::fromEpoch(epoch));
+
+    report("legacy format", count, [&] {
+        std::size_t sum = 0;
+        for (const auto &tm : tms)
+            sum += legacy_format(tm)[18];
+        return sum;
+    });
+    report("formatTime", count, [&] {
+        std::size_t sum = 0;
+        for (auto epoch : epochs)
+            sum += ccapi::formatTime(epoch, buffer)[18];
+        return sum;
+    });
+    return 0;
+}
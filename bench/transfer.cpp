@@ -0,0 +1,126 @@
+#include "batch.hpp"
+#include "measure.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+struct Setup {
+    const char *name;
+    ccapi::Client::HttpVersion version;
+    bool compression;
+};
+
+template<typename T>
+static std::size_t failures(const ccapi::Batch &batch) {
+    std::size_t failed = 0;
+    for (std::size_t index = 0; index < batch.size(); ++index) {
+        try {
+            batch.get<T>(index);
+        } catch (std::exception &) {
+            ++failed;
+        }
+    }
+    return failed;
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fmt::print("Usage: bench-transfer <base-url> [requests] [parallel] [info|votes|month|voters|player|next] [h2c]\n"
+                   "Start bench-mock-server first for an offline run, e.g. bench-transfer http://127.0.0.1:8765/api/ 200 8 month\n"
+                   "HTTP/2 is negotiated over TLS, h2c speaks it without negotiation to plain http:// servers which support it\n");
+        return 0;
+    }
+    std::string base { argv[1] };
+    int requests = argc > 2 ? std::max(1, atoi(argv[2])) : 200;
+    int parallel = argc > 3 ? std::max(1, atoi(argv[3])) : 8;
+    std::string endpoint { argc > 4 ? argv[4] : "month" };
+    const bool cleartext = argc > 5 && std::string(argv[5]) == "h2c";
+
+    const std::string slug = "bench", username = "player";
+    std::function<void(ccapi::Batch &)> queue;
+    std::function<std::size_t(const ccapi::Batch &)> failed;
+    if (endpoint == "info") {
+        queue = [&](ccapi::Batch &batch) { batch.serverInfo(slug); };
+        failed = failures<ccapi::ServerInfo>;
+    } else if (endpoint == "votes") {
+        queue = [&](ccapi::Batch &batch) { batch.serverVotes(slug); };
+        failed = failures<ccapi::VoteVector>;
+    } else if (endpoint == "month") {
+        queue = [&](ccapi::Batch &batch) { batch.serverVotes(slug, 1, 2021); };
+        failed = failures<ccapi::VoteVector>;
+    } else if (endpoint == "voters") {
+        queue = [&](ccapi::Batch &batch) { batch.topVoters(slug); };
+        failed = failures<std::list<ccapi::VoterInfo>>;
+    } else if (endpoint == "player") {
+        queue = [&](ccapi::Batch &batch) { batch.userVotes(username, slug); };
+        failed = failures<ccapi::PlayerInfo>;
+    } else if (endpoint == "next") {
+        queue = [&](ccapi::Batch &batch) { batch.nextVote(username, slug); };
+        failed = failures<ccapi::PlayerInfo>;
+    } else {
+        fmt::print("Unknown endpoint {}\n", endpoint);
+        return 0;
+    }
+
+    const auto http2 = cleartext ? ccapi::Client::HttpVersion::http2_cleartext : ccapi::Client::HttpVersion::http2;
+    const Setup setups[] = {
+            {"http/1.1", ccapi::Client::HttpVersion::http1, false},
+            {"http/1.1 compressed", ccapi::Client::HttpVersion::http1, true},
+            {"http/2", http2, false},
+            {"http/2 compressed", http2, true},
+    };
+
+    fmt::print("{} x {}, {} in parallel\n", endpoint, requests, parallel);
+    fmt::print("{:<20}  {:>10}  {:>14}  {:>10}  {:>10}  {:>11}  {:>6}  {:>6}\n", "setup", "requests/s", "bytes/request",
+               "MB/s", "total ms", "connections", "http/2", "failed");
+    for (const auto &setup : setups) {
+        // a session without the response cache, every request is transferred
+        ccapi::Client client;
+        client.setBaseUrl(base);
+        client.setCompression(setup.compression);
+        client.setHttpVersion(setup.version);
+
+        try {
+            ccapi::Batch warmup(client); // opens the first connection before measuring
+            queue(warmup);
+            warmup.run();
+            if (failed(warmup)) {
+                fmt::print("Benchmark failed, the first request did not succeed\n");
+                return 1;
+            }
+        } catch (std::exception &ex) {
+            fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+            return 1;
+        }
+
+        auto tracer = std::make_shared<ccapi::Tracer>();
+        client.setTracer(tracer);
+        ccapi::Batch batch(client);
+        for (int index = 0; index < requests; ++index)
+            queue(batch);
+        auto start = measure::Clock::now();
+        try {
+            batch.run(static_cast<std::size_t>(parallel));
+        } catch (std::exception &ex) {
+            fmt::print("Benchmark failed. Cause: {}\n", ex.what());
+            return 1;
+        }
+        auto elapsed = measure::since<std::ratio<1>>(start);
+
+        auto totals = tracer->totals();
+        const auto transferred = std::max<std::size_t>(totals.requests, 1);
+        fmt::print("{:<20}  {:>10.1f}  {:>14}  {:>10.2f}  {:>10.1f}  {:>11}  {:>6}  {:>6}\n", setup.name,
+                   requests / elapsed, totals.bytes / static_cast<std::int64_t>(transferred),
+                   static_cast<double>(totals.bytes) / elapsed / 1e6, elapsed * 1000, totals.connections, totals.http2,
+                   failed(batch));
+    }
+    return 0;
+}
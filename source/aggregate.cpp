@@ -0,0 +1,253 @@
+#include "aggregate.hpp"
+#include "ccapi.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <thread>
+
+using namespace ccapi;
+
+static std::size_t slot_of(StringTable::Id user, std::size_t mask) {
+    // ids are dense, fibonacci hashing spreads consecutive ones over the table
+    return static_cast<std::size_t>((static_cast<std::uint64_t>(user) * 0x9e3779b97f4a7c15ull) >> 32) & mask;
+}
+
+// orders by count descending, then by id ascending
+static bool ranks_before(const VoteCounter::Entry &left, const VoteCounter::Entry &right) {
+    return left.count != right.count ? left.count > right.count : left.user < right.user;
+}
+
+VoteCounter::VoteCounter(std::size_t expected)
+: slots(std::bit_ceil(std::max<std::size_t>(expected * 2, 16)), Entry{EMPTY, 0}) {}
+
+void
+VoteCounter::add(StringTable::Id user, std::uint64_t count) {
+    const auto mask = slots.size() - 1;
+    for (auto index = slot_of(user, mask);; index = (index + 1) & mask) {
+        auto &slot = slots[index];
+        if (slot.user == user) {
+            slot.count += count;
+            break;
+        }
+        if (slot.user == EMPTY) {
+            slot = {user, count};
+            if (++used * 2 > slots.size())
+                grow();
+            break;
+        }
+    }
+    sum += count;
+}
+
+void
+VoteCounter::add(VoteSpan votes, std::int64_t from, std::int64_t to) {
+    const auto dates = votes.date_column();
+    const auto users = votes.user_column();
+
+    // consecutive votes often come from the same user, so runs are counted before touching the table
+    StringTable::Id run_user = EMPTY;
+    std::uint64_t run_length = 0;
+    for (std::size_t index = 0; index < dates.size(); ++index) {
+        if (dates[index] < from || dates[index] >= to)
+            continue;
+        if (users[index] != run_user) {
+            if (run_length)
+                add(run_user, run_length);
+            run_user = users[index];
+            run_length = 0;
+        }
+        ++run_length;
+    }
+    if (run_length)
+        add(run_user, run_length);
+}
+
+void
+VoteCounter::merge(const VoteCounter &other) {
+    for (const auto &slot : other.slots) {
+        if (slot.user != EMPTY)
+            add(slot.user, slot.count);
+    }
+}
+
+std::vector<VoteCounter::Entry>
+VoteCounter::top(std::size_t k) const {
+    std::vector<Entry> heap;
+    if (k == 0)
+        return heap;
+    heap.reserve(std::min(k, used));
+
+    if (k >= used) {
+        for (const auto &slot : slots) {
+            if (slot.user != EMPTY)
+                heap.push_back(slot);
+        }
+        std::sort(heap.begin(), heap.end(), ranks_before);
+        return heap;
+    }
+
+    // bounded heap whose front is the weakest of the best k seen so far
+    for (const auto &slot : slots) {
+        if (slot.user == EMPTY)
+            continue;
+        if (heap.size() < k) {
+            heap.push_back(slot);
+            std::push_heap(heap.begin(), heap.end(), ranks_before);
+        } else if (ranks_before(slot, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), ranks_before);
+            heap.back() = slot;
+            std::push_heap(heap.begin(), heap.end(), ranks_before);
+        }
+    }
+    std::sort_heap(heap.begin(), heap.end(), ranks_before);
+    return heap;
+}
+
+void
+VoteCounter::grow() {
+    std::vector<Entry> old(slots.size() * 2, Entry{EMPTY, 0});
+    old.swap(slots);
+
+    const auto mask = slots.size() - 1;
+    for (const auto &slot : old) {
+        if (slot.user == EMPTY)
+            continue;
+        auto index = slot_of(slot.user, mask);
+        while (slots[index].user != EMPTY)
+            index = (index + 1) & mask;
+        slots[index] = slot;
+    }
+}
+
+VoteCounter
+ccapi::countVotes(VoteSpan votes, std::int64_t from, std::int64_t to, unsigned threads) {
+    threads = detail::voteThreads(votes.size(), threads);
+
+    const auto expected = votes.table().size();
+    if (threads == 1) {
+        VoteCounter counter(expected);
+        counter.add(votes, from, to);
+        return counter;
+    }
+
+    // string table is only read here, every worker counts its own chunk
+    std::vector<VoteCounter> partials(threads, VoteCounter(expected));
+    std::vector<std::thread> workers;
+    const auto chunk = (votes.size() + threads - 1) / threads;
+    for (unsigned index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index] {
+            partials[index].add(votes.subspan(index * chunk, chunk), from, to);
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    for (unsigned index = 1; index < threads; ++index)
+        partials.front().merge(partials[index]);
+    return std::move(partials.front());
+}
+
+std::list<VoterInfo>
+ccapi::topVoters(const VoteCounter &counter, const StringTable &table, std::size_t k) {
+    std::list<VoterInfo> voters;
+    for (const auto &entry : counter.top(k))
+        voters.emplace_back(std::string(table[entry.user]), static_cast<int>(entry.count));
+    return voters;
+}
+
+void
+VoterIndex::add(const std::string &slug, const std::list<VoterInfo> &voters) {
+    const auto server = slugs.size();
+    slugs.push_back(slug);
+    standings.reserve(standings.size() + voters.size());
+    previous.reserve(previous.size() + voters.size());
+
+    std::size_t rank = 0;
+    for (const auto &voter : voters) {
+        auto user = names.intern(voter.username);
+        if (user >= latest.size())
+            latest.resize(user + 1, END);
+        // a leaderboard lists every voter once, a repeated name keeps its better rank
+        if (latest[user] != END && standings[latest[user]].server == server) {
+            ++rank;
+            continue;
+        }
+        standings.push_back(Standing{server, ++rank, voter.vote_count});
+        previous.push_back(latest[user]);
+        latest[user] = static_cast<std::uint32_t>(standings.size() - 1);
+        counter.add(user, static_cast<std::uint64_t>(std::max(voter.vote_count, 0)));
+    }
+}
+
+std::vector<VoterIndex::Standing>
+VoterIndex::find(std::string_view username) const {
+    std::vector<Standing> found;
+    auto user = names.find(username);
+    if (!user)
+        return found;
+    for (auto index = latest[*user]; index != END; index = previous[index])
+        found.push_back(standings[index]);
+    std::reverse(found.begin(), found.end());
+    return found;
+}
+
+
+PlayerIndex::PlayerIndex(const VoteColumns &source)
+: votes(source.shared_table()), offsets(source.table().size() + 1, 0) {
+    const auto dates = source.date_column();
+    const auto users = source.user_column();
+
+    // counting sort by user, every vote is moved once into the run of its author
+    for (auto user : users)
+        ++offsets[user + 1];
+    for (std::size_t user = 1; user < offsets.size(); ++user) {
+        players += offsets[user] != 0;
+        offsets[user] += offsets[user - 1];
+    }
+    std::vector<std::size_t> order(users.size());
+    std::vector<std::size_t> cursor(offsets.begin(), offsets.end() - 1);
+    for (std::size_t index = 0; index < users.size(); ++index)
+        order[cursor[users[index]]++] = index;
+
+    // listings are ordered by date one way or the other, so runs mostly keep their order or get flipped
+    auto newer = [&](std::size_t left, std::size_t right) { return dates[left] > dates[right]; };
+    auto older = [&](std::size_t left, std::size_t right) { return dates[left] < dates[right]; };
+    for (std::size_t user = 0; user + 1 < offsets.size(); ++user) {
+        auto first = order.begin() + static_cast<std::ptrdiff_t>(offsets[user]);
+        auto last = order.begin() + static_cast<std::ptrdiff_t>(offsets[user + 1]);
+        if (std::is_sorted(first, last, newer))
+            continue;
+        if (std::is_sorted(first, last, older))
+            std::reverse(first, last);
+        else
+            std::stable_sort(first, last, newer);
+    }
+
+    votes.reserve(order.size());
+    for (auto index : order)
+        votes.push_back(users[index], dates[index], source.delivered(index));
+}
+
+VoteSpan
+PlayerIndex::find(std::string_view username) const {
+    auto user = votes.table().find(username);
+    // names interned into the shared table after the index was built have no votes here
+    if (!user || *user + 1 >= offsets.size())
+        return {votes, 0, 0};
+    return {votes, offsets[*user], offsets[*user + 1] - offsets[*user]};
+}
+
+PlayerInfo
+PlayerIndex::player(const std::string &username, std::int64_t now) const {
+    const auto run = find(username);
+    const auto dates = run.date_column();
+    const auto users = run.user_column();
+
+    VoteColumns columns(votes.shared_table());
+    columns.reserve(run.size());
+    for (std::size_t index = 0; index < run.size(); ++index)
+        columns.push_back(users[index], dates[index], run.delivered(index));
+    auto next_vote = run.empty() ? now : std::max(now, dates.front() + VOTE_INTERVAL);
+    return PlayerInfo(username, next_vote, static_cast<int>(run.size()), std::move(columns));
+}
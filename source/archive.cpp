@@ -0,0 +1,449 @@
+#include "archive.hpp"
+#include "batch.hpp"
+#include "cache.hpp"
+#include "timefmt.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <unistd.h>
+#endif
+
+using namespace ccapi;
+
+namespace {
+
+    /**
+     * Header of a month block, followed by its records. A record is the date (int64), the delivered
+     * flag (uint8), the username length (uint16) and the username.
+     */
+    struct BlockHeader {
+        char magic[4];
+        std::uint16_t year;
+        std::uint8_t month;
+        std::uint8_t final;
+        std::int32_t vote_count;
+        std::uint32_t record_count;
+        std::uint64_t payload_size;
+    };
+
+    constexpr char MAGIC[4] = {'C', 'C', 'V', 'B'};
+    constexpr StringTable::Id NO_ID = std::numeric_limits<StringTable::Id>::max();
+
+    YearMonth month_of(std::int64_t date) {
+        auto tm = fromEpoch(date);
+        return {tm.tm_year + 1900, tm.tm_mon + 1};
+    }
+
+    std::int64_t now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    /**
+     * @param received When the votes were received, a month received before it was over may still miss some
+     */
+    bool is_final(YearMonth month, std::int64_t received) {
+        return received >= monthFinal(month.month, month.year);
+    }
+
+    // vote dates are in the frame of the API, and so are their months
+    YearMonth current_month() {
+        return month_of(apiNow());
+    }
+
+    /**
+     * @returns The month block as it is stored in the file, header included
+     */
+    std::string encode(YearMonth month, bool final, int vote_count, const VoteColumns &votes) {
+        std::string payload;
+        for (auto vote : votes) {
+            auto length = static_cast<std::uint16_t>(std::min<std::size_t>(vote.username.size(), UINT16_MAX));
+            payload.append(reinterpret_cast<const char *>(&vote.date), sizeof(vote.date));
+            payload.push_back(static_cast<char>(vote.delivered));
+            payload.append(reinterpret_cast<const char *>(&length), sizeof(length));
+            payload.append(vote.username.substr(0, length));
+        }
+
+        BlockHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.year = static_cast<std::uint16_t>(month.year);
+        header.month = static_cast<std::uint8_t>(month.month);
+        header.final = final;
+        header.vote_count = vote_count;
+        header.record_count = static_cast<std::uint32_t>(votes.size());
+        header.payload_size = payload.size();
+
+        std::string bytes(reinterpret_cast<const char *>(&header), sizeof(header));
+        bytes += payload;
+        return bytes;
+    }
+
+    /**
+     * Advisory lock on the archive of a server, shared by readers and exclusive to the process which writes it.
+     * Held until destroyed, released by the system when the process dies.
+     */
+    class FileLock {
+    public:
+        FileLock(const std::filesystem::path &path, bool exclusive) {
+#ifdef _WIN32
+            handle = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE,
+                                 FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_ALWAYS,
+                                 FILE_ATTRIBUTE_NORMAL, nullptr);
+            OVERLAPPED overlapped{};
+            if (handle == INVALID_HANDLE_VALUE
+                || !LockFileEx(handle, exclusive ? LOCKFILE_EXCLUSIVE_LOCK : 0, 0, MAXDWORD, MAXDWORD, &overlapped)) {
+                if (handle != INVALID_HANDLE_VALUE)
+                    CloseHandle(handle);
+                throw std::runtime_error(fmt::format("Failed to lock vote archive {}", path.string()));
+            }
+#else
+            descriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+            if (descriptor < 0)
+                throw std::runtime_error(fmt::format("Failed to lock vote archive {}", path.string()));
+            while (flock(descriptor, exclusive ? LOCK_EX : LOCK_SH) != 0) {
+                if (errno != EINTR) {
+                    ::close(descriptor);
+                    throw std::runtime_error(fmt::format("Failed to lock vote archive {}", path.string()));
+                }
+            }
+#endif
+        }
+
+        ~FileLock() {
+#ifdef _WIN32
+            CloseHandle(handle);
+#else
+            ::close(descriptor);
+#endif
+        }
+
+        FileLock(const FileLock &) = delete;
+        FileLock &operator=(const FileLock &) = delete;
+
+    private:
+#ifdef _WIN32
+        HANDLE handle;
+#else
+        int descriptor;
+#endif
+    };
+
+    /**
+     * Orders votes by date, keeping the original order of votes with the same date.
+     */
+    VoteColumns sorted(const VoteColumns &votes, bool newest_first) {
+        std::vector<std::size_t> order(votes.size());
+        std::iota(order.begin(), order.end(), 0);
+        auto dates = votes.date_column();
+        std::stable_sort(order.begin(), order.end(), [&](auto left, auto right) {
+            return newest_first ? dates[left] > dates[right] : dates[left] < dates[right];
+        });
+
+        VoteColumns result(votes.shared_table());
+        result.reserve(votes.size());
+        for (auto index : order)
+            result.push_back(votes.user_column()[index], dates[index], votes.delivered(index));
+        return result;
+    }
+}
+
+VoteArchive::VoteArchive(std::filesystem::path directory) : directory(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+}
+
+std::filesystem::path
+VoteArchive::defaultDirectory() {
+    if (auto path = std::getenv("CC_CLI_ARCHIVE_DIR"))
+        return path;
+#ifdef _WIN32
+    if (auto path = std::getenv("LOCALAPPDATA"))
+        return std::filesystem::path(path) / "cc-cli" / "archive";
+#else
+    if (auto path = std::getenv("XDG_DATA_HOME"))
+        return std::filesystem::path(path) / "cc-cli" / "archive";
+    if (auto path = std::getenv("HOME"))
+        return std::filesystem::path(path) / ".local" / "share" / "cc-cli" / "archive";
+#endif
+    return detail::privateTempDirectory() / "archive";
+}
+
+std::filesystem::path
+VoteArchive::path(const std::string &slug) const {
+    std::string name;
+    for (auto c : slug) {
+        if (std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '_')
+            name.push_back(c);
+        else
+            name += fmt::format("%{:02x}", static_cast<unsigned char>(c));
+    }
+    return directory / (name + ".votes");
+}
+
+std::filesystem::path
+VoteArchive::lockPath(const std::string &slug) const {
+    auto file = path(slug);
+    file.replace_extension(".lock");
+    return file;
+}
+
+std::vector<std::string>
+VoteArchive::slugs() const {
+    std::vector<std::string> found;
+    std::error_code error;
+    for (const auto &file : std::filesystem::directory_iterator(directory, error)) {
+        if (file.path().extension() != ".votes")
+            continue;
+        // undoes the escaping of path()
+        auto name = file.path().stem().string();
+        std::string slug;
+        for (std::size_t index = 0; index < name.size(); ++index) {
+            if (name[index] == '%' && index + 2 < name.size()) {
+                slug.push_back(static_cast<char>(std::stoi(name.substr(index + 1, 2), nullptr, 16)));
+                index += 2;
+            } else {
+                slug.push_back(name[index]);
+            }
+        }
+        found.push_back(std::move(slug));
+    }
+    std::sort(found.begin(), found.end());
+    return found;
+}
+
+VoteArchive::Months
+VoteArchive::load(const std::string &slug) const {
+    Months months;
+    auto file = MappedFile::open(path(slug));
+    if (!file)
+        return months;
+
+    auto names = std::make_shared<StringTable>();
+    auto data = file->data();
+    std::size_t offset = 0;
+    BlockHeader header{};
+    while (data.size() - offset >= sizeof(header)) {
+        std::memcpy(&header, data.data() + offset, sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.month < 1 || header.month > 12
+            || data.size() - offset - sizeof(header) < header.payload_size)
+            break; // torn write at the end of the file
+
+        Block block{header.vote_count, header.final != 0, VoteColumns(names), sizeof(header) + header.payload_size};
+        block.votes.reserve(header.record_count);
+        auto payload = data.substr(offset + sizeof(header), header.payload_size);
+        std::size_t position = 0;
+        std::uint32_t record = 0;
+        for (; record < header.record_count; ++record) {
+            std::int64_t date;
+            std::uint16_t length;
+            if (payload.size() - position < sizeof(date) + 1 + sizeof(length))
+                break;
+            std::memcpy(&date, payload.data() + position, sizeof(date));
+            bool delivered = payload[position + sizeof(date)] != 0;
+            std::memcpy(&length, payload.data() + position + sizeof(date) + 1, sizeof(length));
+            position += sizeof(date) + 1 + sizeof(length);
+            if (payload.size() - position < length)
+                break;
+            block.votes.push_back(payload.substr(position, length), date, delivered);
+            position += length;
+        }
+        if (record < header.record_count)
+            break; // records cut short, the block was written in part
+
+        offset += sizeof(header) + header.payload_size;
+        auto [found, inserted] = months.blocks.try_emplace(YearMonth{header.year, header.month}, std::move(block));
+        if (!inserted) {
+            months.superseded += found->second.size;
+            found->second = std::move(block);
+        }
+    }
+    months.end = offset;
+    months.torn = offset < data.size();
+    return months;
+}
+
+VoteArchive::Months &
+VoteArchive::months(const std::string &slug) const {
+    auto found = loaded.find(slug);
+    if (found == loaded.end()) {
+        // a writer cuts off torn blocks, which must not happen while the file is mapped here
+        FileLock file(lockPath(slug), false);
+        found = loaded.emplace(slug, load(slug)).first;
+    }
+    return found->second;
+}
+
+void
+VoteArchive::store(const std::string &slug, Months &months, std::map<YearMonth, Block> added) const {
+    std::vector<std::pair<YearMonth, std::string>> encoded;
+    for (auto &[month, block] : added) {
+        auto &bytes = encoded.emplace_back(month, encode(month, block.final, block.vote_count, block.votes)).second;
+        block.size = bytes.size();
+        if (auto found = months.blocks.find(month); found != months.blocks.end())
+            months.superseded += found->second.size;
+        months.blocks.insert_or_assign(month, std::move(block));
+    }
+
+    std::uint64_t live = 0;
+    for (const auto &[month, block] : months.blocks)
+        live += block.size;
+
+    auto file = path(slug);
+    if (months.superseded <= live) {
+        // blocks appended after a torn one would never be read again, the torn one goes first
+        if (months.torn) {
+            std::filesystem::resize_file(file, months.end);
+            months.torn = false;
+        }
+        std::ofstream output(file, std::ios::binary | std::ios::app);
+        for (const auto &[month, bytes] : encoded) {
+            output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+            months.end += bytes.size();
+        }
+        if (!output)
+            throw std::runtime_error(fmt::format("Failed to write vote archive {}", file.string()));
+        return;
+    }
+
+    // superseded blocks outweigh the current ones, the file is rewritten aside and swapped in one step
+    static thread_local std::mt19937_64 random{std::random_device{}()};
+    auto compacted = file;
+    compacted += fmt::format(".{:016x}.tmp", random());
+    {
+        std::ofstream output(compacted, std::ios::binary | std::ios::trunc);
+        for (const auto &[month, block] : months.blocks) {
+            auto bytes = encode(month, block.final, block.vote_count, block.votes);
+            output.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+        }
+        output.close();
+        if (!output) {
+            std::error_code error;
+            std::filesystem::remove(compacted, error);
+            throw std::runtime_error(fmt::format("Failed to write vote archive {}", compacted.string()));
+        }
+    }
+    std::error_code error;
+    std::filesystem::rename(compacted, file, error);
+    if (error) {
+        std::filesystem::remove(compacted, error);
+        throw std::runtime_error(fmt::format("Failed to write vote archive {}", file.string()));
+    }
+    months.superseded = 0;
+    months.end = live;
+    months.torn = false;
+}
+
+VoteArchive::SyncReport
+VoteArchive::sync(const std::string &slug, std::size_t parallel, Client &client) {
+    std::lock_guard guard(lock);
+    // other processes may sync the same server, the file is read again once no one else writes it
+    FileLock file(lockPath(slug), true);
+    auto &archived = loaded.insert_or_assign(slug, load(slug)).first->second;
+    const auto &blocks = archived.blocks;
+    auto current = current_month();
+    SyncReport report{0, 0, 0};
+
+    // responses are received after this, or come from the cache, which keeps a month for good only when it
+    // stored the month after it was over and revalidates it otherwise
+    const auto started = now();
+
+    if (blocks.empty()) {
+        // first sync, the whole history in one request, split into months
+        std::map<YearMonth, Block> split;
+        auto names = std::make_shared<StringTable>();
+        streamServerVotes(slug, [&](const Vote &vote) {
+            auto &block = split.try_emplace(month_of(vote.date), Block{0, false, VoteColumns(names)}).first->second;
+            block.votes.push_back(vote.username, vote.date, vote.delivered);
+            ++block.vote_count;
+        }, client);
+
+        // months without votes are archived too, so the next sync does not fetch them
+        auto first = split.empty() ? current : split.begin()->first;
+        for (auto month = first; month <= current; month = month.next())
+            split.try_emplace(month, Block{0, false, VoteColumns(names)});
+
+        // the all-time listing is not monthly, a cached one may be as old as its time to live
+        auto received = started;
+        if (auto cache = client.cache())
+            received -= std::min<std::int64_t>(cache->ttl(Endpoint::server_votes).count(), started);
+        for (auto &[month, block] : split) {
+            block.final = is_final(month, received);
+            block.votes = sorted(block.votes, false);
+            report.archived_votes += block.votes.size();
+        }
+        report.requests = 1;
+        report.archived_months = split.size();
+        store(slug, archived, std::move(split));
+        return report;
+    }
+
+    // every month which was not over when it was fetched, and the months since the last one up to the current month
+    std::vector<YearMonth> missing;
+    for (const auto &[month, block] : blocks) {
+        if (!block.final)
+            missing.push_back(month);
+    }
+    for (auto month = blocks.rbegin()->first.next(); month <= current; month = month.next())
+        missing.push_back(month);
+
+    Batch batch(client);
+    for (auto month : missing)
+        batch.serverVotes(slug, month.month, month.year);
+    batch.run(parallel);
+
+    std::map<YearMonth, Block> fetched;
+    for (std::size_t index = 0; index < missing.size(); ++index) {
+        const auto &votes = batch.get<VoteVector>(index);
+        Block block{votes.vote_count, is_final(missing[index], started), sorted(votes.votes, false)};
+        report.archived_votes += block.votes.size();
+        fetched.insert_or_assign(missing[index], std::move(block));
+    }
+    report.requests = report.archived_months = missing.size();
+    store(slug, archived, std::move(fetched));
+    return report;
+}
+
+std::optional<VoteVector>
+VoteArchive::month(const std::string &slug, int month, int year) const {
+    std::lock_guard guard(lock);
+    const auto &blocks = months(slug).blocks;
+    auto found = blocks.find(YearMonth{year, month});
+    if (found == blocks.end() || !found->second.final)
+        return std::nullopt;
+
+    // a table of its own with the names of this month only, the cached one holds every month and keeps
+    // growing with later syncs, every name is interned once, not once per vote
+    auto ordered = sorted(found->second.votes, true);
+    VoteColumns votes;
+    std::vector<StringTable::Id> interned(ordered.table().size(), NO_ID);
+    votes.reserve(ordered.size());
+    for (std::size_t index = 0; index < ordered.size(); ++index) {
+        auto user = ordered.user_column()[index];
+        if (interned[user] == NO_ID)
+            interned[user] = votes.shared_table()->intern(ordered.table()[user]);
+        votes.push_back(interned[user], ordered.date_column()[index], ordered.delivered(index));
+    }
+    return VoteVector{std::move(votes), found->second.vote_count};
+}
+
+VoteColumns
+VoteArchive::history(const std::string &slug) const {
+    std::lock_guard guard(lock);
+    VoteColumns votes;
+    for (const auto &[month, block] : months(slug).blocks)
+        votes.append(block.votes);
+    return votes;
+}
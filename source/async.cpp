@@ -0,0 +1,486 @@
+#include "async.hpp"
+#include "decode.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <winsock2.h>
+#else
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+using namespace ccapi;
+
+#ifdef _WIN32
+using pollfd_type = WSAPOLLFD;
+static int poll_sockets(pollfd_type *fds, std::size_t count, int timeout) {
+    // there is no wake-up descriptor on Windows, new requests are picked up on the next short timeout
+    if (count == 0) {
+        Sleep(static_cast<DWORD>(timeout));
+        return 0;
+    }
+    return WSAPoll(fds, static_cast<ULONG>(count), timeout);
+}
+static constexpr int MAX_WAIT = 10;
+#else
+using pollfd_type = pollfd;
+static int poll_sockets(pollfd_type *fds, std::size_t count, int timeout) {
+    return poll(fds, count, timeout);
+}
+static constexpr int MAX_WAIT = 1000;
+#endif
+
+/**
+ * Request queued on the event loop, decoding its response into the shared state of a future
+ * while the response is received.
+ */
+class detail::AsyncOperation {
+public:
+    /**
+     * Parser and cache writer of a transfer in progress.
+     */
+    struct Stream {
+        Stream(JsonHandler &handler, CachedRequest &request) : stream(handler), tee(request.writer()) {}
+
+        JsonStream stream;
+        std::optional<ResponseCache::Writer> tee;
+        StreamTarget target{};
+    };
+
+    explicit AsyncOperation(std::shared_ptr<JsonHandler> handler) : handler(std::move(handler)) {}
+    virtual ~AsyncOperation() = default;
+
+    /**
+     * Ends the decoding and takes the result, an error of either fails the operation.
+     *
+     * @returns Whether the result was taken
+     */
+    virtual bool complete(const std::function<void()> &decode) = 0;
+
+    virtual void fail(std::exception_ptr error) = 0;
+
+    /**
+     * Decodes a whole body at once, such as a cached one.
+     */
+    bool decode(std::string_view body) {
+        return complete([&] {
+            trace.parse([&] {
+                JsonStream whole(*handler);
+                whole.feed(body.data(), body.size());
+                whole.finish();
+            });
+        });
+    }
+
+    std::unique_ptr<CachedRequest> request;
+    std::shared_ptr<JsonHandler> handler;
+    std::unique_ptr<Stream> stream; // of the current attempt
+    RequestTrace trace;
+    int attempt = 1;
+};
+
+template<typename T>
+class TypedOperation : public detail::AsyncOperation {
+public:
+    TypedOperation(std::shared_ptr<detail::SharedState<T>> state, detail::StreamDecoder<T> decoder)
+    : AsyncOperation(std::move(decoder.handler)), state(std::move(state)), result(std::move(decoder.result)) {}
+
+    bool complete(const std::function<void()> &decode) override {
+        std::optional<T> value;
+        try {
+            decode();
+            value.emplace(result());
+        } catch (...) {
+            fail(std::current_exception());
+            return false;
+        }
+        trace.finish();
+        state->set_value(std::move(*value));
+        return true;
+    }
+
+    void fail(std::exception_ptr error) override {
+        trace.finish();
+        state->set_error(std::move(error));
+    }
+
+private:
+    std::shared_ptr<detail::SharedState<T>> state;
+    std::function<T()> result;
+};
+
+AsyncClient::AsyncClient(Client &client, std::size_t max_connections) : client(client) {
+    // handles are configured by the client, which also initializes CURL globally
+    client.release(client.acquire());
+
+    multi = curl_multi_init();
+    if (!multi)
+        throw std::runtime_error("Failed to initialize CURL multi handle");
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, AsyncClient::on_socket);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, AsyncClient::on_timer);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX); // HTTP/2 streams share a connection
+    curl_multi_setopt(multi, CURLMOPT_MAX_TOTAL_CONNECTIONS, static_cast<long>(std::max<std::size_t>(max_connections, 1)));
+
+#ifndef _WIN32
+    if (pipe(wake_pipe) != 0) {
+        curl_multi_cleanup(multi);
+        throw std::runtime_error("Failed to create event loop wake-up pipe");
+    }
+    for (auto fd : wake_pipe)
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#endif
+
+    loop = std::thread([this] { run(); });
+}
+
+AsyncClient::~AsyncClient() {
+    {
+        std::lock_guard guard(queue_lock);
+        stopping = true;
+    }
+    wake();
+    loop.join();
+
+    curl_multi_cleanup(multi);
+#ifndef _WIN32
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+#endif
+}
+
+template<typename T>
+Future<T>
+AsyncClient::submit(std::string context, Endpoint endpoint, std::int64_t final_since, detail::StreamDecoder<T> decoder) {
+    auto state = std::make_shared<detail::SharedState<T>>();
+    auto operation = std::make_unique<TypedOperation<T>>(state, std::move(decoder));
+    operation->request = std::make_unique<detail::CachedRequest>(client.cache(), client.baseUrl(), std::move(context),
+                                                                endpoint, final_since);
+    {
+        std::lock_guard guard(queue_lock);
+        if (stopping)
+            throw std::runtime_error("Asynchronous client is shutting down");
+        queue.push_back(std::move(operation));
+    }
+    wake();
+    return Future<T>(std::move(state));
+}
+
+template<typename Api>
+Future<typename Api::Result>
+AsyncClient::submit(const Api &api, std::size_t limit) {
+    return submit<typename Api::Result>(api.context(), api.endpoint(), detail::final_since(api),
+                                        detail::stream_decoder(api, limit));
+}
+
+Future<ServerInfo>
+AsyncClient::serverInfo(const std::string &slug) {
+    return submit(api::ServerInfo{slug});
+}
+
+Future<VoteVector>
+AsyncClient::serverVotes(const std::string &slug) {
+    return submit(api::ServerVotes{slug});
+}
+
+Future<VoteVector>
+AsyncClient::serverVotes(const std::string &slug, std::size_t limit) {
+    return submit(api::ServerVotes{slug}, limit);
+}
+
+Future<VoteVector>
+AsyncClient::serverVotes(const std::string &slug, const int &month, const int &year) {
+    return submit(api::ServerVotesMonth{slug, month, year});
+}
+
+Future<std::list<VoterInfo>>
+AsyncClient::topVoters(const std::string &slug) {
+    return submit(api::TopVoters{slug});
+}
+
+Future<std::list<VoterInfo>>
+AsyncClient::topVoters(const std::string &slug, std::size_t limit) {
+    return submit(api::TopVoters{slug}, limit);
+}
+
+Future<PlayerInfo>
+AsyncClient::userVotes(const std::string &username, const std::string &slug) {
+    return submit(api::UserVotes{username, slug});
+}
+
+Future<PlayerInfo>
+AsyncClient::userVotes(const std::string &username, const std::string &slug, const int &month, const int &year) {
+    return submit(api::UserVotesMonth{username, slug, month, year});
+}
+
+Future<PlayerInfo>
+AsyncClient::nextVote(const std::string &username, const std::string &slug) {
+    return submit(api::NextVote{username, slug});
+}
+
+void
+AsyncClient::wake() {
+#ifndef _WIN32
+    char byte = 0;
+    [[maybe_unused]] auto written = write(wake_pipe[1], &byte, 1); // a full pipe already wakes the loop
+#endif
+}
+
+void
+AsyncClient::run() {
+    std::vector<pollfd_type> fds;
+    std::deque<std::unique_ptr<detail::AsyncOperation>> submitted;
+
+    while (true) {
+        {
+            std::lock_guard guard(queue_lock);
+            if (stopping)
+                break;
+            submitted.swap(queue);
+        }
+        for (auto &operation : submitted)
+            waiting.push_back(std::move(operation));
+        submitted.clear();
+        admit();
+
+        fds.clear();
+#ifndef _WIN32
+        fds.push_back(pollfd_type{wake_pipe[0], POLLIN, 0});
+#endif
+        for (const auto &[socket, what] : sockets) {
+            short events = 0;
+            if (what & CURL_POLL_IN)
+                events |= POLLIN;
+            if (what & CURL_POLL_OUT)
+                events |= POLLOUT;
+            fds.push_back(pollfd_type{socket, events, 0});
+        }
+
+        // wakes up for curl, the first delayed call, or the scheduler to admit waiting ones
+        auto now = std::chrono::steady_clock::now();
+        auto wake_at = deadline;
+        if (!delayed.empty())
+            wake_at = std::min(wake_at.value_or(delayed.begin()->first), delayed.begin()->first);
+        if (!waiting.empty()) {
+            auto scheduler = client.scheduler();
+            auto resume = std::max(now + std::chrono::milliseconds(10), scheduler ? scheduler->resumeAt() : now);
+            wake_at = std::min(wake_at.value_or(resume), resume);
+        }
+        auto timeout = MAX_WAIT;
+        if (wake_at) {
+            auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*wake_at - now).count();
+            timeout = static_cast<int>(std::clamp<long long>(remaining, 0, MAX_WAIT));
+        }
+
+        if (poll_sockets(fds.data(), fds.size(), timeout) > 0) {
+            for (const auto &fd : fds) {
+                if (!fd.revents)
+                    continue;
+#ifndef _WIN32
+                if (fd.fd == wake_pipe[0]) {
+                    char buffer[64];
+                    while (read(wake_pipe[0], buffer, sizeof(buffer)) > 0) {}
+                    continue;
+                }
+#endif
+                int events = 0;
+                if (fd.revents & (POLLIN | POLLHUP))
+                    events |= CURL_CSELECT_IN;
+                if (fd.revents & POLLOUT)
+                    events |= CURL_CSELECT_OUT;
+                if (fd.revents & (POLLERR | POLLNVAL))
+                    events |= CURL_CSELECT_ERR;
+                action(fd.fd, events);
+            }
+        }
+
+        if (deadline && std::chrono::steady_clock::now() >= *deadline) {
+            deadline.reset();
+            action(CURL_SOCKET_TIMEOUT, 0);
+        }
+        admit();
+    }
+
+    // fails everything still queued or in flight
+    auto shutdown = std::make_exception_ptr(std::runtime_error("Asynchronous client was shut down"));
+    for (auto &[handle, operation] : active) {
+        curl_multi_remove_handle(multi, handle);
+        client.release(handle);
+        if (auto scheduler = client.scheduler())
+            scheduler->release();
+        operation->fail(shutdown);
+    }
+    active.clear();
+    for (auto &operation : waiting)
+        operation->fail(shutdown);
+    waiting.clear();
+    for (auto &[time, operation] : delayed)
+        operation->fail(shutdown);
+    delayed.clear();
+    // failing runs continuations, which may submit again, so the queue is not locked meanwhile
+    std::deque<std::unique_ptr<detail::AsyncOperation>> queued;
+    {
+        std::lock_guard guard(queue_lock);
+        queued.swap(queue);
+    }
+    for (auto &operation : queued)
+        operation->fail(shutdown);
+}
+
+void
+AsyncClient::admit() {
+    auto scheduler = client.scheduler();
+    for (;;) {
+        auto due = !delayed.empty() && delayed.begin()->first <= std::chrono::steady_clock::now();
+        if (!due && waiting.empty())
+            return;
+        if (scheduler && !scheduler->tryAcquire())
+            return;
+
+        // repeated calls go first once their delay is over
+        std::unique_ptr<detail::AsyncOperation> operation;
+        if (due) {
+            operation = std::move(delayed.begin()->second);
+            delayed.erase(delayed.begin());
+        } else {
+            operation = std::move(waiting.front());
+            waiting.pop_front();
+        }
+        if (!start(operation) && scheduler)
+            scheduler->release();
+    }
+}
+
+bool
+AsyncClient::start(std::unique_ptr<detail::AsyncOperation> &operation) {
+    operation->trace = detail::RequestTrace(client.tracer(), operation->request->context());
+    if (auto body = operation->request->fresh()) {
+        operation->decode(*body);
+        return false;
+    }
+
+    CURL *handle;
+    try {
+        handle = client.acquire();
+    } catch (...) {
+        operation->fail(std::current_exception());
+        return false;
+    }
+
+    curl_easy_setopt(handle, CURLOPT_URL, detail::url(client, operation->request->context()).c_str());
+    operation->stream = std::make_unique<detail::AsyncOperation::Stream>(*operation->handler, *operation->request);
+    auto &stream = *operation->stream;
+    stream.target = {handle, &stream.stream, stream.tee ? &*stream.tee : nullptr, nullptr, &operation->trace};
+    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, detail::stream_writer);
+    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &stream.target);
+    operation->request->prepare(handle);
+
+    auto code = curl_multi_add_handle(multi, handle);
+    if (code != CURLM_OK) {
+        client.release(handle);
+        operation->stream.reset();
+        operation->fail(std::make_exception_ptr(std::runtime_error(fmt::format("CURL multi failed with error {}", code))));
+        return false;
+    }
+    active.emplace(handle, std::move(operation));
+    return true;
+}
+
+void
+AsyncClient::action(curl_socket_t socket, int events) {
+    int running;
+    curl_multi_socket_action(multi, socket, events, &running);
+
+    CURLMsg *message;
+    int queued;
+    while ((message = curl_multi_info_read(multi, &queued))) {
+        if (message->msg == CURLMSG_DONE)
+            complete(message->easy_handle, message->data.result);
+    }
+}
+
+void
+AsyncClient::complete(CURL *handle, CURLcode result) {
+    auto found = active.find(handle);
+    auto operation = std::move(found->second);
+    active.erase(found);
+    curl_multi_remove_handle(multi, handle);
+
+    auto stream = std::move(operation->stream);
+    if (auto scheduler = client.scheduler()) {
+        // a decoder which had enough ends the transfer on purpose, error bodies never reach it
+        const bool stopped = !stream->target.error && stream->stream.stopped();
+        auto decision = scheduler->finished(handle, stopped ? CURLE_OK : result, operation->attempt,
+                                            !stream->target.fed);
+        scheduler->release();
+        if (decision.retry) {
+            ++operation->attempt;
+            operation->trace.transferred(handle, false);
+            client.release(handle);
+            delayed.emplace(std::chrono::steady_clock::now() + decision.delay, std::move(operation));
+            return;
+        }
+    }
+
+    std::optional<std::string_view> cached;
+    try {
+        if (stream->target.error)
+            std::rethrow_exception(stream->target.error);
+        if (stream->stream.stopped()) {
+            operation->trace.transferred(handle, false);
+        } else {
+            cached = result == CURLE_OK ? operation->request->not_modified(handle) : std::nullopt;
+            operation->trace.transferred(handle, cached.has_value());
+            if (!cached)
+                detail::check(handle, result);
+        }
+    } catch (...) {
+        client.release(handle);
+        operation->fail(std::current_exception());
+        return;
+    }
+    client.release(handle);
+
+    if (cached) {
+        operation->decode(*cached);
+        return;
+    }
+    operation->complete([&] {
+        // a stopped transfer received only a part of the body, which is not cached
+        if (stream->stream.stopped())
+            return;
+        stream->stream.finish();
+        if (stream->tee) {
+            try {
+                operation->request->commit(*stream->tee);
+            } catch (...) {} // a failed cache write only costs a later transfer
+        }
+    });
+}
+
+int
+AsyncClient::on_socket(CURL *, curl_socket_t socket, int what, void *userp, void *) {
+    auto self = static_cast<AsyncClient *>(userp);
+    if (what == CURL_POLL_REMOVE)
+        self->sockets.erase(socket);
+    else
+        self->sockets[socket] = what;
+    return 0;
+}
+
+int
+AsyncClient::on_timer(CURLM *, long timeout_ms, void *userp) {
+    auto self = static_cast<AsyncClient *>(userp);
+    if (timeout_ms < 0)
+        self->deadline.reset();
+    else
+        self->deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+    return 0;
+}
@@ -0,0 +1,325 @@
+#include "batch.hpp"
+#include "decode.hpp"
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+using namespace ccapi;
+
+/**
+ * Parser and cache writer of a transfer decoded while it is received.
+ */
+struct Batch::Stream {
+    Stream(detail::JsonHandler &handler, detail::CachedRequest &request) : stream(handler), tee(request.writer()) {}
+
+    detail::JsonStream stream;
+    std::optional<ResponseCache::Writer> tee;
+    detail::StreamTarget target{};
+};
+
+Batch::Batch(Client &client) : client(client) {}
+
+Batch::~Batch() = default;
+
+std::size_t
+Batch::push(std::string context, Endpoint endpoint, std::int64_t final_since, std::shared_ptr<detail::JsonHandler> handler,
+            std::function<Result()> produce) {
+    // cached bodies are fed to the same handler at once
+    auto decode = [handler, produce](std::string_view response) {
+        detail::JsonStream stream(*handler);
+        stream.feed(response.data(), response.size());
+        stream.finish();
+        return produce();
+    };
+    auto request = std::make_unique<detail::CachedRequest>(client.cache(), client.baseUrl(), std::move(context), endpoint,
+                                                           final_since);
+    entries.push_back(Entry{std::move(request), std::move(decode), {}, {}, {}, std::move(handler), std::move(produce), {}, 1});
+    return entries.size() - 1;
+}
+
+template<typename Api>
+std::size_t
+Batch::push(const Api &api, std::size_t limit) {
+    auto decoder = detail::stream_decoder(api, limit);
+    return push(api.context(), api.endpoint(), detail::final_since(api), std::move(decoder.handler),
+                [result = std::move(decoder.result)] { return Result(result()); });
+}
+
+std::size_t
+Batch::serverInfo(const std::string &slug) {
+    return push(api::ServerInfo{slug});
+}
+
+std::size_t
+Batch::serverVotes(const std::string &slug) {
+    return push(api::ServerVotes{slug});
+}
+
+std::size_t
+Batch::serverVotes(const std::string &slug, std::size_t limit) {
+    return push(api::ServerVotes{slug}, limit);
+}
+
+std::size_t
+Batch::serverVotes(const std::string &slug, const int &month, const int &year) {
+    return push(api::ServerVotesMonth{slug, month, year});
+}
+
+std::size_t
+Batch::topVoters(const std::string &slug) {
+    return push(api::TopVoters{slug});
+}
+
+std::size_t
+Batch::topVoters(const std::string &slug, std::size_t limit) {
+    return push(api::TopVoters{slug}, limit);
+}
+
+std::size_t
+Batch::countedTopVoters(const std::string &slug, std::size_t limit) {
+    return push(api::CountedTopVoters{slug}, limit);
+}
+
+std::size_t
+Batch::userVotes(const std::string &username, const std::string &slug) {
+    return push(api::UserVotes{username, slug});
+}
+
+std::size_t
+Batch::userVotes(const std::string &username, const std::string &slug, const int &month, const int &year) {
+    return push(api::UserVotesMonth{username, slug, month, year});
+}
+
+std::size_t
+Batch::nextVote(const std::string &username, const std::string &slug) {
+    return push(api::NextVote{username, slug});
+}
+
+void
+Batch::run(std::size_t max_in_flight) {
+    using clock_type = RequestScheduler::clock_type;
+
+    auto multi = curl_multi_init();
+    if (!multi)
+        throw std::runtime_error("Failed to initialize CURL multi handle");
+    curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX); // HTTP/2 streams share a connection
+
+    auto scheduler = client.scheduler();
+    max_in_flight = std::max<std::size_t>(max_in_flight, 1);
+    std::vector<CURL *> active;
+    std::size_t next = 0;
+    std::vector<std::pair<clock_type::time_point, Entry *>> delayed; // failed requests and when to repeat them
+
+    // decodes the result of a finished request, keeping its error instead when it fails
+    auto complete = [&](Entry &entry, auto &&produce) {
+        try {
+            entry.result = produce();
+        } catch (...) {
+            entry.error = std::current_exception();
+        }
+    };
+
+    // returns whether a transfer started, fresh cached entries are decoded at once
+    auto start = [&](Entry &entry) {
+        entry.trace = detail::RequestTrace(client.tracer(), entry.request->context());
+        if (auto body = entry.request->fresh()) {
+            complete(entry, [&] { return entry.trace.parse([&] { return entry.decode(*body); }); });
+            entry.trace.finish();
+            return false;
+        }
+
+        // the request fails alone, and the permit it was admitted with goes back as it did not start
+        CURL *handle;
+        try {
+            handle = client.acquire();
+        } catch (...) {
+            entry.error = std::current_exception();
+            entry.trace.finish();
+            return false;
+        }
+        active.push_back(handle);
+
+        curl_easy_setopt(handle, CURLOPT_URL, detail::url(client, entry.request->context()).c_str());
+        entry.stream = std::make_unique<Stream>(*entry.handler, *entry.request);
+        auto &stream = *entry.stream;
+        stream.target = {handle, &stream.stream, stream.tee ? &*stream.tee : nullptr, nullptr, &entry.trace};
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, detail::stream_writer);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &stream.target);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, &entry);
+        entry.request->prepare(handle);
+
+        auto code = curl_multi_add_handle(multi, handle);
+        if (code != CURLM_OK)
+            throw std::runtime_error(fmt::format("CURL multi failed with error {}", code));
+        return true;
+    };
+
+    auto finish = [&](CURL *handle) {
+        curl_multi_remove_handle(multi, handle);
+        active.erase(std::find(active.begin(), active.end(), handle));
+        client.release(handle);
+        if (scheduler)
+            scheduler->release();
+    };
+
+    // repeated requests go first once their delay is over
+    auto take = [&](clock_type::time_point now) -> Entry * {
+        auto due = std::find_if(delayed.begin(), delayed.end(), [&](const auto &item) { return item.first <= now; });
+        if (due != delayed.end()) {
+            auto entry = due->second;
+            delayed.erase(due);
+            return entry;
+        }
+        return next < entries.size() ? &entries[next++] : nullptr;
+    };
+    auto waiting = [&](clock_type::time_point now) {
+        return next < entries.size() || std::any_of(delayed.begin(), delayed.end(), [&](const auto &item) { return item.first <= now; });
+    };
+
+    try {
+        while (!active.empty() || next < entries.size() || !delayed.empty()) {
+            for (auto now = clock_type::now(); active.size() < max_in_flight && waiting(now); now = clock_type::now()) {
+                if (scheduler && !scheduler->tryAcquire())
+                    break;
+                if (!start(*take(now)) && scheduler)
+                    scheduler->release();
+            }
+
+            int running;
+            auto code = curl_multi_perform(multi, &running);
+            if (code != CURLM_OK)
+                throw std::runtime_error(fmt::format("CURL multi failed with error {}", code));
+
+            CURLMsg *message;
+            int queued;
+            while ((message = curl_multi_info_read(multi, &queued))) {
+                if (message->msg != CURLMSG_DONE)
+                    continue;
+
+                auto handle = message->easy_handle;
+                auto result = message->data.result;
+                Entry *entry;
+                curl_easy_getinfo(handle, CURLINFO_PRIVATE, &entry);
+
+                if (scheduler) {
+                    // a decoder which had enough ends the transfer on purpose, error bodies never reach it
+                    const auto &stream = *entry->stream;
+                    const bool stopped = !stream.target.error && stream.stream.stopped();
+                    auto decision = scheduler->finished(handle, stopped ? CURLE_OK : result, entry->attempt,
+                                                        !stream.target.fed);
+                    if (decision.retry) {
+                        ++entry->attempt;
+                        entry->trace.transferred(handle, false);
+                        entry->stream.reset();
+                        delayed.emplace_back(clock_type::now() + decision.delay, entry);
+                        finish(handle);
+                        continue;
+                    }
+                }
+
+                complete(*entry, [&] {
+                    auto &stream = *entry->stream;
+                    if (stream.target.error)
+                        std::rethrow_exception(stream.target.error);
+                    if (stream.stream.stopped()) {
+                        entry->trace.transferred(handle, false);
+                        return entry->produce();
+                    }
+
+                    auto cached = result == CURLE_OK ? entry->request->not_modified(handle) : std::nullopt;
+                    entry->trace.transferred(handle, cached.has_value());
+                    if (cached)
+                        return entry->trace.parse([&] { return entry->decode(*cached); });
+
+                    detail::check(handle, result);
+                    stream.stream.finish();
+                    if (stream.tee)
+                        entry->request->commit(*stream.tee);
+                    return entry->produce();
+                });
+                entry->trace.finish();
+                entry->stream.reset();
+                finish(handle);
+            }
+
+            // waits for transfers, the first delayed request, or the scheduler to admit what is left
+            auto now = clock_type::now();
+            auto timeout = std::chrono::milliseconds(1000);
+            for (const auto &item : delayed)
+                timeout = std::min(timeout, std::chrono::ceil<std::chrono::milliseconds>(item.first - now));
+            if (active.empty() && next < entries.size()) {
+                auto resume = scheduler ? scheduler->resumeAt() : now;
+                timeout = std::min(timeout, std::max<std::chrono::milliseconds>(
+                        std::chrono::milliseconds(10), std::chrono::ceil<std::chrono::milliseconds>(resume - now)));
+            }
+            if (running > 0 || !delayed.empty() || next < entries.size())
+                curl_multi_poll(multi, nullptr, 0, static_cast<int>(std::max<std::int64_t>(timeout.count(), 0)), nullptr);
+        }
+    } catch (...) {
+        while (!active.empty())
+            finish(active.back());
+        curl_multi_cleanup(multi);
+        throw;
+    }
+    curl_multi_cleanup(multi);
+}
+
+VoteVector
+ccapi::mergeMonths(const std::vector<const VoteVector *> &months) {
+    std::size_t total = 0;
+    for (auto month : months)
+        total += month->votes.size();
+
+    VoteVector merged;
+    merged.votes.reserve(total);
+    for (auto month : months) {
+        merged.votes.append(month->votes);
+        merged.vote_count += month->vote_count;
+    }
+    return merged;
+}
+
+VoteVector
+ccapi::serverVotes(const std::string &slug, YearMonth from, YearMonth to, std::size_t parallel, Client &client) {
+    Batch batch(client);
+    for (auto month = to; month >= from; month = month.previous())
+        batch.serverVotes(slug, month.month, month.year);
+    batch.run(parallel);
+
+    std::vector<const VoteVector *> months;
+    for (std::size_t index = 0; index < batch.size(); ++index)
+        months.push_back(&batch.get<VoteVector>(index));
+    return mergeMonths(months);
+}
+
+PlayerInfo
+ccapi::userVotes(const std::string &username, const std::string &slug, YearMonth from, YearMonth to,
+                 std::size_t parallel, Client &client) {
+    Batch batch(client);
+    auto next = batch.nextVote(username, slug);
+    std::vector<std::size_t> requests;
+    for (auto month = to; month >= from; month = month.previous())
+        requests.push_back(batch.userVotes(username, slug, month.month, month.year));
+    batch.run(parallel);
+
+    VoteVector merged;
+    for (auto index : requests) {
+        const auto &month = batch.get<PlayerInfo>(index);
+        merged.votes.append(month.votes);
+        merged.vote_count += month.vote_count;
+    }
+    return PlayerInfo{username, batch.get<PlayerInfo>(next).next_vote, merged.vote_count, std::move(merged.votes)};
+}
+
+void
+ccapi::indexTopVoters(VoterIndex &index, const std::vector<std::string> &slugs, std::size_t parallel, Client &client) {
+    Batch batch(client);
+    for (const auto &slug : slugs)
+        batch.topVoters(slug);
+    batch.run(parallel);
+
+    for (std::size_t request = 0; request < slugs.size(); ++request)
+        index.add(slugs[request], batch.get<std::list<VoterInfo>>(request));
+}
+
@@ -0,0 +1,484 @@
+#include "cache.hpp"
+#include "timefmt.hpp"
+
+#include <cctype>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <utility>
+
+#include <fmt/format.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace ccapi;
+
+namespace {
+
+    /**
+     * Layout of a cache file: this header, the body, then the context, ETag and Last-Modified strings.
+     */
+    struct FileHeader {
+        char magic[4];
+        std::uint32_t version;
+        std::int64_t stored_at;
+        std::uint64_t body_size;
+        std::uint32_t context_size;
+        std::uint32_t etag_size;
+        std::uint32_t last_modified_size;
+        std::uint32_t reserved;
+    };
+
+    constexpr char MAGIC[4] = {'C', 'C', 'R', 'C'};
+    constexpr std::uint32_t VERSION = 1;
+
+    std::int64_t now() {
+        return std::chrono::duration_cast<std::chrono::seconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    std::uint64_t fnv1a(std::string_view value) {
+        std::uint64_t hash = 0xcbf29ce484222325ull;
+        for (auto c : value) {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    bool starts_with_nocase(std::string_view line, std::string_view prefix) {
+        if (line.size() < prefix.size())
+            return false;
+        for (std::size_t index = 0; index < prefix.size(); ++index) {
+            if (std::tolower(static_cast<unsigned char>(line[index])) != prefix[index])
+                return false;
+        }
+        return true;
+    }
+
+    std::string_view trim(std::string_view value) {
+        while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+            value.remove_prefix(1);
+        while (!value.empty() && (value.back() == ' ' || value.back() == '\t' || value.back() == '\r' || value.back() == '\n'))
+            value.remove_suffix(1);
+        return value;
+    }
+}
+
+MappedFile::~MappedFile() {
+    unmap();
+}
+
+MappedFile::MappedFile(MappedFile &&other) noexcept {
+    *this = std::move(other);
+}
+
+MappedFile &
+MappedFile::operator=(MappedFile &&other) noexcept {
+    if (this != &other) {
+        unmap();
+        address = std::exchange(other.address, nullptr);
+        length = std::exchange(other.length, 0);
+#ifdef _WIN32
+        file = std::exchange(other.file, nullptr);
+        mapping = std::exchange(other.mapping, nullptr);
+#endif
+    }
+    return *this;
+}
+
+#ifdef _WIN32
+std::optional<MappedFile>
+MappedFile::open(const std::filesystem::path &path) {
+    MappedFile mapped;
+    mapped.file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (mapped.file == INVALID_HANDLE_VALUE) {
+        mapped.file = nullptr;
+        return std::nullopt;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(mapped.file, &size) || size.QuadPart == 0)
+        return std::nullopt;
+
+    mapped.mapping = CreateFileMappingW(mapped.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (!mapped.mapping)
+        return std::nullopt;
+
+    mapped.address = static_cast<const char *>(MapViewOfFile(mapped.mapping, FILE_MAP_READ, 0, 0, 0));
+    if (!mapped.address)
+        return std::nullopt;
+    mapped.length = static_cast<std::size_t>(size.QuadPart);
+    return mapped;
+}
+
+void
+MappedFile::unmap() {
+    if (address)
+        UnmapViewOfFile(address);
+    if (mapping)
+        CloseHandle(mapping);
+    if (file)
+        CloseHandle(file);
+    address = nullptr;
+    mapping = file = nullptr;
+    length = 0;
+}
+#else
+std::optional<MappedFile>
+MappedFile::open(const std::filesystem::path &path) {
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0)
+        return std::nullopt;
+
+    struct stat info{};
+    if (fstat(descriptor, &info) != 0 || info.st_size == 0) {
+        ::close(descriptor);
+        return std::nullopt;
+    }
+
+    auto address = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    ::close(descriptor);
+    if (address == MAP_FAILED)
+        return std::nullopt;
+
+    MappedFile mapped;
+    mapped.address = static_cast<const char *>(address);
+    mapped.length = static_cast<std::size_t>(info.st_size);
+    return mapped;
+}
+
+void
+MappedFile::unmap() {
+    if (address)
+        munmap(const_cast<char *>(address), length);
+    address = nullptr;
+    length = 0;
+}
+#endif
+
+ResponseCache::ResponseCache(std::filesystem::path directory) : directory(std::move(directory)) {
+    std::error_code error;
+    std::filesystem::create_directories(this->directory, error);
+}
+
+std::filesystem::path
+ResponseCache::defaultDirectory() {
+    if (auto path = std::getenv("CC_CLI_CACHE_DIR"))
+        return path;
+#ifdef _WIN32
+    if (auto path = std::getenv("LOCALAPPDATA"))
+        return std::filesystem::path(path) / "cc-cli" / "cache";
+#else
+    if (auto path = std::getenv("XDG_CACHE_HOME"))
+        return std::filesystem::path(path) / "cc-cli";
+    if (auto path = std::getenv("HOME"))
+        return std::filesystem::path(path) / ".cache" / "cc-cli";
+#endif
+    return detail::privateTempDirectory() / "cache";
+}
+
+std::filesystem::path
+ResponseCache::path(const std::string &context) const {
+    return directory / fmt::format("{:016x}", fnv1a(context));
+}
+
+std::optional<ResponseCache::Entry>
+ResponseCache::find(const std::string &context) const {
+    if (auto entry = remembered(context))
+        return entry;
+
+    auto file = MappedFile::open(path(context));
+    if (!file)
+        return std::nullopt;
+
+    auto data = file->data();
+    FileHeader header{};
+    if (data.size() < sizeof(header))
+        return std::nullopt;
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0 || header.version != VERSION)
+        return std::nullopt;
+    if (data.size() != sizeof(header) + header.body_size + header.context_size + header.etag_size + header.last_modified_size)
+        return std::nullopt;
+
+    auto offset = sizeof(header);
+    auto take = [&](std::size_t size) {
+        auto view = data.substr(offset, size);
+        offset += size;
+        return view;
+    };
+
+    Entry entry;
+    entry.stored_at = header.stored_at;
+    entry.body = take(header.body_size);
+    if (take(header.context_size) != context)
+        return std::nullopt; // hash collision
+    entry.etag = take(header.etag_size);
+    entry.last_modified = take(header.last_modified_size);
+    entry.file = std::make_shared<const MappedFile>(std::move(*file)); // moving keeps the mapped address, views stay valid
+    remember(context, entry);
+    return entry;
+}
+
+void
+ResponseCache::store(const std::string &context, std::string_view body, std::string_view etag,
+                     std::string_view last_modified) const {
+    Writer writer(*this, context);
+    writer.append(body);
+    writer.commit(etag, last_modified);
+}
+
+void
+ResponseCache::touch(const std::string &context) const {
+    // stored again like a new entry, other processes may have the current file mapped
+    auto entry = find(context);
+    if (!entry)
+        return;
+    store(context, entry->body, entry->etag, entry->last_modified);
+}
+
+std::chrono::seconds
+ResponseCache::ttl(Endpoint endpoint) const {
+    return ttls[static_cast<std::size_t>(endpoint)];
+}
+
+void
+ResponseCache::setTtl(Endpoint endpoint, std::chrono::seconds ttl) {
+    ttls[static_cast<std::size_t>(endpoint)] = ttl;
+}
+
+void
+ResponseCache::setMemoryEntries(std::size_t count) {
+    std::lock_guard guard(memory_lock);
+    memory_capacity = count;
+    while (memory.size() > memory_capacity) {
+        memory.erase(memory_order.back());
+        memory_order.pop_back();
+    }
+}
+
+std::optional<ResponseCache::Entry>
+ResponseCache::remembered(const std::string &context) const {
+    std::lock_guard guard(memory_lock);
+    auto found = memory.find(context);
+    if (found == memory.end())
+        return std::nullopt;
+    memory_order.splice(memory_order.begin(), memory_order, found->second.second);
+    return found->second.first;
+}
+
+void
+ResponseCache::remember(const std::string &context, const Entry &entry) const {
+    std::lock_guard guard(memory_lock);
+    if (memory_capacity == 0 || memory.count(context))
+        return;
+    if (memory.size() == memory_capacity) {
+        memory.erase(memory_order.back());
+        memory_order.pop_back();
+    }
+    memory_order.push_front(context);
+    memory.emplace(context, std::pair{entry, memory_order.begin()});
+}
+
+void
+ResponseCache::forget(const std::string &context) const {
+    std::lock_guard guard(memory_lock);
+    auto found = memory.find(context);
+    if (found == memory.end())
+        return;
+    memory_order.erase(found->second.second);
+    memory.erase(found);
+}
+
+ResponseCache::Writer::Writer(const ResponseCache &cache, const std::string &context)
+: cache(cache), target(cache.path(context)), context(context) {
+    static thread_local std::mt19937_64 random{std::random_device{}()};
+    temporary = target;
+    temporary += fmt::format(".{:016x}.tmp", random());
+
+    output.open(temporary, std::ios::binary | std::ios::trunc);
+    FileHeader header{};
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header)); // filled in on commit
+}
+
+ResponseCache::Writer::~Writer() {
+    if (committed)
+        return;
+    if (output.is_open())
+        output.close();
+    std::error_code error;
+    std::filesystem::remove(temporary, error);
+}
+
+void
+ResponseCache::Writer::append(std::string_view chunk) {
+    output.write(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+    body_size += chunk.size();
+}
+
+void
+ResponseCache::Writer::commit(std::string_view etag, std::string_view last_modified) {
+    FileHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.stored_at = now();
+    header.body_size = body_size;
+    header.context_size = static_cast<std::uint32_t>(context.size());
+    header.etag_size = static_cast<std::uint32_t>(etag.size());
+    header.last_modified_size = static_cast<std::uint32_t>(last_modified.size());
+
+    output.write(context.data(), static_cast<std::streamsize>(context.size()));
+    output.write(etag.data(), static_cast<std::streamsize>(etag.size()));
+    output.write(last_modified.data(), static_cast<std::streamsize>(last_modified.size()));
+    output.seekp(0);
+    output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+    output.close();
+    if (!output)
+        return; // the destructor removes what was written
+
+    std::error_code error;
+    std::filesystem::rename(temporary, target, error);
+    committed = !error;
+    if (committed)
+        cache.forget(context);
+}
+
+std::int64_t
+ccapi::monthFinal(int month, int year) {
+    // a day of margin, the API does not count months in UTC
+    auto next_year = month == 12 ? year + 1 : year;
+    auto next_month = month == 12 ? 1 : month + 1;
+    return (daysFromCivil(next_year, static_cast<unsigned>(next_month), 1) + 1) * 86400;
+}
+
+Endpoint
+ccapi::monthEndpoint(Endpoint endpoint, int month, int year) {
+    return now() >= monthFinal(month, year) ? Endpoint::past_month : endpoint;
+}
+
+detail::CachedRequest::CachedRequest(ResponseCache *cache, std::string_view base_url, std::string context, Endpoint endpoint,
+                                     std::int64_t final_since)
+: cache(cache), request_context(std::move(context)), key(fmt::format("{}{}", base_url, request_context)), endpoint(endpoint),
+  final_since(final_since) {}
+
+detail::CachedRequest::~CachedRequest() {
+    curl_slist_free_all(headers);
+}
+
+std::optional<std::string_view>
+detail::CachedRequest::fresh() {
+    if (!cache)
+        return std::nullopt;
+
+    entry = cache->find(key);
+    if (!entry)
+        return std::nullopt;
+    auto kind = endpoint;
+    if (final_since > 0 && entry->stored_at >= final_since)
+        kind = Endpoint::past_month;
+    else if (final_since > 0 && now() >= final_since)
+        return std::nullopt; // stored while the month was running, votes cast after that are missing
+    if (now() - entry->stored_at < cache->ttl(kind).count())
+        return entry->body;
+    return std::nullopt;
+}
+
+void
+detail::CachedRequest::prepare(CURL *handle) {
+    if (!cache)
+        return;
+
+    curl_easy_setopt(handle, CURLOPT_HEADERFUNCTION, header_writer);
+    curl_easy_setopt(handle, CURLOPT_HEADERDATA, this);
+    if (!entry)
+        return;
+
+    // a repeated attempt reuses the headers built for the first one
+    if (!headers) {
+        if (!entry->etag.empty())
+            headers = curl_slist_append(headers, fmt::format("If-None-Match: {}", entry->etag).c_str());
+        if (!entry->last_modified.empty())
+            headers = curl_slist_append(headers, fmt::format("If-Modified-Since: {}", entry->last_modified).c_str());
+    }
+    if (headers)
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, headers);
+}
+
+std::optional<std::string_view>
+detail::CachedRequest::not_modified(CURL *handle) {
+    if (!entry)
+        return std::nullopt;
+
+    long code;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &code);
+    if (code != 304)
+        return std::nullopt;
+
+    cache->touch(key);
+    return entry->body;
+}
+
+void
+detail::CachedRequest::store(std::string_view body) {
+    if (cache)
+        cache->store(key, body, etag, last_modified);
+}
+
+std::filesystem::path
+detail::privateTempDirectory() {
+#ifdef _WIN32
+    // the temporary directory is already one of the user
+    return std::filesystem::temp_directory_path() / "cc-cli";
+#else
+    // cached bodies are trusted, so nobody else may get to plant them in the shared temporary directory first
+    auto directory = std::filesystem::temp_directory_path() / fmt::format("cc-cli-{}", getuid());
+    if (mkdir(directory.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+        throw std::runtime_error(fmt::format("Failed to create directory {}", directory.string()));
+    struct stat info{};
+    if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+        throw std::runtime_error(fmt::format("{} is not a directory", directory.string()));
+    if (info.st_uid != getuid())
+        throw std::runtime_error(fmt::format("Directory {} belongs to another user", directory.string()));
+    if ((info.st_mode & (S_IRWXG | S_IRWXO)) && chmod(directory.c_str(), S_IRWXU) != 0)
+        throw std::runtime_error(fmt::format("Directory {} is accessible by other users", directory.string()));
+    return directory;
+#endif
+}
+
+std::optional<ResponseCache::Writer>
+detail::CachedRequest::writer() {
+    if (!cache)
+        return std::nullopt;
+    return std::optional<ResponseCache::Writer>(std::in_place, *cache, key);
+}
+
+void
+detail::CachedRequest::commit(ResponseCache::Writer &writer) {
+    writer.commit(etag, last_modified);
+}
+
+size_t
+detail::CachedRequest::header_writer(char *buffer, size_t size, size_t nitems, CachedRequest *request) {
+    std::string_view line{buffer, size * nitems};
+    if (starts_with_nocase(line, "http/")) { // status line of a new response, e.g. after a redirect
+        request->etag.clear();
+        request->last_modified.clear();
+    } else if (starts_with_nocase(line, "etag:")) {
+        request->etag = trim(line.substr(5));
+    } else if (starts_with_nocase(line, "last-modified:")) {
+        request->last_modified = trim(line.substr(14));
+    }
+    return size * nitems;
+}
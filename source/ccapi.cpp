@@ -1,55 +1,23 @@
 #include "ccapi.hpp"
+#include "decode.hpp"
+#include "endpoint.hpp"
+#include "json_stream.hpp"
+#include "results.hpp"
+#include "scheduler.hpp"
 
-#include <ctime>
-#include <iomanip>
-#include <sstream>
+#include <thread>
 
-using namespace ccapi;
-
-extern "C" char* strptime(const char* s,
-                          const char* f,
-                          struct tm* tm) {
-    std::istringstream input(s);
-    input.imbue(std::locale(setlocale(LC_ALL, nullptr)));
-    input >> std::get_time(tm, f);
-    if (input.fail()) {
-        return nullptr;
-    }
-    return (char*)(s + input.tellg());
-}
-
-void parse_time(char* str, const char* format, std::tm& tm){
-    strptime(str, format, &tm);
-}
-
-size_t writer(void *ptr, size_t size, size_t nmemb, std::string *data){
-    data->append((char *) ptr, size * nmemb);
-    return size * nmemb;
-}
-
-[[nodiscard]]
-CURL *
-common_curl_init(const std::string &context, std::string &response) {
-	#ifdef WIN32
-		curl_global_init(CURL_GLOBAL_WIN32);
-	#endif
+#include <fmt/compile.h>
 
-    auto handle = curl_easy_init();
-    if (!handle)
-        throw std::runtime_error("Failed to initialize CURL handle");
-
-    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, false);
-    curl_easy_setopt(handle, CURLOPT_URL, fmt::format(CC_URL, context).c_str());
-    curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, writer);
-    curl_easy_setopt(handle, CURLOPT_WRITEDATA, &response);
-    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, true);
+using namespace ccapi;
 
-    return handle;
+std::string
+detail::url(const Client &client, const std::string &context) {
+    return client.baseUrl() + context;
 }
 
 void
-common_curl_preform(CURL *handle) {
-    auto curl_code = curl_easy_perform(handle);
+detail::check(CURL *handle, CURLcode curl_code) {
     if (curl_code != CURLE_OK)
         throw std::runtime_error(fmt::format("CURL request failed with error {}", curl_code));
 
@@ -59,211 +27,212 @@ common_curl_preform(CURL *handle) {
         throw std::runtime_error(fmt::format("HTTP request failed with code {}", code));
 }
 
-ServerInfo
-ccapi::serverInfo(const std::string &slug) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}", slug), response);
+size_t
+detail::stream_writer(void *ptr, size_t size, size_t nmemb, StreamTarget *target) {
+    long code;
+    curl_easy_getinfo(target->handle, CURLINFO_RESPONSE_CODE, &code);
+    if (code != 200)
+        return size * nmemb; // error bodies are not JSON, the status is reported by check()
 
     try {
-        common_curl_preform(handle);
-        auto json_object = nlohmann::json::parse(response);
-
-        ServerInfo info{
-                json_object["address"],
-                json_object["name"],
-                json_object["position"].get<int>(),
-                json_object["slug"],
-                json_object["votes"].get<int>()
-        };
-
-        curl_easy_cleanup(handle);
-        return info;
+        target->fed = true;
+        if (target->trace && target->trace->enabled()) {
+            auto start = Tracer::clock_type::now();
+            target->stream->feed((char *) ptr, size * nmemb);
+            target->trace->add_parse(Tracer::clock_type::now() - start);
+        } else {
+            target->stream->feed((char *) ptr, size * nmemb);
+        }
+        if (target->stream->stopped())
+            return 0; // the partial body is not cached
+        if (target->tee)
+            target->tee->append({(char *) ptr, size * nmemb});
+        return size * nmemb;
     } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
+        target->error = std::current_exception();
+        return 0;
     }
 }
 
-VoteVector
-ccapi::serverVotes(const std::string &slug) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}/votes", slug), response);;
-    try {
-        common_curl_preform(handle);
-        std::list<Vote> votes;
+/**
+ * Reports the outcome of a transfer to the scheduler of the client, which decides whether it is repeated.
+ */
+RequestScheduler::Decision
+schedule_outcome(Client &client, CURL *handle, CURLcode curl_code, int attempt, bool restartable) {
+    auto scheduler = client.scheduler();
+    return scheduler ? scheduler->finished(handle, curl_code, attempt, restartable) : RequestScheduler::Decision{};
+}
 
-        auto obj = nlohmann::json::parse(response);
-        auto data = obj["data"];
-        for (const auto &datum : data) {
-            std::tm tm {};
-            parse_time((char*)datum["datetime"].get<std::string>().c_str(), TIME_FORMAT, tm);
+/**
+ * Performs a request whose response is parsed while it is being received, without buffering the body.
+ * The body is written to the cache as it arrives. A handler which stops the parsing ends the transfer,
+ * the partial body is then left out of the cache.
+ */
+void
+common_stream(Client &client, const std::string &context, Endpoint endpoint, std::int64_t final_since,
+              detail::JsonHandler &handler) {
+    detail::CachedRequest request(client.cache(), client.baseUrl(), context, endpoint, final_since);
+    detail::RequestTrace trace(client.tracer(), context);
+    detail::JsonStream stream(handler);
+    if (auto body = request.fresh()) {
+        trace.parse([&] {
+            stream.feed(body->data(), body->size());
+            stream.finish();
+        });
+        return;
+    }
 
-            votes.emplace_back(Vote{datum["username"], tm, datum["delivered"].get<bool>()});
+    auto writer = request.writer();
+    for (int attempt = 1;; ++attempt) {
+        auto handle = client.acquire();
+        detail::StreamTarget target{handle, &stream, writer ? &*writer : nullptr, nullptr, &trace};
+
+        curl_easy_setopt(handle, CURLOPT_URL, detail::url(client, context).c_str());
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, detail::stream_writer);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &target);
+        request.prepare(handle);
+        try {
+            CURLcode curl_code;
+            {
+                detail::SchedulerPermit permit(client.scheduler());
+                curl_code = curl_easy_perform(handle);
+            }
+            if (target.error)
+                std::rethrow_exception(target.error);
+            if (stream.stopped()) {
+                schedule_outcome(client, handle, CURLE_OK, attempt, false);
+                trace.transferred(handle, false);
+                client.release(handle);
+                return;
+            }
+
+            // error bodies never reach the stream, so only a transfer broken off in the middle cannot be repeated
+            auto decision = schedule_outcome(client, handle, curl_code, attempt, !target.fed);
+            if (decision.retry) {
+                client.release(handle);
+                std::this_thread::sleep_for(decision.delay);
+                continue;
+            }
+
+            auto cached = curl_code == CURLE_OK ? request.not_modified(handle) : std::nullopt;
+            trace.transferred(handle, cached.has_value());
+            if (cached)
+                trace.parse([&] { stream.feed(cached->data(), cached->size()); });
+            else
+                detail::check(handle, curl_code);
+            stream.finish();
+
+            if (writer && !cached)
+                request.commit(*writer);
+            client.release(handle);
+            return;
+        } catch (...) {
+            client.release(handle);
+            throw;
         }
-
-        VoteVector vector {
-                votes,
-                obj["vote_count"].get<int>()
-        };
-
-        curl_easy_cleanup(handle);
-        return vector;
-    } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
     }
 }
 
-VoteVector
-ccapi::serverVotes(const std::string &slug, const int &month, const int &year) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}/votes/{}/{}", slug, year, month), response);;
-    try {
-        common_curl_preform(handle);
-        std::list<Vote> votes;
+/**
+ * Answers from the in-process results of the client when it has them, sharing a fetch already in progress.
+ */
+template<typename Fetch>
+auto
+shared_result(Client &client, const std::string &key, Endpoint endpoint, Fetch fetch) {
+    if (auto results = client.results())
+        return results->fetch<decltype(fetch())>(key, endpoint, fetch);
+    return fetch();
+}
 
-        auto obj = nlohmann::json::parse(response);
-        auto data = obj["data"];
-        for (const auto &datum : data) {
-            std::tm tm{};
-            parse_time((char*)datum["datetime"].get<std::string>().c_str(), TIME_FORMAT, tm);
+/**
+ * Performs the request of an endpoint, decoded while it is received.
+ *
+ * @param limit Number of rows after which the transfer ends, once their count is known
+ */
+template<typename Api>
+typename Api::Result
+fetch(Client &client, const Api &api, std::size_t limit = detail::NO_LIMIT) {
+    auto context = api.context();
+    // results of another API are kept apart, like the responses in the cache
+    auto key = limit == detail::NO_LIMIT ? client.baseUrl() + context
+                                         : fmt::format(FMT_COMPILE("{}{}?limit={}"), client.baseUrl(), context, limit);
+    // a key names results of one type only
+    if constexpr (requires { Api::variant; })
+        key += fmt::format(FMT_COMPILE("#{}"), Api::variant);
+    return shared_result(client, key, detail::result_endpoint(api), [&] {
+        detail::Reader<Api> reader(api, limit);
+        common_stream(client, context, api.endpoint(), detail::final_since(api), reader);
+        return reader.result();
+    });
+}
 
-            votes.push_front(Vote{
-                    datum["username"],
-                    tm,
-                    datum["delivered"].get<bool>(),
-            });
-        }
+/**
+ * Hands every vote of a listing to the callback as it is received, without collecting them.
+ */
+template<typename Api>
+int
+stream_votes(Client &client, const Api &api, const VoteCallback &callback) {
+    detail::Reader<Api> reader(api, detail::NO_LIMIT, detail::VoteRows(&callback));
+    common_stream(client, api.context(), api.endpoint(), detail::final_since(api), reader);
+    return reader.fields().vote_count;
+}
 
-        VoteVector vector {
-                votes,
-                obj["vote_count"].get<int>()
-        };
+ServerInfo
+ccapi::serverInfo(const std::string &slug, Client &client) {
+    return fetch(client, api::ServerInfo{slug});
+}
 
-        curl_easy_cleanup(handle);
-        return vector;
-    } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
-    }
+VoteVector
+ccapi::serverVotes(const std::string &slug, Client &client) {
+    return fetch(client, api::ServerVotes{slug});
 }
 
-std::list<VoterInfo>
-ccapi::topVoters(const std::string &slug) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}/voters", slug), response);;
-    try {
-        common_curl_preform(handle);
-        std::list<VoterInfo> votes;
+VoteVector
+ccapi::serverVotes(const std::string &slug, std::size_t limit, Client &client) {
+    return fetch(client, api::ServerVotes{slug}, limit);
+}
 
-        auto data = nlohmann::json::parse(response)["data"];
-        for (const auto &datum : data) {
-            votes.push_back(VoterInfo{
-                    datum["username"],
-                    datum["votes"].get<int>()
-            });
-        }
-        curl_easy_cleanup(handle);
-        return votes;
-    } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
-    }
+VoteVector
+ccapi::serverVotes(const std::string &slug, const int &month, const int &year, Client &client) {
+    return fetch(client, api::ServerVotesMonth{slug, month, year});
 }
 
-PlayerInfo
-ccapi::userVotes(const std::string &username, const std::string &slug) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}/player/{}", slug, username), response);;
-    try {
-        common_curl_preform(handle);
-        std::list<Vote> votes;
+int
+ccapi::streamServerVotes(const std::string &slug, const VoteCallback &callback, Client &client) {
+    return stream_votes(client, api::ServerVotes{slug}, callback);
+}
 
-        auto obj = nlohmann::json::parse(response);
-        auto data = obj["data"];
+int
+ccapi::streamServerVotes(const std::string &slug, const int &month, const int &year, const VoteCallback &callback, Client &client) {
+    return stream_votes(client, api::ServerVotesMonth{slug, month, year}, callback);
+}
 
-        for (const auto &datum : data) {
-            std::tm tm{};
-            parse_time((char*) datum["datetime"].get<std::string>().c_str(), TIME_FORMAT, tm);
-            votes.push_front(Vote{
-                    datum["username"],
-                    tm,
-                    datum["delivered"].get<bool>()
-            });
-        }
+std::list<VoterInfo>
+ccapi::topVoters(const std::string &slug, Client &client) {
+    return fetch(client, api::TopVoters{slug});
+}
 
-        std::tm tm {};
-        parse_time((char*)obj["next_vote"].get<std::string>().c_str(), TIME_FORMAT, tm);
-        PlayerInfo info {
-                obj["username"],
-                tm,
-                obj["vote_count"].get<int>(),
-                votes
-        };
+std::list<VoterInfo>
+ccapi::topVoters(const std::string &slug, std::size_t limit, Client &client) {
+    return fetch(client, api::TopVoters{slug}, limit);
+}
 
-        curl_easy_cleanup(handle);
-        return info;
-    } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
-    }
+VoterList
+ccapi::countedTopVoters(const std::string &slug, std::size_t limit, Client &client) {
+    return fetch(client, api::CountedTopVoters{slug}, limit);
 }
 
 PlayerInfo
-ccapi::userVotes(const std::string &username, const std::string &slug, const int &month, const int &year) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}/player/{}/{}/{}", slug, username, year, month), response);
-    try {
-        common_curl_preform(handle);
-        std::list<Vote> votes;
-
-        auto obj = nlohmann::json::parse(response);
-        auto data = obj["data"];
-
-        for (const auto &datum : data) {
-            std::tm tm{};
-            parse_time((char*)datum["datetime"].get<std::string>().c_str(), TIME_FORMAT, tm);
-            votes.push_front(Vote{
-                    datum["username"],
-                    tm,
-                    datum["delivered"].get<bool>()
-            });
-        }
-
-        PlayerInfo info {
-                username,
-                std::tm{},
-                obj["vote_count"].get<int>(),
-                votes
-        };
-
-        curl_easy_cleanup(handle);
-        return info;
-    } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
-    }
+ccapi::userVotes(const std::string &username, const std::string &slug, Client &client) {
+    return fetch(client, api::UserVotes{username, slug});
 }
 
 PlayerInfo
-ccapi::nextVote(const std::string &username, const std::string &slug) {
-    std::string response;
-    auto handle = common_curl_init(fmt::format("server/{}/player/{}/next_vote", slug, username), response);
-    try {
-        common_curl_preform(handle);
-
-        auto obj = nlohmann::json::parse(response);
-        std::tm tm {};
-        parse_time((char*)obj["next_vote"].get<std::string>().c_str(), TIME_FORMAT, tm);
-
-        PlayerInfo info;
-        info.username = obj["username"];
-        info.next_vote = tm;
+ccapi::userVotes(const std::string &username, const std::string &slug, const int &month, const int &year, Client &client) {
+    return fetch(client, api::UserVotesMonth{username, slug, month, year});
+}
 
-        curl_easy_cleanup(handle);
-        return info;
-    } catch (...) {
-        curl_easy_cleanup(handle);
-        throw;
-    }
+PlayerInfo
+ccapi::nextVote(const std::string &username, const std::string &slug, Client &client) {
+    return fetch(client, api::NextVote{username, slug});
 }
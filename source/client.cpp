@@ -0,0 +1,142 @@
+#include "client.hpp"
+#include "cache.hpp"
+#include "ccapi.hpp"
+#include "results.hpp"
+#include "scheduler.hpp"
+#include "trace.hpp"
+
+#include <cstdlib>
+#include <stdexcept>
+
+using namespace ccapi;
+
+Client::Client() {
+    static std::once_flag global_init;
+    std::call_once(global_init, [] { curl_global_init(CURL_GLOBAL_DEFAULT); });
+
+    share = curl_share_init();
+    if (!share)
+        throw std::runtime_error("Failed to initialize CURL share");
+
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, Client::lock);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, Client::unlock);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+    // no CURL_LOCK_DATA_CONNECT, libcurl does not support a connection cache shared by handles running on
+    // several threads at once, every pooled handle and multi handle keeps connections of its own instead
+
+    auto url = std::getenv("CC_CLI_API_URL");
+    setBaseUrl(url && *url ? url : fmt::format(CC_URL, ""));
+    request_scheduler = std::make_shared<RequestScheduler>();
+}
+
+Client::~Client() {
+    for (auto handle : pool)
+        curl_easy_cleanup(handle);
+    curl_share_cleanup(share);
+}
+
+CURL *
+Client::acquire() {
+    CURL *handle = nullptr;
+    {
+        std::lock_guard guard(pool_lock);
+        if (!pool.empty()) {
+            handle = pool.back();
+            pool.pop_back();
+        }
+    }
+
+    if (handle)
+        curl_easy_reset(handle); // keeps live connections and caches
+    else if (!(handle = curl_easy_init()))
+        throw std::runtime_error("Failed to initialize CURL handle");
+
+    curl_easy_setopt(handle, CURLOPT_SHARE, share);
+    curl_easy_setopt(handle, CURLOPT_SSL_VERIFYPEER, false);
+    curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, true);
+    curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, true);
+
+    // an empty list asks for every encoding libcurl can decode
+    if (compressed)
+        curl_easy_setopt(handle, CURLOPT_ACCEPT_ENCODING, "");
+
+    switch (http_version) {
+        case HttpVersion::http1:
+            curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_1_1);
+            break;
+        case HttpVersion::http2:
+            curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+            // waits for the connection being opened instead of opening another one, but only where it can multiplex,
+            // a plain http:// connection would be known to be HTTP/1.1 only after its first response
+            if (base_url.rfind("https:", 0) == 0)
+                curl_easy_setopt(handle, CURLOPT_PIPEWAIT, true);
+            break;
+        case HttpVersion::http2_cleartext:
+            curl_easy_setopt(handle, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2_PRIOR_KNOWLEDGE);
+            curl_easy_setopt(handle, CURLOPT_PIPEWAIT, true);
+            break;
+    }
+
+    return handle;
+}
+
+void
+Client::release(CURL *handle) {
+    std::lock_guard guard(pool_lock);
+    pool.push_back(handle);
+}
+
+void
+Client::setBaseUrl(std::string url) {
+    if (!url.empty() && url.back() != '/')
+        url += '/';
+    base_url = std::move(url);
+}
+
+void
+Client::setCompression(bool enabled) {
+    compressed = enabled;
+}
+
+void
+Client::setHttpVersion(HttpVersion version) {
+    http_version = version;
+}
+
+void
+Client::setCache(std::shared_ptr<ResponseCache> cache) {
+    response_cache = std::move(cache);
+}
+
+void
+Client::setResults(std::shared_ptr<ResultCache> results) {
+    result_cache = std::move(results);
+}
+
+void
+Client::setScheduler(std::shared_ptr<RequestScheduler> scheduler) {
+    request_scheduler = std::move(scheduler);
+}
+
+void
+Client::setTracer(std::shared_ptr<Tracer> tracer) {
+    request_tracer = std::move(tracer);
+}
+
+void
+Client::lock(CURL *, curl_lock_data data, curl_lock_access, void *userptr) {
+    static_cast<Client *>(userptr)->share_locks[data].lock();
+}
+
+void
+Client::unlock(CURL *, curl_lock_data data, void *userptr) {
+    static_cast<Client *>(userptr)->share_locks[data].unlock();
+}
+
+Client &
+ccapi::defaultClient() {
+    static Client client;
+    return client;
+}
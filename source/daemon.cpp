@@ -0,0 +1,404 @@
+#include "daemon.hpp"
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Protocol, in native byte order as both ends run on the same machine:
+ *  request:  magic, environment as u32 length and its bytes, u32 argument count,
+ *            then every argument as u32 length and its bytes
+ *  response: magic, i32 exit status, u64 stdout length, u64 stderr length, then both outputs,
+ *            or only the refusal magic when the environment differs from the one of the daemon
+ */
+static constexpr char MAGIC[4] = {'C', 'C', 'D', '2'};
+static constexpr char REFUSED[4] = {'C', 'C', 'D', 'R'};
+static constexpr std::uint32_t MAX_ARGUMENTS = 1024;
+static constexpr std::uint32_t MAX_ARGUMENT_LENGTH = 1 << 16;
+
+// a client which does not send its command or read the reply in time is dropped
+static constexpr auto CLIENT_TIMEOUT = std::chrono::seconds(5);
+
+std::filesystem::path
+defaultSocketPath() {
+    if (auto path = std::getenv("CC_CLI_SOCKET"))
+        return path;
+#ifndef _WIN32
+    if (auto path = std::getenv("XDG_RUNTIME_DIR"))
+        return std::filesystem::path(path) / "cc-cli.sock";
+    // a directory only the user can enter, the temporary directory is shared with everyone
+    return std::filesystem::temp_directory_path() / fmt::format("cc-cli-{}", getuid()) / "cc-cli.sock";
+#else
+    return std::filesystem::temp_directory_path() / "cc-cli.sock";
+#endif
+}
+
+#ifdef _WIN32
+
+int
+serveCommands(const std::filesystem::path &, const std::string &, const CommandRunner &) {
+    throw std::runtime_error("Serving commands is not supported on Windows");
+}
+
+std::optional<int>
+forwardCommand(const std::filesystem::path &, const std::string &, int, char **) {
+    return std::nullopt;
+}
+
+#else
+
+static volatile std::sig_atomic_t stopping = 0;
+
+static void stop(int) {
+    stopping = 1;
+}
+
+using clock_type = std::chrono::steady_clock;
+
+/**
+ * @param deadline Time after which the rest is not written, for a peer which reads slowly
+ */
+static bool write_all(int fd, const void *data, std::size_t size, clock_type::time_point deadline = clock_type::time_point::max()) {
+    auto bytes = static_cast<const char *>(data);
+    while (size > 0) {
+        if (clock_type::now() >= deadline)
+            return false;
+        auto written = write(fd, bytes, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return false;
+        bytes += written;
+        size -= static_cast<std::size_t>(written);
+    }
+    return true;
+}
+
+static bool read_all(int fd, void *data, std::size_t size) {
+    auto bytes = static_cast<char *>(data);
+    while (size > 0) {
+        auto received = read(fd, bytes, size);
+        if (received < 0 && errno == EINTR)
+            continue;
+        if (received <= 0)
+            return false;
+        bytes += received;
+        size -= static_cast<std::size_t>(received);
+    }
+    return true;
+}
+
+template<typename T>
+static void append(std::string &buffer, const T &value) {
+    buffer.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+static sockaddr_un socket_address(const std::filesystem::path &socket) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    auto path = socket.string();
+    if (path.size() >= sizeof(address.sun_path))
+        throw std::runtime_error(fmt::format("Socket path {} is too long", path));
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    return address;
+}
+
+/**
+ * @returns User of the process on the other end of a connected socket
+ */
+static std::optional<uid_t> peer_uid(int fd) {
+#ifdef SO_PEERCRED
+    ucred credentials{};
+    socklen_t length = sizeof(credentials);
+    if (getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &credentials, &length) != 0)
+        return std::nullopt;
+    return credentials.uid;
+#else
+    uid_t uid;
+    gid_t gid;
+    if (getpeereid(fd, &uid, &gid) != 0)
+        return std::nullopt;
+    return uid;
+#endif
+}
+
+static bool same_user(int fd) {
+    auto uid = peer_uid(fd);
+    return uid && *uid == getuid();
+}
+
+/**
+ * Creates the directory of the socket when missing, accessible by the user only.
+ *
+ * @throws std::runtime_error Thrown when the directory belongs to another user or others can write into it
+ */
+static void prepare_directory(const std::filesystem::path &directory) {
+    if (directory.empty())
+        return;
+    if (mkdir(directory.c_str(), S_IRWXU) != 0 && errno != EEXIST)
+        throw std::runtime_error(fmt::format("Failed to create directory {}", directory.string()));
+    struct stat info{};
+    if (lstat(directory.c_str(), &info) != 0 || !S_ISDIR(info.st_mode))
+        throw std::runtime_error(fmt::format("{} is not a directory", directory.string()));
+    // a shared directory such as /tmp is fine when it is sticky, nobody else can replace the socket then
+    if (info.st_uid != getuid() && info.st_uid != 0)
+        throw std::runtime_error(fmt::format("Directory {} belongs to another user", directory.string()));
+    if ((info.st_mode & (S_IWGRP | S_IWOTH)) && !(info.st_mode & S_ISVTX))
+        throw std::runtime_error(fmt::format("Directory {} is writable by other users", directory.string()));
+}
+
+static int connect_to(const sockaddr_un &address) {
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static bool read_string(int fd, std::string &value) {
+    std::uint32_t length;
+    if (!read_all(fd, &length, sizeof(length)) || length > MAX_ARGUMENT_LENGTH)
+        return false;
+    value.resize(length);
+    return read_all(fd, value.data(), length);
+}
+
+static void append_string(std::string &buffer, std::string_view value) {
+    append(buffer, static_cast<std::uint32_t>(value.size()));
+    buffer += value;
+}
+
+struct Request {
+    std::string environment;
+    std::vector<std::string> arguments;
+};
+
+static std::optional<Request> read_request(int fd) {
+    char magic[sizeof(MAGIC)];
+    Request request;
+    std::uint32_t count;
+    if (!read_all(fd, magic, sizeof(magic)) || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0
+        || !read_string(fd, request.environment) || !read_all(fd, &count, sizeof(count)) || count == 0
+        || count > MAX_ARGUMENTS)
+        return std::nullopt;
+
+    request.arguments.resize(count);
+    for (auto &argument : request.arguments) {
+        if (!read_string(fd, argument))
+            return std::nullopt;
+    }
+    return request;
+}
+
+/**
+ * Answers one connection. Commands run one at a time under the lock, the request and the reply are
+ * transferred outside of it, so a slow client holds up nobody else.
+ */
+static void serve_client(int fd, const std::string &environment, std::mutex &commands, const CommandRunner &run) {
+    timeval timeout{CLIENT_TIMEOUT.count(), 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    auto request = read_request(fd);
+    if (!request)
+        return;
+    // commands depend on the address of the API and the cache and archive directories, those of the daemon are fixed
+    if (request->environment != environment) {
+        write_all(fd, REFUSED, sizeof(REFUSED), clock_type::now() + CLIENT_TIMEOUT);
+        return;
+    }
+    auto &arguments = request->arguments;
+
+    std::vector<char *> argv;
+    for (auto &argument : arguments)
+        argv.push_back(argument.data());
+    argv.push_back(nullptr);
+
+    char *out_data = nullptr, *err_data = nullptr;
+    std::size_t out_size = 0, err_size = 0;
+    auto out = open_memstream(&out_data, &out_size);
+    auto err = open_memstream(&err_data, &err_size);
+    std::int32_t status = 1;
+    if (out && err) {
+        std::lock_guard guard(commands);
+        try {
+            status = run(static_cast<int>(arguments.size()), argv.data(), out, err);
+        } catch (std::exception &ex) {
+            fmt::print(err, "Failed to process request. Cause: {}\n", ex.what());
+        }
+    }
+    if (out)
+        std::fclose(out);
+    if (err)
+        std::fclose(err);
+
+    std::string header(MAGIC, sizeof(MAGIC));
+    append(header, status);
+    append(header, static_cast<std::uint64_t>(out_size));
+    append(header, static_cast<std::uint64_t>(err_size));
+    // a client which went away or stopped reading is not an error of the daemon
+    const auto deadline = clock_type::now() + CLIENT_TIMEOUT;
+    if (write_all(fd, header.data(), header.size(), deadline) && write_all(fd, out_data, out_size, deadline))
+        write_all(fd, err_data, err_size, deadline);
+    std::free(out_data);
+    std::free(err_data);
+}
+
+int
+serveCommands(const std::filesystem::path &socket, const std::string &environment, const CommandRunner &run) {
+    auto address = socket_address(socket);
+    if (auto running = connect_to(address); running >= 0) {
+        close(running);
+        throw std::runtime_error(fmt::format("Another daemon is already listening on {}", socket.string()));
+    }
+    prepare_directory(socket.parent_path());
+    unlink(address.sun_path); // left behind by a daemon which did not exit cleanly
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0)
+        throw std::runtime_error("Failed to create socket");
+    // commands run with the rights of the daemon's user, the socket is created accessible by the user only
+    auto mask = umask(S_IRWXG | S_IRWXO);
+    bool bound = bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) == 0;
+    umask(mask);
+    if (!bound || listen(fd, 64) != 0) {
+        close(fd);
+        throw std::runtime_error(fmt::format("Failed to listen on {}", socket.string()));
+    }
+
+    // no SA_RESTART, so a signal interrupts accept() and ends the loop
+    struct sigaction action{};
+    action.sa_handler = stop;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    fmt::print("Listening on {}\n", socket.string());
+    std::fflush(stdout);
+    std::mutex commands;
+    std::mutex workers_lock;
+    std::condition_variable workers_done;
+    std::size_t workers = 0;
+    while (!stopping) {
+        int client = accept(fd, nullptr, nullptr);
+        if (client < 0)
+            continue;
+        if (!same_user(client)) {
+            close(client);
+            continue;
+        }
+        {
+            std::lock_guard guard(workers_lock);
+            ++workers;
+        }
+        std::thread([&, client] {
+            serve_client(client, environment, commands, run);
+            close(client);
+            std::lock_guard guard(workers_lock);
+            if (--workers == 0)
+                workers_done.notify_all();
+        }).detach();
+    }
+
+    // commands in progress are answered before the daemon exits
+    {
+        std::unique_lock guard(workers_lock);
+        workers_done.wait(guard, [&] { return workers == 0; });
+    }
+    close(fd);
+    unlink(address.sun_path);
+    return 0;
+}
+
+std::optional<int>
+forwardCommand(const std::filesystem::path &socket, const std::string &environment, int argc, char **argv) {
+    sockaddr_un address;
+    try {
+        address = socket_address(socket);
+    } catch (std::exception &) {
+        return std::nullopt;
+    }
+    // a socket of another user would receive the arguments and answer with whatever output it likes
+    struct stat info{};
+    if (lstat(address.sun_path, &info) != 0)
+        return std::nullopt;
+    if (!S_ISSOCK(info.st_mode) || info.st_uid != getuid()) {
+        fmt::print(stderr, "Ignoring daemon socket {}, it belongs to another user\n", socket.string());
+        return std::nullopt;
+    }
+    int fd = connect_to(address);
+    if (fd < 0)
+        return std::nullopt;
+    if (!same_user(fd)) {
+        close(fd);
+        fmt::print(stderr, "Ignoring daemon on {}, it runs as another user\n", socket.string());
+        return std::nullopt;
+    }
+
+    std::string request(MAGIC, sizeof(MAGIC));
+    append_string(request, environment);
+    append(request, static_cast<std::uint32_t>(argc));
+    for (int index = 0; index < argc; ++index) {
+        std::string argument = argv[index];
+        // the daemon runs in another working directory
+        if (index > 0 && std::string_view(argv[index - 1]) == "--trace")
+            argument = std::filesystem::absolute(argument).string();
+        append_string(request, argument);
+    }
+
+    std::signal(SIGPIPE, SIG_IGN);
+    if (!write_all(fd, request.data(), request.size())) {
+        close(fd);
+        return std::nullopt; // the daemon is going away, the command runs locally instead
+    }
+
+    char magic[sizeof(MAGIC)];
+    std::int32_t status;
+    std::uint64_t out_size, err_size;
+    std::string out, err;
+    bool received = read_all(fd, magic, sizeof(magic));
+    if (received && std::memcmp(magic, REFUSED, sizeof(REFUSED)) == 0) {
+        close(fd);
+        return std::nullopt; // the daemon talks to another API or keeps other caches, the command runs locally
+    }
+    received = received && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0 && read_all(fd, &status, sizeof(status)) && read_all(fd, &out_size, sizeof(out_size))
+                    && read_all(fd, &err_size, sizeof(err_size));
+    if (received) {
+        out.resize(out_size);
+        err.resize(err_size);
+        received = read_all(fd, out.data(), out.size()) && read_all(fd, err.data(), err.size());
+    }
+    close(fd);
+    if (!received) {
+        fmt::print(stderr, "Lost connection to the daemon on {}\n", socket.string());
+        return 1;
+    }
+
+    std::fwrite(out.data(), 1, out.size(), stdout);
+    std::fflush(stdout);
+    std::fwrite(err.data(), 1, err.size(), stderr);
+    return status;
+}
+
+#endif
@@ -0,0 +1,176 @@
+#pragma once
+
+#include "votes.hpp"
+
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ccapi {
+
+    struct VoterInfo;
+    struct PlayerInfo;
+
+    /**
+     * Per-user vote counts keyed by interned username id.
+     *
+     * Flat open-addressing table with linear probing. Counters built by different threads over votes
+     * sharing one string table can be merged, ids of different tables must not be mixed.
+     */
+    class VoteCounter {
+    public:
+        struct Entry {
+            StringTable::Id user;
+            std::uint64_t count;
+        };
+
+        explicit VoteCounter(std::size_t expected = 64);
+
+        void add(StringTable::Id user, std::uint64_t count = 1);
+
+        /**
+         * Counts votes dated within [from, to).
+         */
+        void add(VoteSpan votes, std::int64_t from = std::numeric_limits<std::int64_t>::min(),
+                 std::int64_t to = std::numeric_limits<std::int64_t>::max());
+
+        /**
+         * Adds counts of a partial result.
+         */
+        void merge(const VoteCounter &other);
+
+        /**
+         * @param k maximum number of entries
+         * @returns At most k users with the most votes, ties broken by lower id
+         */
+        [[nodiscard]] std::vector<Entry> top(std::size_t k) const;
+
+        /**
+         * @returns Number of distinct users
+         */
+        [[nodiscard]] std::size_t size() const { return used; }
+
+        /**
+         * @returns Sum of all counts
+         */
+        [[nodiscard]] std::uint64_t total() const { return sum; }
+
+    private:
+        static constexpr StringTable::Id EMPTY = std::numeric_limits<StringTable::Id>::max();
+
+        void grow();
+
+        std::vector<Entry> slots;
+        std::size_t used = 0;
+        std::uint64_t sum = 0;
+    };
+
+    /**
+     * Counts votes dated within [from, to), splitting large inputs between threads.
+     * @param threads number of worker threads, 0 for the hardware concurrency
+     */
+    VoteCounter countVotes(VoteSpan votes, std::int64_t from = std::numeric_limits<std::int64_t>::min(),
+                           std::int64_t to = std::numeric_limits<std::int64_t>::max(), unsigned threads = 0);
+
+    /**
+     * Builds a leaderboard in the shape returned by the server.
+     * @param table string table the counted ids belong to
+     * @param k maximum number of voters
+     */
+    std::list<VoterInfo> topVoters(const VoteCounter &counter, const StringTable &table, std::size_t k);
+
+    /**
+     * Leaderboards of several servers combined and indexed by voter.
+     *
+     * Usernames are interned once, votes of every voter are summed for the merged ranking, and the standings
+     * of a voter on every server are chained in flat arrays, so looking up any number of players costs
+     * neither a request nor a pass over the leaderboards.
+     */
+    class VoterIndex {
+    public:
+        struct Standing {
+            std::size_t server; // index into servers()
+            std::size_t rank;   // 1 for the best voter of the server
+            int votes;
+        };
+
+        /**
+         * Adds the leaderboard of a server.
+         *
+         * @param voters Leaderboard ordered from the best voter, as the server lists it
+         */
+        void add(const std::string &slug, const std::list<VoterInfo> &voters);
+
+        /**
+         * @returns Standings of the voter on every server ranking it, in the order the servers were added
+         */
+        [[nodiscard]] std::vector<Standing> find(std::string_view username) const;
+
+        /**
+         * @param k maximum number of voters
+         * @returns Voters with the most votes on all the servers together
+         */
+        [[nodiscard]] std::list<VoterInfo> top(std::size_t k) const { return topVoters(counter, names, k); }
+
+        [[nodiscard]] const std::vector<std::string> &servers() const { return slugs; }
+
+        /**
+         * @returns Votes of every voter on all the servers together, keyed by ids of table()
+         */
+        [[nodiscard]] const VoteCounter &totals() const { return counter; }
+        [[nodiscard]] const StringTable &table() const { return names; }
+
+    private:
+        static constexpr std::uint32_t END = std::numeric_limits<std::uint32_t>::max();
+
+        StringTable names;
+        VoteCounter counter;
+        std::vector<std::string> slugs;
+        std::vector<Standing> standings;
+        std::vector<std::uint32_t> previous; // earlier standing of the same voter, END for the first one
+        std::vector<std::uint32_t> latest;   // last standing of every voter, by id
+    };
+
+    /**
+     * Votes of a server grouped by voter, to answer questions about many players from one listing.
+     *
+     * Votes are laid out player after player, every run newest first, with the run of each player found
+     * by its interned username id, so a lookup costs a hash of the name and no request.
+     */
+    class PlayerIndex {
+    public:
+        // the API accepts a vote of a player once in two hours
+        static constexpr std::int64_t VOTE_INTERVAL = 2 * 60 * 60;
+
+        /**
+         * @param votes Votes of a server in any order
+         */
+        explicit PlayerIndex(const VoteColumns &votes);
+
+        /**
+         * @returns Votes of the player, newest first, empty when the player did not vote
+         */
+        [[nodiscard]] VoteSpan find(std::string_view username) const;
+
+        /**
+         * Builds a profile in the shape returned by the server.
+         * The next vote is estimated from the newest indexed vote, it is never earlier than now.
+         *
+         * @param now current time in the frame of timestamps of the API, see apiNow()
+         */
+        [[nodiscard]] PlayerInfo player(const std::string &username, std::int64_t now) const;
+
+        /**
+         * @returns Number of players who voted
+         */
+        [[nodiscard]] std::size_t size() const { return players; }
+
+    private:
+        VoteColumns votes;
+        std::vector<std::size_t> offsets; // run of user id i spans [offsets[i], offsets[i + 1])
+        std::size_t players = 0;
+    };
+}
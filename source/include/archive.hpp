@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "ccapi.hpp"
+
+namespace ccapi {
+
+    /**
+     * Local append-only archive of server votes, kept with month granularity.
+     *
+     * Every slug has its own file made of month blocks. A sync appends blocks for months which are
+     * missing and a new block for the current month, the latest block of a month supersedes older ones.
+     * Once superseded blocks take more space than the current ones, the file is rewritten without them.
+     * Months which are over are final and never fetched again, so a regular sync costs one or two requests.
+     * A file is read once per archive object and kept in memory, which is safe to use from multiple threads.
+     * A sync holds a lock on the file of the server for its whole length and reads the file again under it,
+     * so processes syncing the same server at once take turns, readers wait for the sync to end.
+     */
+    class VoteArchive {
+    public:
+        struct SyncReport {
+            std::size_t requests;
+            std::size_t archived_months;
+            std::size_t archived_votes;
+        };
+
+        /**
+         * @param directory Directory with the archive files, created when missing
+         */
+        explicit VoteArchive(std::filesystem::path directory = defaultDirectory());
+
+        /**
+         * Brings archive of the server up to date. The first sync downloads the whole history once,
+         * following ones fetch the months missing since the last sync and refresh every month which was not over
+         * yet when it was fetched, the current one included.
+         *
+         * @param slug Slug name of the server
+         * @param parallel Maximum number of months fetched at the same time
+         * @param client Session used to perform the requests
+         *
+         * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+         * @returns Summary of the sync
+         */
+        SyncReport sync(const std::string &slug, std::size_t parallel = 8, Client &client = defaultClient());
+
+        /**
+         * Retrieves votes of a month, ordered as serverVotes(slug, month, year) orders them.
+         *
+         * @returns Archived votes, or nothing when the month is not archived or is not over yet
+         */
+        [[nodiscard]] std::optional<VoteVector> month(const std::string &slug, int month, int year) const;
+
+        /**
+         * @returns All archived votes of the server, oldest first
+         */
+        [[nodiscard]] VoteColumns history(const std::string &slug) const;
+
+        /**
+         * @returns Slugs of every archived server, sorted
+         */
+        [[nodiscard]] std::vector<std::string> slugs() const;
+
+        /**
+         * @throws std::runtime_error Thrown when the user has no home and the temporary directory of the user
+         *                            belongs to someone else
+         * @returns Archive directory of the current user
+         */
+        static std::filesystem::path defaultDirectory();
+
+    private:
+        struct Block {
+            int vote_count;
+            bool final;
+            VoteColumns votes;
+            std::uint64_t size = 0; // bytes in the file, header included
+        };
+
+        struct Months {
+            std::map<YearMonth, Block> blocks;
+            std::uint64_t superseded = 0; // bytes of blocks replaced by later ones of the same month
+            std::uint64_t end = 0;        // bytes of the file up to the end of the last valid block
+            bool torn = false;            // whether the file goes on past end, with a block written in part
+        };
+
+        [[nodiscard]] std::filesystem::path path(const std::string &slug) const;
+        [[nodiscard]] std::filesystem::path lockPath(const std::string &slug) const;
+
+        /**
+         * @returns Blocks of the file, the lock of the file must be held while it is read
+         */
+        [[nodiscard]] Months load(const std::string &slug) const;
+
+        /**
+         * @returns Months of the server, loaded on first use under a shared lock of the file.
+         * The lock must be held while they are used
+         */
+        Months &months(const std::string &slug) const;
+
+        /**
+         * Stores the blocks into the archive, appended to the file or rewritten together with the rest
+         * when superseded blocks would outweigh the current ones. A torn block at the end is cut off first.
+         */
+        void store(const std::string &slug, Months &months, std::map<YearMonth, Block> added) const;
+
+        std::filesystem::path directory;
+        mutable std::mutex lock;
+        mutable std::map<std::string, Months> loaded;
+    };
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include "cache.hpp"
+#include "ccapi.hpp"
+
+namespace ccapi {
+
+    namespace detail {
+
+        class AsyncOperation;
+
+        template<typename T>
+        struct StreamDecoder;
+
+        /**
+         * Result slot shared by an operation and its future.
+         */
+        template<typename T>
+        class SharedState {
+        public:
+            void set_value(T result) { finish([&] { value.emplace(std::move(result)); }); }
+            void set_error(std::exception_ptr exception) { finish([&] { error = std::move(exception); }); }
+
+            bool ready() const {
+                std::lock_guard guard(lock);
+                return done;
+            }
+
+            void wait() const {
+                std::unique_lock guard(lock);
+                finished.wait(guard, [this] { return done; });
+            }
+
+            /**
+             * @returns Whether the coroutine was suspended, false when the result is already there
+             */
+            bool suspend(std::coroutine_handle<> handle) {
+                std::lock_guard guard(lock);
+                if (done)
+                    return false;
+                waiter = handle;
+                return true;
+            }
+
+            T take() {
+                wait();
+                if (error)
+                    std::rethrow_exception(error);
+                return std::move(*value);
+            }
+
+        private:
+            template<typename Store>
+            void finish(Store store) {
+                std::coroutine_handle<> resumed;
+                {
+                    std::lock_guard guard(lock);
+                    store();
+                    done = true;
+                    resumed = std::exchange(waiter, {});
+                }
+                finished.notify_all();
+                if (resumed)
+                    resumed.resume();
+            }
+
+            mutable std::mutex lock;
+            mutable std::condition_variable finished;
+            std::optional<T> value;
+            std::exception_ptr error;
+            std::coroutine_handle<> waiter;
+            bool done = false;
+        };
+    }
+
+    /**
+     * Result of an asynchronous call, which can be waited for like std::future or awaited with co_await.
+     *
+     * A coroutine awaiting the result is resumed on the event-loop thread of the AsyncClient, it must not
+     * block there on another future of the same client. The result can be retrieved once.
+     */
+    template<typename T>
+    class Future {
+    public:
+        explicit Future(std::shared_ptr<detail::SharedState<T>> state) : state(std::move(state)) {}
+
+        [[nodiscard]] bool ready() const { return state->ready(); }
+        void wait() const { state->wait(); }
+
+        /**
+         * Blocks until the call finishes.
+         *
+         * @throws std::runtime_error Rethrows the error the call failed with
+         * @returns Result of the call
+         */
+        T get() { return state->take(); }
+
+        bool await_ready() const { return state->ready(); }
+        bool await_suspend(std::coroutine_handle<> handle) { return state->suspend(handle); }
+        T await_resume() { return state->take(); }
+
+    private:
+        std::shared_ptr<detail::SharedState<T>> state;
+    };
+
+    /**
+     * Asynchronous counterpart of the API functions.
+     *
+     * Every call returns immediately with a Future, all transfers are driven by one event-loop thread
+     * built on curl_multi_socket_action, so any number of requests can be outstanding without
+     * a thread per request. Responses are decoded on the event-loop thread while they are received, through
+     * the cache and tracer of the client, and limited calls end their transfer once they have the result.
+     * Calls may be made from any thread.
+     * The scheduler of the client admits every transfer, calls it holds back or repeats wait on the event loop.
+     */
+    class AsyncClient {
+    public:
+        /**
+         * @param client Session whose handles, cache and tracer are used
+         * @param max_connections Maximum number of connections open at the same time, further requests wait for one
+         *                        unless they can share one as HTTP/2 streams
+         *
+         * @throws std::runtime_error Thrown in case the event loop cannot be set up
+         */
+        explicit AsyncClient(Client &client = defaultClient(), std::size_t max_connections = 16);
+
+        /**
+         * Stops the event loop. Calls still in progress fail with std::runtime_error.
+         */
+        ~AsyncClient();
+
+        AsyncClient(const AsyncClient &) = delete;
+        AsyncClient &operator=(const AsyncClient &) = delete;
+
+        Future<ServerInfo> serverInfo(const std::string &slug);
+        Future<VoteVector> serverVotes(const std::string &slug);
+        Future<VoteVector> serverVotes(const std::string &slug, std::size_t limit);
+        Future<VoteVector> serverVotes(const std::string &slug, const int &month, const int &year);
+        Future<std::list<VoterInfo>> topVoters(const std::string &slug);
+        Future<std::list<VoterInfo>> topVoters(const std::string &slug, std::size_t limit);
+        Future<PlayerInfo> userVotes(const std::string &username, const std::string &slug);
+        Future<PlayerInfo> userVotes(const std::string &username, const std::string &slug, const int &month, const int &year);
+        Future<PlayerInfo> nextVote(const std::string &username, const std::string &slug);
+
+    private:
+        template<typename T>
+        Future<T> submit(std::string context, Endpoint endpoint, std::int64_t final_since,
+                         detail::StreamDecoder<T> decoder);
+
+        // request of an endpoint descriptor, decoded while it is received
+        template<typename Api>
+        Future<typename Api::Result> submit(const Api &api, std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+        void run();
+        void wake();
+        void admit();
+        bool start(std::unique_ptr<detail::AsyncOperation> &operation);
+        void complete(CURL *handle, CURLcode result);
+        void action(curl_socket_t socket, int events);
+
+        static int on_socket(CURL *handle, curl_socket_t socket, int what, void *userp, void *socketp);
+        static int on_timer(CURLM *multi, long timeout_ms, void *userp);
+
+        Client &client;
+        CURLM *multi;
+
+        std::mutex queue_lock;
+        std::deque<std::unique_ptr<detail::AsyncOperation>> queue;
+        bool stopping = false;
+
+        // owned by the event-loop thread
+        std::deque<std::unique_ptr<detail::AsyncOperation>> waiting; // not admitted by the scheduler yet
+        std::multimap<std::chrono::steady_clock::time_point, std::unique_ptr<detail::AsyncOperation>> delayed; // to be repeated
+        std::unordered_map<CURL *, std::unique_ptr<detail::AsyncOperation>> active;
+        std::unordered_map<curl_socket_t, int> sockets;
+        std::optional<std::chrono::steady_clock::time_point> deadline;
+#ifndef _WIN32
+        int wake_pipe[2] = {-1, -1};
+#endif
+
+        std::thread loop;
+    };
+}
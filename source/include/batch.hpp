@@ -0,0 +1,162 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <limits>
+#include <list>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "aggregate.hpp"
+#include "cache.hpp"
+#include "ccapi.hpp"
+#include "trace.hpp"
+
+namespace ccapi {
+
+    namespace detail {
+        class JsonHandler;
+    }
+
+    /**
+     * Set of API requests performed concurrently on a single curl_multi event loop.
+     *
+     * Requests are queued with the endpoint methods, each of which returns an index
+     * used to retrieve the result once run() returns. Every response is decoded as
+     * soon as each part of it is received. Results keep the order in which they were queued.
+     * Requests go through the client's response cache, fresh entries are decoded without a transfer.
+     * Limited requests end their transfer once they have the result.
+     * The scheduler of the client admits every transfer and repeats the failed ones, other requests go on meanwhile.
+     */
+    class Batch {
+    public:
+        using Result = std::variant<std::monostate, ServerInfo, VoteVector, std::list<VoterInfo>, VoterList, PlayerInfo>;
+
+        explicit Batch(Client &client = defaultClient());
+        ~Batch();
+
+        std::size_t serverInfo(const std::string &slug);
+        std::size_t serverVotes(const std::string &slug);
+        std::size_t serverVotes(const std::string &slug, std::size_t limit);
+        std::size_t serverVotes(const std::string &slug, const int &month, const int &year);
+        std::size_t topVoters(const std::string &slug);
+        std::size_t topVoters(const std::string &slug, std::size_t limit);
+        std::size_t countedTopVoters(const std::string &slug, std::size_t limit);
+        std::size_t userVotes(const std::string &username, const std::string &slug);
+        std::size_t userVotes(const std::string &username, const std::string &slug, const int &month, const int &year);
+        std::size_t nextVote(const std::string &username, const std::string &slug);
+
+        /**
+         * Performs all queued requests. A failure of a single request does not stop the others,
+         * it is stored and rethrown when its result is accessed.
+         *
+         * @param max_in_flight Maximum number of requests being transferred at the same time, the scheduler
+         *                      of the client may allow fewer
+         *
+         * @throws std::runtime_error Thrown in case the event loop itself fails
+         */
+        void run(std::size_t max_in_flight = 8);
+
+        /**
+         * Retrieves result of a finished request.
+         *
+         * @tparam T Result type of the endpoint the request was queued with
+         * @param index Index returned when queueing the request
+         *
+         * @throws std::runtime_error Rethrows the error the request failed with
+         * @returns Decoded response
+         */
+        template<typename T>
+        const T &get(std::size_t index) const {
+            const auto &entry = entries.at(index);
+            if (entry.error)
+                std::rethrow_exception(entry.error);
+            return std::get<T>(entry.result);
+        }
+
+        [[nodiscard]] std::size_t size() const { return entries.size(); }
+
+    private:
+        using Decoder = std::function<Result(std::string_view)>;
+
+        struct Stream;
+
+        struct Entry {
+            std::unique_ptr<detail::CachedRequest> request;
+            Decoder decode; // of a cached body, fed to the handler at once
+            Result result;
+            std::exception_ptr error;
+            detail::RequestTrace trace;
+            std::shared_ptr<detail::JsonHandler> handler; // parses the body while it is received
+            std::function<Result()> produce;
+            std::unique_ptr<Stream> stream;
+            int attempt;
+        };
+
+        std::size_t push(std::string context, Endpoint endpoint, std::int64_t final_since,
+                         std::shared_ptr<detail::JsonHandler> handler, std::function<Result()> produce);
+
+        // request of an endpoint descriptor, decoded while it is received
+        template<typename Api>
+        std::size_t push(const Api &api, std::size_t limit = std::numeric_limits<std::size_t>::max());
+
+        Client &client;
+        std::vector<Entry> entries;
+    };
+
+    /**
+     * Merges votes of consecutive months into one listing.
+     *
+     * @param months Votes of every month, newest month first, each ordered as serverVotes(slug, month, year) orders them
+     * @returns Votes of all the months, newest first
+     */
+    VoteVector mergeMonths(const std::vector<const VoteVector *> &months);
+
+    /**
+    * Retrieves server votes from every month of a range. Months are fetched concurrently.
+    *
+    * @param slug Slug name of the server
+    * @param from First month of the range
+    * @param to Last month of the range, inclusive
+    * @param parallel Maximum number of months fetched at the same time
+    * @param client Session used to perform the requests
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns Server votes from the range, newest first
+    */
+    VoteVector serverVotes(const std::string &slug, YearMonth from, YearMonth to, std::size_t parallel = 8,
+                           Client &client = defaultClient());
+
+    /**
+    * Retrieves user votes from every month of a range, together with the next vote date.
+    * Months are fetched concurrently.
+    *
+    * @param username Username of the player
+    * @param slug Slug name of the server
+    * @param from First month of the range
+    * @param to Last month of the range, inclusive
+    * @param parallel Maximum number of months fetched at the same time
+    * @param client Session used to perform the requests
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns User votes from the range, newest first
+    */
+    PlayerInfo userVotes(const std::string &username, const std::string &slug, YearMonth from, YearMonth to,
+                         std::size_t parallel = 8, Client &client = defaultClient());
+
+    /**
+    * Retrieves whole leaderboards of several servers concurrently and adds them to an index.
+    *
+    * @param index Index the leaderboards are added to, in the order of the slugs
+    * @param slugs Slug names of the servers
+    * @param parallel Maximum number of leaderboards fetched at the same time
+    * @param client Session used to perform the requests
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    */
+    void indexTopVoters(VoterIndex &index, const std::vector<std::string> &slugs, std::size_t parallel = 8,
+                        Client &client = defaultClient());
+}
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include <curl/curl.h>
+
+namespace ccapi {
+
+    /**
+     * Read-only memory mapping of a whole file.
+     */
+    class MappedFile {
+    public:
+        MappedFile() = default;
+        ~MappedFile();
+
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        /**
+         * @returns Mapping of the file, or nothing when it cannot be opened
+         */
+        static std::optional<MappedFile> open(const std::filesystem::path &path);
+
+        [[nodiscard]] std::string_view data() const { return {address, length}; }
+
+    private:
+        void unmap();
+
+        const char *address = nullptr;
+        std::size_t length = 0;
+#ifdef _WIN32
+        void *file = nullptr;
+        void *mapping = nullptr;
+#endif
+    };
+
+    /**
+     * Kinds of endpoints, each with its own time to live in the cache.
+     */
+    enum class Endpoint { server_info, server_votes, top_voters, user_votes, next_vote, past_month };
+
+    /**
+     * On-disk cache of API responses keyed by base URL and endpoint path.
+     *
+     * Entries are kept as files which are memory mapped when read, so cached bodies are decoded
+     * in place without being copied. Entries older than their time to live are revalidated with
+     * ETag/Last-Modified when the server sent them. Votes of past months never change and do not expire.
+     * Safe to share between processes, entries are replaced atomically.
+     */
+    class ResponseCache {
+    public:
+        struct Entry {
+            std::shared_ptr<const MappedFile> file; // keeps the views below valid
+            std::int64_t stored_at;
+            std::string_view body;
+            std::string_view etag;
+            std::string_view last_modified;
+        };
+
+        /**
+         * Writes a new entry while the body is being received, replacing the old one on commit.
+         */
+        class Writer {
+        public:
+            Writer(const ResponseCache &cache, const std::string &context);
+            ~Writer();
+
+            void append(std::string_view chunk);
+            void commit(std::string_view etag, std::string_view last_modified);
+
+        private:
+            const ResponseCache &cache;
+            std::filesystem::path target;
+            std::filesystem::path temporary;
+            std::ofstream output;
+            std::string context;
+            std::uint64_t body_size = 0;
+            bool committed = false;
+        };
+
+        /**
+         * @param directory Directory with the cache files, created when missing
+         */
+        explicit ResponseCache(std::filesystem::path directory = defaultDirectory());
+
+        /**
+         * @returns Cached response of the endpoint, fresh or not, or nothing when it is not cached
+         */
+        [[nodiscard]] std::optional<Entry> find(const std::string &context) const;
+
+        void store(const std::string &context, std::string_view body, std::string_view etag, std::string_view last_modified) const;
+
+        /**
+         * Marks entry as fresh again, after the server confirmed it has not changed. The entry is written
+         * again and swapped in, the body is copied once more.
+         */
+        void touch(const std::string &context) const;
+
+        /**
+         * @returns Time to live of the endpoint kind
+         */
+        [[nodiscard]] std::chrono::seconds ttl(Endpoint endpoint) const;
+
+        void setTtl(Endpoint endpoint, std::chrono::seconds ttl);
+
+        /**
+         * Keeps up to count most recently used entries mapped in memory, so finding them does not touch
+         * the file system. Meant for long-running processes, entries replaced by another process are
+         * only noticed once they are evicted or stored again through this cache. Zero disables it.
+         */
+        void setMemoryEntries(std::size_t count);
+
+        /**
+         * @throws std::runtime_error Thrown when the user has no home and the temporary directory of the user
+         *                            belongs to someone else
+         * @returns Cache directory of the current user
+         */
+        static std::filesystem::path defaultDirectory();
+
+    private:
+        [[nodiscard]] std::filesystem::path path(const std::string &context) const;
+
+        [[nodiscard]] std::optional<Entry> remembered(const std::string &context) const;
+        void remember(const std::string &context, const Entry &entry) const;
+        void forget(const std::string &context) const;
+
+        std::filesystem::path directory;
+
+        // least recently used entries are at the back of the order
+        mutable std::mutex memory_lock;
+        std::size_t memory_capacity = 0;
+        mutable std::list<std::string> memory_order;
+        mutable std::unordered_map<std::string, std::pair<Entry, std::list<std::string>::iterator>> memory;
+        std::array<std::chrono::seconds, 6> ttls = {
+                std::chrono::minutes(5),    // server_info
+                std::chrono::minutes(5),    // server_votes
+                std::chrono::hours(1),      // top_voters
+                std::chrono::minutes(5),    // user_votes
+                std::chrono::minutes(1),    // next_vote
+                std::chrono::seconds::max() // past_month
+        };
+    };
+
+    /**
+     * @returns Seconds since the epoch from which listings of the month no longer change
+     */
+    std::int64_t monthFinal(int month, int year);
+
+    /**
+     * @returns Endpoint kind of a monthly listing, past_month once the month is over
+     */
+    Endpoint monthEndpoint(Endpoint endpoint, int month, int year);
+
+    namespace detail {
+
+        /**
+         * Directory of the current user in the temporary directory, for users without a home.
+         * Created when missing, accessible by the user only.
+         *
+         * @throws std::runtime_error Thrown when the directory belongs to another user or cannot be created
+         */
+        std::filesystem::path privateTempDirectory();
+
+        /**
+         * Single request going through a response cache. Serves fresh entries, adds conditional
+         * headers for stale ones and keeps the validators the server answers with.
+         */
+        class CachedRequest {
+        public:
+            /**
+             * @param base_url Base URL the context is requested from, responses of different APIs are kept apart
+             * @param endpoint Kind of the endpoint while its responses keep changing
+             * @param final_since Seconds since the epoch from which responses no longer change, 0 when they always may.
+             *                    Entries stored since then never expire, older ones are revalidated once it passed.
+             */
+            CachedRequest(ResponseCache *cache, std::string_view base_url, std::string context, Endpoint endpoint,
+                          std::int64_t final_since = 0);
+            ~CachedRequest();
+
+            CachedRequest(const CachedRequest &) = delete;
+            CachedRequest &operator=(const CachedRequest &) = delete;
+
+            /**
+             * @returns Body of the cached entry when it is still fresh
+             */
+            std::optional<std::string_view> fresh();
+
+            /**
+             * Configures the handle with conditional request headers and validator capture.
+             * Called again with the handle of every repeated attempt.
+             */
+            void prepare(CURL *handle);
+
+            /**
+             * Checks the finished transfer for "304 Not Modified" and refreshes the entry if so.
+             *
+             * @returns Body of the still valid cached entry
+             */
+            std::optional<std::string_view> not_modified(CURL *handle);
+
+            /**
+             * Stores the complete body of a successful response.
+             */
+            void store(std::string_view body);
+
+            /**
+             * @returns Writer for storing the body while it is being received, when the cache is enabled
+             */
+            std::optional<ResponseCache::Writer> writer();
+
+            void commit(ResponseCache::Writer &writer);
+
+            const std::string &context() const { return request_context; }
+
+        private:
+            static size_t header_writer(char *buffer, size_t size, size_t nitems, CachedRequest *request);
+
+            ResponseCache *cache;
+            std::string request_context;
+            std::string key; // base URL and context
+            Endpoint endpoint;
+            std::int64_t final_since;
+            std::optional<ResponseCache::Entry> entry;
+            curl_slist *headers = nullptr;
+            std::string etag;
+            std::string last_modified;
+        };
+    }
+}
@@ -3,19 +3,32 @@
 #include <cstdio>
 #include <chrono>
 #include <stdexcept>
+#include <functional>
 #include <list>
 #include <ctime>
 
-
-#include <nlohmann/json.hpp>
 #include <fmt/format.h>
 #include <curl/curl.h>
 
+#include "client.hpp"
+#include "timefmt.hpp"
+#include "votes.hpp"
+
 namespace ccapi {
 
     constexpr const char *CC_URL = "https://czech-craft.eu/api/{}";
     constexpr const char *TIME_FORMAT = "%Y-%m-%d %H:%M:%S";
 
+    struct YearMonth {
+        int year;
+        int month;
+
+        [[nodiscard]] YearMonth next() const { return month == 12 ? YearMonth{year + 1, 1} : YearMonth{year, month + 1}; }
+        [[nodiscard]] YearMonth previous() const { return month == 1 ? YearMonth{year - 1, 12} : YearMonth{year, month - 1}; }
+
+        auto operator<=>(const YearMonth &other) const = default;
+    };
+
     struct ServerInfo {
         ServerInfo() : address("N/S"), name("N/S"), position(-1), slug("N/S"), votes(0) {}
         ServerInfo(const std::string &address, const std::string &name, const int position, const std::string &slug,
@@ -36,53 +49,72 @@ namespace ccapi {
         int vote_count;
     };
 
-    struct Vote {
-        Vote() : username("N/S"), date(), delivered(false) {}
-        Vote(const std::string &username, const tm &date, const bool delivered) : username(username), date(date), delivered(delivered) {}
+    struct VoterList {
+        VoterList() : voters(), voter_count(0) {};
+        VoterList(std::list<VoterInfo> voters, const int voterCount) : voters(std::move(voters)), voter_count(voterCount) {}
 
-        std::string username;
-        std::tm date;
-        bool delivered;
+        std::list<VoterInfo> voters;
+        int voter_count; // voters of the whole leaderboard, also when only some of them are listed
     };
 
+    /**
+     * Receives votes as they are decoded. The vote is only valid during the call.
+     */
+    using VoteCallback = std::function<void(const Vote &vote)>;
+
     struct VoteVector {
         VoteVector() : votes(), vote_count(0) {};
-        VoteVector(const std::list<Vote> &votes, const int voteCount) : votes(votes), vote_count(voteCount) {}
+        VoteVector(VoteColumns votes, const int voteCount) : votes(std::move(votes)), vote_count(voteCount) {}
 
-        std::list<Vote> votes;
+        VoteColumns votes;
         int vote_count;
     };
 
     struct PlayerInfo {
-        PlayerInfo() : username("N/S"), next_vote(), vote_count(0), votes() {}
-        PlayerInfo(const std::string &username, const tm &nextVote, const int voteCount, const std::list<Vote> &votes)
-        : username(username), next_vote(nextVote), vote_count(voteCount), votes(votes) {}
+        PlayerInfo() : username("N/S"), next_vote(0), vote_count(0), votes() {}
+        PlayerInfo(const std::string &username, const std::int64_t nextVote, const int voteCount, VoteColumns votes)
+        : username(username), next_vote(nextVote), vote_count(voteCount), votes(std::move(votes)) {}
 
         std::string username;
-        std::tm next_vote;
+        std::int64_t next_vote; // seconds since the epoch
         int vote_count;
-        std::list<Vote> votes;
+        VoteColumns votes;
     };
 
     /**
      * Retrieves server information.
      *
      * @param slug Slug name of the server
+     * @param client Session used to perform the request
      *
      * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
      * @returns Server information
      */
-    ServerInfo serverInfo(const std::string &slug);
+    ServerInfo serverInfo(const std::string &slug, Client &client = defaultClient());
 
     /**
     * Retrieves all server votes. (Literally all of them)
     *
     * @param slug Slug name of the server
+    * @param client Session used to perform the request
      *
     * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
     * @returns Server votes (A lot of them)
     */
-    VoteVector serverVotes(const std::string &slug);
+    VoteVector serverVotes(const std::string &slug, Client &client = defaultClient());
+
+    /**
+    * Retrieves first server votes, in the order the API lists them. The transfer ends as soon as
+    * the votes and the total vote count are received, the rest of the listing is not downloaded.
+    *
+    * @param slug Slug name of the server
+    * @param limit Maximum number of votes
+    * @param client Session used to perform the request
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns Server votes, at most limit of them, with the total vote count
+    */
+    VoteVector serverVotes(const std::string &slug, std::size_t limit, Client &client = defaultClient());
 
     /**
     * Retrieves all server votes from a specified month and a year.
@@ -90,11 +122,40 @@ namespace ccapi {
     * @param slug Slug name of the server
     * @param month
     * @param year
+    * @param client Session used to perform the request
      *
     * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
     * @returns Server votes from a month
     */
-    VoteVector serverVotes(const std::string &slug, const int &month, const int &year);
+    VoteVector serverVotes(const std::string &slug, const int &month, const int &year, Client &client = defaultClient());
+
+    /**
+    * Streams all server votes. Votes are decoded straight from the transfer and handed to the callback
+    * as they arrive, in the order the API lists them, so memory use does not grow with the vote history.
+    *
+    * @param slug Slug name of the server
+    * @param callback Receives every vote
+    * @param client Session used to perform the request
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns Total vote count
+    */
+    int streamServerVotes(const std::string &slug, const VoteCallback &callback, Client &client = defaultClient());
+
+    /**
+    * Streams all server votes from a specified month and a year, in the order the API lists them.
+    *
+    * @param slug Slug name of the server
+    * @param month
+    * @param year
+    * @param callback Receives every vote
+    * @param client Session used to perform the request
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns Total vote count
+    */
+    int streamServerVotes(const std::string &slug, const int &month, const int &year, const VoteCallback &callback,
+                          Client &client = defaultClient());
 
     /**
     * Retrieves server's top voters.
@@ -102,22 +163,50 @@ namespace ccapi {
     * @param slug Slug name of the server
     * @param month
     * @param year
+    * @param client Session used to perform the request
      *
     * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
     * @returns Top voters profiles
     */
-    std::list<VoterInfo> topVoters(const std::string &slug);
+    std::list<VoterInfo> topVoters(const std::string &slug, Client &client = defaultClient());
+
+    /**
+    * Retrieves server's best voters. The transfer ends as soon as limit voters are received,
+    * the rest of the leaderboard is not downloaded.
+    *
+    * @param slug Slug name of the server
+    * @param limit Maximum number of voters
+    * @param client Session used to perform the request
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns Top voters profiles, at most limit of them
+    */
+    std::list<VoterInfo> topVoters(const std::string &slug, std::size_t limit, Client &client = defaultClient());
+
+    /**
+    * Retrieves server's best voters and the number of all its voters. The whole leaderboard is downloaded
+    * to count them, only the first limit voters are kept.
+    *
+    * @param slug Slug name of the server
+    * @param limit Maximum number of voters kept
+    * @param client Session used to perform the request
+    *
+    * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
+    * @returns Top voters profiles, at most limit of them, with the number of all voters
+    */
+    VoterList countedTopVoters(const std::string &slug, std::size_t limit, Client &client = defaultClient());
 
     /**
     * Retrieves all user votes.
      *
     * @param username Username of the player
     * @param slug Slug name of the server
+    * @param client Session used to perform the request
      *
     * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
     * @returns Server votes from a month
     */
-    PlayerInfo userVotes(const std::string &username, const std::string &slug);
+    PlayerInfo userVotes(const std::string &username, const std::string &slug, Client &client = defaultClient());
 
     /**
     * Retrieves all user votes from a specified month and a year.
@@ -126,20 +215,22 @@ namespace ccapi {
     * @param slug Slug name of the server
     * @param month
     * @param year
+    * @param client Session used to perform the request
      *
     * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
     * @returns Server votes from a month
     */
-    PlayerInfo userVotes(const std::string &username, const std::string &slug, const int &month, const int &year);
+    PlayerInfo userVotes(const std::string &username, const std::string &slug, const int &month, const int &year, Client &client = defaultClient());
 
     /**
     * Retrieves PlayerInfo containing only next vote and username information.
     *
     * @param username Username of the player
     * @param slug Slug name of the server
+    * @param client Session used to perform the request
     *
     * @throws std::runtime_error Thrown in case something goes wrong, with detailed message about the error
     * @returns Server votes from a month
     */
-    PlayerInfo nextVote(const std::string &username, const std::string &slug);
+    PlayerInfo nextVote(const std::string &username, const std::string &slug, Client &client = defaultClient());
 }
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include <curl/curl.h>
+
+namespace ccapi {
+
+    class RequestScheduler;
+    class ResponseCache;
+    class ResultCache;
+    class Tracer;
+
+    /**
+     * Session with the CzechCraft API.
+     *
+     * Owns a pool of reusable CURL easy handles and a CURLSH share of DNS lookups and
+     * TLS sessions, so calls resume a session instead of paying for a full handshake every time.
+     * Open connections are kept by the pooled handle, or the multi handle, which made them.
+     * Safe to use from multiple threads.
+     */
+    class Client {
+    public:
+        enum class HttpVersion {
+            http1,           // HTTP/1.1, a connection for every request in flight
+            http2,           // HTTP/2 negotiated over TLS, HTTP/1.1 with plain http:// addresses
+            http2_cleartext, // HTTP/2 without negotiation, for plain http:// servers known to speak it
+        };
+
+        Client();
+        ~Client();
+
+        Client(const Client &) = delete;
+        Client &operator=(const Client &) = delete;
+
+        /**
+         * Takes an easy handle from the pool, or creates a new one when the pool is empty.
+         * The handle is reset and configured with options common to every API call.
+         *
+         * @throws std::runtime_error Thrown in case the handle could not be created
+         * @returns Handle which must be given back with release()
+         */
+        [[nodiscard]] CURL *acquire();
+
+        /**
+         * Returns handle to the pool. Its connections stay open for the next call.
+         *
+         * @param handle Handle previously obtained from acquire()
+         */
+        void release(CURL *handle);
+
+        /**
+         * Sets the address every endpoint path is appended to, such as a local stand-in of the API.
+         * Defaults to $CC_CLI_API_URL, or the CzechCraft API when it is not set.
+         * Not synchronized with requests in progress, meant to be called before the client is used.
+         *
+         * @param url Base address ending with a slash, e.g. http://127.0.0.1:8765/api/
+         */
+        void setBaseUrl(std::string url);
+
+        [[nodiscard]] const std::string &baseUrl() const { return base_url; }
+
+        /**
+         * Sets whether responses are requested compressed, with gzip, brotli or any other encoding
+         * libcurl was built with. Bodies are decoded while they arrive, so decoders get plain JSON chunk by chunk.
+         * Enabled by default. Applies to handles acquired after the call.
+         */
+        void setCompression(bool enabled);
+
+        [[nodiscard]] bool compression() const { return compressed; }
+
+        /**
+         * Sets the HTTP version requests are made with. Concurrent requests of a Batch or an AsyncClient
+         * share one HTTP/2 connection as separate streams instead of opening a connection each.
+         * HttpVersion::http2 by default. Applies to handles acquired after the call.
+         */
+        void setHttpVersion(HttpVersion version);
+
+        [[nodiscard]] HttpVersion httpVersion() const { return http_version; }
+
+        /**
+         * Sets the response cache used by requests of this client, nullptr disables caching.
+         * Not synchronized with requests in progress, meant to be called before the client is used.
+         */
+        void setCache(std::shared_ptr<ResponseCache> cache);
+
+        [[nodiscard]] ResponseCache *cache() const { return response_cache.get(); }
+
+        /**
+         * Sets the in-process cache of decoded results, which also coalesces identical calls running
+         * at the same time, nullptr disables it. Streaming calls always go to the response cache.
+         * Not synchronized with requests in progress, meant to be called before the client is used.
+         */
+        void setResults(std::shared_ptr<ResultCache> results);
+
+        [[nodiscard]] ResultCache *results() const { return result_cache.get(); }
+
+        /**
+         * Sets the scheduler admitting and retrying requests of this client, nullptr sends every request
+         * at once and fails on the first error. A client starts with a RequestScheduler of its own.
+         * Not synchronized with requests in progress, meant to be called before the client is used.
+         */
+        void setScheduler(std::shared_ptr<RequestScheduler> scheduler);
+
+        [[nodiscard]] RequestScheduler *scheduler() const { return request_scheduler.get(); }
+
+        /**
+         * Sets the tracer timing requests of this client, nullptr disables tracing.
+         * Not synchronized with requests in progress, meant to be called before the client is used.
+         */
+        void setTracer(std::shared_ptr<Tracer> tracer);
+
+        [[nodiscard]] Tracer *tracer() const { return request_tracer.get(); }
+
+    private:
+        static void lock(CURL *handle, curl_lock_data data, curl_lock_access access, void *userptr);
+        static void unlock(CURL *handle, curl_lock_data data, void *userptr);
+
+        CURLSH *share;
+        std::mutex share_locks[CURL_LOCK_DATA_LAST];
+
+        std::mutex pool_lock;
+        std::vector<CURL *> pool;
+
+        std::string base_url;
+        bool compressed = true;
+        HttpVersion http_version = HttpVersion::http2;
+
+        std::shared_ptr<ResponseCache> response_cache;
+        std::shared_ptr<ResultCache> result_cache;
+        std::shared_ptr<RequestScheduler> request_scheduler;
+        std::shared_ptr<Tracer> request_tracer;
+    };
+
+    /**
+     * Process-wide client used by the free functions when no client is given.
+     */
+    Client &defaultClient();
+}
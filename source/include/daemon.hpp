@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <optional>
+#include <string>
+
+/**
+ * Runs a command of the CLI, printing into the given streams.
+ * @returns Exit status of the command
+ */
+using CommandRunner = std::function<int(int argc, char **argv, std::FILE *out, std::FILE *err)>;
+
+/**
+ * @returns Socket the daemon listens on: CC_CLI_SOCKET, or cc-cli.sock in XDG_RUNTIME_DIR or the temporary directory
+ */
+std::filesystem::path defaultSocketPath();
+
+/**
+ * Serves commands forwarded by other cc-cli processes until interrupted. Every connection is handled by a thread
+ * of its own, with timeouts for receiving the command and sending its output, and commands run one at a time.
+ * Commands run in this process, so connections and caches stay warm between them.
+ *
+ * @param socket Path of the Unix socket to listen on, replaced when no daemon answers on it
+ * @param environment Settings the commands depend on, commands of clients with other settings are refused
+ * @param run Runs every received command
+ *
+ * @throws std::runtime_error Thrown in case the socket cannot be set up
+ * @returns Exit status of the daemon
+ */
+int serveCommands(const std::filesystem::path &socket, const std::string &environment, const CommandRunner &run);
+
+/**
+ * Runs the command in a daemon listening on the socket, copying its output to stdout and stderr.
+ *
+ * @param environment Settings the command depends on, as given to serveCommands()
+ *
+ * @returns Exit status of the command, or nothing when no daemon of this user with the same settings is running
+ */
+std::optional<int> forwardCommand(const std::filesystem::path &socket, const std::string &environment, int argc, char **argv);
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "cache.hpp"
+#include "ccapi.hpp"
+#include "endpoint.hpp"
+#include "json_stream.hpp"
+#include "trace.hpp"
+
+/**
+ * Internals shared between the blocking calls and the batch/async transports.
+ * Not a part of the public API.
+ */
+namespace ccapi::detail {
+
+    std::string url(const Client &client, const std::string &context);
+
+    /**
+     * Checks the outcome of a finished transfer.
+     *
+     * @throws std::runtime_error Thrown in case the transfer or the HTTP request failed
+     */
+    void check(CURL *handle, CURLcode curl_code);
+
+    struct StreamTarget {
+        CURL *handle;
+        JsonStream *stream;
+        ResponseCache::Writer *tee; // optional, receives the body as well
+        std::exception_ptr error;
+        RequestTrace *trace = nullptr; // optional, times the parsing
+        bool fed = false; // a part of the body reached the stream, the transfer cannot be repeated
+    };
+
+    /**
+     * Write callback feeding the received body straight into a JSON stream.
+     * Parse errors abort the transfer and are kept in the target to be rethrown after it.
+     * A stopped stream aborts the transfer as well, without an error, the rest of the body is not needed.
+     */
+    size_t stream_writer(void *ptr, size_t size, size_t nmemb, StreamTarget *target);
+
+    /**
+     * Handler decoding a response while it is received, with the result taken once the document
+     * ended or the handler stopped it.
+     */
+    template<typename T>
+    struct StreamDecoder {
+        std::shared_ptr<JsonHandler> handler;
+        std::function<T()> result;
+    };
+
+    /**
+     * Decodes a whole response of an endpoint.
+     *
+     * @throws std::runtime_error Thrown in case the response is malformed
+     */
+    template<typename Api>
+    typename Api::Result decode(const Api &api, std::string_view response) {
+        Reader<Api> reader(api);
+        JsonStream stream(reader);
+        stream.feed(response.data(), response.size());
+        stream.finish();
+        return reader.result();
+    }
+
+    /**
+     * @param limit Number of rows after which the rest of the listing is skipped, once its count is known
+     */
+    template<typename Api>
+    StreamDecoder<typename Api::Result> stream_decoder(const Api &api, std::size_t limit = NO_LIMIT) {
+        auto reader = std::make_shared<Reader<Api>>(api, limit);
+        return {reader, [reader] { return reader->result(); }};
+    }
+}
@@ -0,0 +1,588 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <list>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include "cache.hpp"
+#include "ccapi.hpp"
+#include "json_stream.hpp"
+
+/**
+ * Endpoints of the API described at compile time: the path of each one as a compiled format string and the fields
+ * of its response as a schema, from which a decoder specialized for the endpoint is generated.
+ * Not a part of the public API.
+ */
+namespace ccapi::detail {
+
+    inline constexpr auto NO_LIMIT = std::numeric_limits<std::size_t>::max();
+
+    // sizes announced by the server are only trusted this far, larger listings grow as they arrive
+    inline constexpr std::size_t MAX_RESERVED_VOTES = std::size_t{1} << 24;
+
+    /**
+     * Name of a JSON key, usable as a template argument.
+     */
+    template<std::size_t N>
+    struct Key {
+        constexpr Key(const char (&name)[N]) {
+            for (std::size_t index = 0; index < N; ++index)
+                value[index] = name[index];
+        }
+
+        [[nodiscard]] static constexpr std::size_t size() { return N - 1; }
+
+        char value[N]{};
+    };
+
+    template<Key Name, std::size_t Offset>
+    inline constexpr std::uint64_t packed_key = [] {
+        std::array<char, 8> bytes{};
+        for (std::size_t index = Offset; index < Name.size() && index < Offset + 8; ++index)
+            bytes[index - Offset] = Name.value[index];
+        return std::bit_cast<std::uint64_t>(bytes);
+    }();
+
+    template<std::size_t Size, std::size_t Offset>
+    inline std::uint64_t load_key(const char *data) {
+        std::array<char, 8> bytes{};
+        if constexpr (Size > Offset)
+            std::memcpy(bytes.data(), data + Offset, std::min<std::size_t>(Size - Offset, 8));
+        return std::bit_cast<std::uint64_t>(bytes);
+    }
+
+    /**
+     * Compares a key read from the document with one known at compile time. Keys of up to 16 bytes, which is
+     * every key of the API, are compared as two integers of a length known to the compiler, without a loop.
+     */
+    template<Key Name>
+    inline bool matches(std::string_view key) {
+        if (key.size() != Name.size())
+            return false;
+        if constexpr (Name.size() <= 16)
+            return load_key<Name.size(), 0>(key.data()) == packed_key<Name, 0>
+                   && load_key<Name.size(), 8>(key.data()) == packed_key<Name, 8>;
+        else
+            return key == std::string_view(Name.value, Name.size());
+    }
+
+    enum class As { value, time };
+
+    // a scalar of the document, strings and numbers are both handed over as their text
+    struct JsonString {
+        std::string_view text;
+    };
+
+    struct JsonNumber {
+        std::string_view text;
+    };
+
+    /**
+     * Member of a struct decoded from the value of a key. Values of another type than the member are skipped,
+     * numbers and times which do not fit the member fail the decode.
+     *
+     * @tparam Kind As::time parses a string of TIME_FORMAT into seconds since the epoch
+     */
+    template<Key Name, auto Member, As Kind = As::value>
+    struct Field {
+        static constexpr auto name = Name;
+        static constexpr auto member = Member;
+
+        template<typename Target>
+        static void set(Target &target, JsonString value) {
+            auto &field = target.*Member;
+            if constexpr (Kind == As::time) {
+                auto time = parseTime(value.text);
+                if (!time) {
+                    throw std::runtime_error(fmt::format("Malformed JSON response: bad time {} of {}", value.text,
+                                                         std::string_view(Name.value, Name.size())));
+                }
+                field = *time;
+            } else if constexpr (std::is_same_v<std::remove_reference_t<decltype(field)>, std::string>)
+                field.assign(value.text);
+        }
+
+        template<typename Target>
+        static void set(Target &target, JsonNumber value) {
+            auto &field = target.*Member;
+            using Type = std::remove_reference_t<decltype(field)>;
+            if constexpr (std::is_integral_v<Type> && !std::is_same_v<Type, bool> && Kind == As::value) {
+                auto end = value.text.data() + value.text.size();
+                auto [ptr, error] = std::from_chars(value.text.data(), end, field);
+                if (error != std::errc() || ptr != end) {
+                    throw std::runtime_error(fmt::format("Malformed JSON response: bad number {} of {}", value.text,
+                                                         std::string_view(Name.value, Name.size())));
+                }
+            }
+        }
+
+        template<typename Target>
+        static void set(Target &target, bool value) {
+            auto &field = target.*Member;
+            if constexpr (std::is_same_v<std::remove_reference_t<decltype(field)>, bool>)
+                field = value;
+        }
+
+        template<typename Target>
+        static void reset(Target &target) {
+            auto &field = target.*Member;
+            if constexpr (std::is_same_v<std::remove_reference_t<decltype(field)>, std::string>)
+                field.clear(); // keeps the capacity for the next row
+            else
+                field = {};
+        }
+    };
+
+    template<auto Left, auto Right>
+    constexpr bool same_member() {
+        if constexpr (std::is_same_v<decltype(Left), decltype(Right)>)
+            return Left == Right;
+        else
+            return false;
+    }
+
+    /**
+     * Fields of a JSON object decoded into a struct. A key is matched once, when it is read, to the index of its
+     * field, the value that follows goes straight to that member.
+     */
+    template<typename Target, typename... Fields>
+    struct Schema {
+        using type = Target;
+
+        static constexpr int NONE = -1;
+
+        /**
+         * @returns Index of the field of the key, NONE when the schema has no such field
+         */
+        static int find(std::string_view key) {
+            return find(key, std::index_sequence_for<Fields...>{});
+        }
+
+        /**
+         * @returns Index of the field decoded into the member
+         */
+        template<auto Member>
+        static constexpr int index() {
+            int found = NONE, index = 0;
+            ((found = found == NONE && same_member<Fields::member, Member>() ? index : found, ++index), ...);
+            return found;
+        }
+
+        template<typename Value>
+        static void set(int field, Target &target, Value value) {
+            set(field, target, value, std::index_sequence_for<Fields...>{});
+        }
+
+        static void reset([[maybe_unused]] Target &target) {
+            (Fields::reset(target), ...);
+        }
+
+    private:
+        template<std::size_t... Index>
+        static int find([[maybe_unused]] std::string_view key, std::index_sequence<Index...>) {
+            int found = NONE;
+            if constexpr (sizeof...(Fields) > 0)
+                (void) ((matches<Fields::name>(key) && (found = static_cast<int>(Index), true)) || ...);
+            return found;
+        }
+
+        template<typename Value, std::size_t... Index>
+        static void set([[maybe_unused]] int field, [[maybe_unused]] Target &target, [[maybe_unused]] Value value,
+                        std::index_sequence<Index...>) {
+            if constexpr (sizeof...(Fields) > 0)
+                (void) ((field == static_cast<int>(Index) && (Fields::set(target, value), true)) || ...);
+        }
+    };
+
+    struct Empty {};
+
+    struct VoteCount {
+        int vote_count = 0;
+    };
+
+    struct VoteRow {
+        std::string username;
+        std::int64_t date = 0;
+        bool delivered = false;
+    };
+
+    /**
+     * Rows of a response without a listing.
+     */
+    struct NoRows {
+        using Schema = detail::Schema<Empty>;
+
+        void reserve(std::size_t) {}
+        void add(Empty &) {}
+    };
+
+    /**
+     * Collects vote rows into columns, or hands each of them to a callback instead.
+     */
+    class VoteRows {
+    public:
+        using Schema = detail::Schema<VoteRow, Field<"username", &VoteRow::username>,
+                Field<"datetime", &VoteRow::date, As::time>, Field<"delivered", &VoteRow::delivered>>;
+
+        explicit VoteRows(const VoteCallback *callback = nullptr) : callback(callback) {}
+
+        void reserve(std::size_t count) {
+            if (!callback)
+                votes.reserve(std::min(count, MAX_RESERVED_VOTES));
+        }
+
+        void add(VoteRow &row) {
+            if (callback)
+                (*callback)(Vote{row.username, row.date, row.delivered});
+            else
+                votes.push_back(row.username, row.date, row.delivered);
+        }
+
+        VoteColumns votes;
+
+    private:
+        const VoteCallback *callback;
+    };
+
+    /**
+     * Collects rows into a list, in the order the API lists them.
+     */
+    template<typename RowSchema>
+    struct ListRows {
+        using Schema = RowSchema;
+
+        void reserve(std::size_t) {}
+        void add(typename Schema::type &row) { rows.push_back(std::move(row)); }
+
+        std::list<typename Schema::type> rows;
+    };
+
+    /**
+     * Decoder of the responses of one endpoint, generated from its descriptor.
+     *
+     * Every response of the API is an object with fields of the head, and listings keep their rows in an array
+     * under "data". Rows are handed to the rows of the descriptor as soon as their object is closed, the row is reused
+     * in between. Parsing stops after limit rows, once the count of the descriptor is known as well, which is
+     * also when the rows are reserved if the count comes before them. A count which the response does not have
+     * is the number of rows, every row is then read and only the first limit of them are kept.
+     *
+     * @tparam Api Descriptor with the Head schema, Rows collecting the listing, and optionally the member count
+     *             of the head holding the number of rows
+     */
+    template<typename Api>
+    class Reader : public JsonHandler {
+    public:
+        using Head = typename Api::Head;
+        using Rows = typename Api::Rows;
+        using Row = typename Rows::Schema;
+
+        explicit Reader(Api api, std::size_t limit = NO_LIMIT, Rows rows = Rows{})
+        : descriptor(std::move(api)), rows(std::move(rows)), limit(limit) {
+            if (limit == 0 && !COUNTED)
+                stop();
+        }
+
+        void begin_object() override {
+            if (++depth == 3 && in_rows)
+                Row::reset(row);
+        }
+
+        void end_object() override {
+            if (depth-- == 3 && in_rows) {
+                // rows past the limit are only counted, until the count of the head is known
+                if (row_count < limit)
+                    rows.add(row);
+                if (++row_count >= limit && counted)
+                    stop();
+            }
+        }
+
+        void begin_array() override {
+            if (++depth == 2 && field == ROWS)
+                in_rows = true;
+        }
+
+        void end_array() override {
+            if (depth-- == 2)
+                in_rows = false;
+        }
+
+        void key(std::string_view key) override {
+            if (depth == 1)
+                field = matches<"data">(key) ? ROWS : Head::find(key);
+            else if (depth == 3 && in_rows)
+                field = Row::find(key);
+            else
+                field = Head::NONE;
+        }
+
+        void string(std::string_view value) override {
+            set(JsonString{value});
+        }
+
+        void number(std::string_view value) override {
+            set(JsonNumber{value});
+            if constexpr (COUNT != Head::NONE) {
+                if (depth == 1 && field == COUNT) {
+                    counted = true;
+                    const auto count = head.*Api::count;
+                    if (row_count == 0 && count > 0)
+                        rows.reserve(std::min(static_cast<std::size_t>(count), limit));
+                    if (row_count >= limit)
+                        stop();
+                }
+            }
+        }
+
+        void boolean(bool value) override {
+            set(value);
+        }
+
+        [[nodiscard]] const typename Head::type &fields() const { return head; }
+
+        [[nodiscard]] const Api &api() const { return descriptor; }
+
+        /**
+         * @returns Response of the endpoint, the reader is left empty
+         */
+        typename Api::Result result() {
+            // without the count in the head, or without a head field for it, every row was counted
+            if constexpr (COUNTED) {
+                if (!counted)
+                    head.*Api::count = static_cast<int>(row_count);
+            }
+            return descriptor.result(std::move(head), std::move(rows));
+        }
+
+    private:
+        static constexpr bool COUNTED = requires { Api::count; };
+        static constexpr int ROWS = -2;
+        static constexpr int COUNT = [] {
+            if constexpr (COUNTED)
+                return Head::template index<Api::count>();
+            else
+                return Head::NONE;
+        }();
+
+        template<typename Value>
+        void set(Value value) {
+            if (depth == 1)
+                Head::set(field, head, value);
+            else if (depth == 3 && in_rows)
+                Row::set(field, row, value);
+        }
+
+        Api descriptor;
+        typename Head::type head{};
+        Rows rows;
+        typename Row::type row{};
+        std::size_t limit;
+        std::size_t row_count = 0;
+        bool counted = !COUNTED;
+        int field = Head::NONE;
+        std::size_t depth = 0;
+        bool in_rows = false;
+    };
+}
+
+/**
+ * Descriptors of the endpoints, each one with the arguments of a request.
+ */
+namespace ccapi::api {
+
+    using detail::As;
+    using detail::Field;
+    using detail::Schema;
+
+    struct ServerInfo {
+        using Result = ccapi::ServerInfo;
+        using Head = Schema<Result, Field<"address", &Result::address>, Field<"name", &Result::name>,
+                Field<"position", &Result::position>, Field<"slug", &Result::slug>, Field<"votes", &Result::votes>>;
+        using Rows = detail::NoRows;
+
+        std::string slug;
+
+        [[nodiscard]] std::string context() const { return fmt::format(FMT_COMPILE("server/{}"), slug); }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::server_info; }
+        Result result(Result &&head, Rows &&) const { return std::move(head); }
+    };
+
+    /**
+     * Every vote of a server, in the order the API lists them.
+     */
+    struct ServerVotes {
+        using Result = VoteVector;
+        using Head = Schema<detail::VoteCount, Field<"vote_count", &detail::VoteCount::vote_count>>;
+        using Rows = detail::VoteRows;
+        static constexpr auto count = &detail::VoteCount::vote_count;
+
+        std::string slug;
+
+        [[nodiscard]] std::string context() const { return fmt::format(FMT_COMPILE("server/{}/votes"), slug); }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::server_votes; }
+        Result result(detail::VoteCount &&head, Rows &&rows) const { return VoteVector(std::move(rows.votes), head.vote_count); }
+    };
+
+    /**
+     * Votes of a server in a month, newest first.
+     */
+    struct ServerVotesMonth {
+        using Result = VoteVector;
+        using Head = ServerVotes::Head;
+        using Rows = detail::VoteRows;
+        static constexpr auto count = ServerVotes::count;
+
+        std::string slug;
+        int month;
+        int year;
+
+        [[nodiscard]] std::string context() const {
+            return fmt::format(FMT_COMPILE("server/{}/votes/{}/{}"), slug, year, month);
+        }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::server_votes; }
+        [[nodiscard]] std::int64_t final_since() const { return monthFinal(month, year); }
+        Result result(detail::VoteCount &&head, Rows &&rows) const {
+            rows.votes.reverse();
+            return VoteVector(std::move(rows.votes), head.vote_count);
+        }
+    };
+
+    /**
+     * Leaderboard of a server, from the best voter.
+     */
+    struct TopVoters {
+        using Result = std::list<VoterInfo>;
+        using Head = Schema<detail::Empty>;
+        using Rows = detail::ListRows<Schema<VoterInfo, Field<"username", &VoterInfo::username>,
+                Field<"votes", &VoterInfo::vote_count>>>;
+
+        std::string slug;
+
+        [[nodiscard]] std::string context() const { return fmt::format(FMT_COMPILE("server/{}/voters"), slug); }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::top_voters; }
+        Result result(detail::Empty &&, Rows &&rows) const { return std::move(rows.rows); }
+    };
+
+    /**
+     * Leaderboard of a server with the number of its voters. The response has no such number,
+     * every row is counted and the rows past the limit are not kept.
+     */
+    struct CountedTopVoters {
+        using Result = VoterList;
+        using Head = Schema<detail::VoteCount>;
+        using Rows = TopVoters::Rows;
+        static constexpr auto count = &detail::VoteCount::vote_count;
+        static constexpr std::string_view variant = "counted"; // another result of the same request
+
+        std::string slug;
+
+        [[nodiscard]] std::string context() const { return TopVoters{slug}.context(); }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::top_voters; }
+        Result result(detail::VoteCount &&head, Rows &&rows) const { return VoterList(std::move(rows.rows), head.vote_count); }
+    };
+
+    /**
+     * Votes of a player, newest first.
+     */
+    struct UserVotes {
+        using Result = PlayerInfo;
+        using Head = Schema<PlayerInfo, Field<"username", &PlayerInfo::username>,
+                Field<"next_vote", &PlayerInfo::next_vote, As::time>, Field<"vote_count", &PlayerInfo::vote_count>>;
+        using Rows = detail::VoteRows;
+        static constexpr auto count = &PlayerInfo::vote_count;
+
+        std::string username;
+        std::string slug;
+
+        [[nodiscard]] std::string context() const {
+            return fmt::format(FMT_COMPILE("server/{}/player/{}"), slug, username);
+        }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::user_votes; }
+        Result result(PlayerInfo &&head, Rows &&rows) const {
+            head.votes = std::move(rows.votes);
+            head.votes.reverse();
+            return std::move(head);
+        }
+    };
+
+    /**
+     * Votes of a player in a month, newest first. The API leaves out the username and the next vote.
+     */
+    struct UserVotesMonth {
+        using Result = PlayerInfo;
+        using Head = Schema<PlayerInfo, Field<"vote_count", &PlayerInfo::vote_count>>;
+        using Rows = detail::VoteRows;
+        static constexpr auto count = &PlayerInfo::vote_count;
+
+        std::string username;
+        std::string slug;
+        int month;
+        int year;
+
+        [[nodiscard]] std::string context() const {
+            return fmt::format(FMT_COMPILE("server/{}/player/{}/{}/{}"), slug, username, year, month);
+        }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::user_votes; }
+        [[nodiscard]] std::int64_t final_since() const { return monthFinal(month, year); }
+        Result result(PlayerInfo &&head, Rows &&rows) const {
+            head.username = username;
+            head.next_vote = 0;
+            head.votes = std::move(rows.votes);
+            head.votes.reverse();
+            return std::move(head);
+        }
+    };
+
+    struct NextVote {
+        using Result = PlayerInfo;
+        using Head = Schema<PlayerInfo, Field<"username", &PlayerInfo::username>,
+                Field<"next_vote", &PlayerInfo::next_vote, As::time>>;
+        using Rows = detail::NoRows;
+
+        std::string username;
+        std::string slug;
+
+        [[nodiscard]] std::string context() const {
+            return fmt::format(FMT_COMPILE("server/{}/player/{}/next_vote"), slug, username);
+        }
+        [[nodiscard]] Endpoint endpoint() const { return Endpoint::next_vote; }
+        Result result(PlayerInfo &&head, Rows &&) const { return std::move(head); }
+    };
+}
+
+namespace ccapi::detail {
+
+    /**
+     * @returns Seconds since the epoch from which responses of the endpoint no longer change, 0 when they always may
+     */
+    template<typename Api>
+    std::int64_t final_since(const Api &api) {
+        if constexpr (requires { api.final_since(); })
+            return api.final_since();
+        else
+            return 0;
+    }
+
+    /**
+     * @returns Kind of the endpoint for a result decoded now, past_month once the listing no longer changes
+     */
+    template<typename Api>
+    Endpoint result_endpoint(const Api &api) {
+        if constexpr (requires { api.month; api.year; })
+            return monthEndpoint(api.endpoint(), api.month, api.year);
+        else
+            return api.endpoint();
+    }
+}
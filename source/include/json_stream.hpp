@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ccapi::detail {
+
+    /**
+     * Receives events from JsonStream. Views passed to the handler are valid only during the call.
+     * A handler which has all it needs can stop() the stream, the rest of the document is then skipped.
+     */
+    class JsonHandler {
+    public:
+        virtual ~JsonHandler() = default;
+
+        virtual void begin_object() {}
+        virtual void end_object() {}
+        virtual void begin_array() {}
+        virtual void end_array() {}
+        virtual void key(std::string_view) {}
+        virtual void string(std::string_view) {}
+        virtual void number(std::string_view) {}
+        virtual void boolean(bool) {}
+        virtual void null() {}
+
+        /**
+         * @returns Whether the handler stopped parsing before the end of the document
+         */
+        [[nodiscard]] bool stopped() const { return stop_requested; }
+
+    protected:
+        void stop() { stop_requested = true; }
+
+    private:
+        bool stop_requested = false;
+    };
+
+    /**
+     * Incremental (push) JSON parser.
+     *
+     * Input may be split at any byte, so chunks can be fed straight from a transfer
+     * as they arrive. Only the token currently being read is buffered, memory use
+     * does not depend on the size of the document.
+     */
+    class JsonStream {
+    public:
+        explicit JsonStream(JsonHandler &handler) : handler(handler) {}
+
+        /**
+         * Parses next chunk of the document.
+         *
+         * @throws std::runtime_error Thrown in case the document is malformed
+         */
+        void feed(const char *data, std::size_t size);
+
+        /**
+         * Signals end of the document. A document whose handler stopped the parsing counts as complete.
+         *
+         * @throws std::runtime_error Thrown in case the document is incomplete
+         */
+        void finish();
+
+        /**
+         * @returns Whether the handler stopped the parsing, further input is ignored
+         */
+        [[nodiscard]] bool stopped() const { return handler.stopped(); }
+
+        /**
+         * @returns Depth of the container currently being parsed, zero at top level
+         */
+        [[nodiscard]] std::size_t depth() const { return stack.size(); }
+
+    private:
+        enum class Lex { none, string, escape, unicode, number, literal };
+        enum class Expect { value, first_value, key, first_key, colon, next, end };
+
+        void structural(char c);
+        void value_done();
+        void string_done(std::string_view value);
+        void escape(char c);
+        void unicode(char c);
+        void literal_done();
+        [[noreturn]] void fail(const char *what) const;
+
+        JsonHandler &handler;
+        std::vector<char> stack;
+        std::string token;
+        Lex lex = Lex::none;
+        Expect expect = Expect::value;
+        bool is_key = false;
+        std::uint32_t code_point = 0;
+        std::uint32_t high_surrogate = 0;
+        int hex_digits = 0;
+    };
+}
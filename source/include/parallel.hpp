@@ -0,0 +1,22 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+
+namespace ccapi::detail {
+
+    // below this many votes per thread spawning costs more than it saves
+    inline constexpr std::size_t MIN_VOTES_PER_THREAD = 1 << 18;
+
+    /**
+     * @param threads Most threads to use, 0 for one per hardware thread
+     *
+     * @returns Number of threads worth splitting the votes between, at least 1
+     */
+    inline unsigned voteThreads(std::size_t votes, unsigned threads) {
+        if (threads == 0)
+            threads = std::max(1u, std::thread::hardware_concurrency());
+        return static_cast<unsigned>(std::clamp<std::size_t>(votes / MIN_VOTES_PER_THREAD, 1, threads));
+    }
+}
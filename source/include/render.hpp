@@ -0,0 +1,157 @@
+#pragma once
+
+#include <concepts>
+#include <cstdint>
+#include <cstdio>
+#include <iterator>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/compile.h>
+#include <fmt/format.h>
+
+#include "aggregate.hpp"
+#include "archive.hpp"
+#include "ccapi.hpp"
+#include "stats.hpp"
+
+enum class Format { text, json, ndjson, csv, tsv };
+
+/**
+ * @returns Format of the given name, or nothing when there is no such format
+ */
+std::optional<Format> parseFormat(std::string_view name);
+
+/**
+ * Output of a command, rendered into one buffer which is reused for the whole command and written out
+ * in large chunks. Results of a command are framed by the format: an array in JSON, one header in CSV and TSV.
+ */
+class Output {
+public:
+    Output(std::FILE *file, Format format) : file(file), output_format(format) {}
+
+    /**
+     * Closes the results and writes out what is left in the buffer.
+     */
+    ~Output();
+
+    Output(const Output &) = delete;
+    Output &operator=(const Output &) = delete;
+
+    [[nodiscard]] Format format() const { return output_format; }
+    [[nodiscard]] bool text() const { return output_format == Format::text; }
+
+    /**
+     * @returns Iterator appending to the buffer, for fmt::format_to. The buffer is written out first when it is full.
+     */
+    std::back_insert_iterator<fmt::memory_buffer> inserter();
+
+    /**
+     * Marks a boundary between rows, where a full buffer is written out.
+     */
+    void next_row();
+
+    void append(std::string_view value) { buffer.append(value.data(), value.data() + value.size()); }
+    void append(char value) { buffer.push_back(value); }
+
+    /**
+     * Appends a quoted JSON string.
+     */
+    void string(std::string_view value);
+
+    /**
+     * Appends a CSV or TSV field, quoted or cleaned up where needed, followed by the separator unless it is the last one.
+     */
+    void field(std::string_view value, bool last = false);
+
+    template<std::integral Value>
+    void field(Value value, bool last = false) {
+        fmt::format_to(std::back_inserter(buffer), FMT_COMPILE("{}"), value);
+        buffer.push_back(last ? '\n' : output_format == Format::csv ? ',' : '\t');
+    }
+
+    /**
+     * Starts the next result of the command, with a title shown when there are more of them.
+     */
+    void begin(std::string_view title, std::size_t count);
+
+    /**
+     * Drops the result begun last, which failed while being rendered, as long as none of it was written out yet.
+     */
+    void discard();
+
+    /**
+     * Writes the header of CSV and TSV output, once per command. Columns are separated by commas.
+     */
+    void header(std::string_view columns);
+
+    void flush();
+
+private:
+    struct Mark {
+        std::size_t size;
+        std::size_t results;
+        bool header_written;
+    };
+
+    std::FILE *file;
+    Format output_format;
+    fmt::memory_buffer buffer;
+    std::size_t results = 0;
+    bool header_written = false;
+    std::optional<Mark> mark; // state before the current result, while it is all in the buffer
+};
+
+void renderServerInfo(Output &out, const std::string &slug, const ccapi::ServerInfo &info);
+
+/**
+ * @param count Number of votes to render
+ */
+void renderServerVotes(Output &out, const std::string &slug, const ccapi::VoteVector &votes, std::size_t count);
+
+/**
+ * @param count Number of votes to render
+ */
+void renderPlayerVotes(Output &out, const std::string &slug, const std::string &username, const ccapi::PlayerInfo &profile,
+                       std::size_t count);
+
+/**
+ * @param total Number of all voters, when known
+ * @param count Number of voters to render
+ */
+void renderTopVoters(Output &out, const std::string &slug, const std::list<ccapi::VoterInfo> &voters,
+                     std::optional<std::size_t> total, std::size_t count);
+
+/**
+ * Renders standings of a player on every server of the index, with the votes on all of them together.
+ */
+void renderPlayerStandings(Output &out, const std::string &username, const ccapi::VoterIndex &index);
+
+void renderNextVote(Output &out, const std::string &slug, const std::string &username, const ccapi::PlayerInfo &info);
+
+/**
+ * @param count Number of streaks to render
+ */
+void renderVoteStats(Output &out, const std::string &slug, const ccapi::VoteHistogram &histogram,
+                     const std::vector<ccapi::VoteStreak> &streaks, const ccapi::StringTable &table, std::size_t count);
+
+/**
+ * Change noticed by the watch command.
+ */
+struct WatchEvent {
+    enum class Kind { entered, left, moved, position, votes, available, voted };
+
+    Kind kind;
+    std::int64_t time;         // in the frame of timestamps of the API
+    std::string_view slug;
+    std::string_view username; // empty for changes of the server
+    std::int64_t from = 0;     // previous rank, position or vote count
+    std::int64_t to = 0;       // current rank, position or vote count, the next vote date of a player who voted
+};
+
+void renderWatchEvent(Output &out, const WatchEvent &event);
+
+void renderSyncReport(Output &out, const std::string &slug, const ccapi::VoteArchive::SyncReport &report);
@@ -0,0 +1,129 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "cache.hpp"
+
+namespace ccapi {
+
+    /**
+     * In-process cache of decoded results, shared by the threads of one process.
+     *
+     * Concurrent calls asking for the same result share one fetch: the first caller performs it and
+     * the others wait for its outcome instead of sending identical requests. Results are then kept in
+     * a least recently used list bounded by the number of entries, each for the time to live of its
+     * endpoint kind. Failures are handed to every waiting caller and never kept.
+     *
+     * Keys are spread over independently locked shards, a lock is only held to look up or store an
+     * entry and never while fetching. Safe to use from multiple threads.
+     */
+    class ResultCache {
+    public:
+        /**
+         * Counters since the cache was created.
+         */
+        struct Stats {
+            std::uint64_t hits = 0;      // served by a kept result
+            std::uint64_t misses = 0;    // fetched by the caller
+            std::uint64_t coalesced = 0; // waited for a fetch of another caller
+            std::size_t entries = 0;     // results kept right now
+        };
+
+        /**
+         * @param capacity Maximum number of kept results, split evenly between the shards.
+         *                 Zero only coalesces concurrent calls
+         */
+        explicit ResultCache(std::size_t capacity = 1024);
+
+        /**
+         * Returns the kept result of the key, or waits for a fetch of the key already in progress,
+         * or performs the fetch itself. A key must always name a result of the same type.
+         *
+         * @param key Identifies the result, usually the endpoint path
+         * @param endpoint Kind of the endpoint, selects the time to live
+         * @param fetch Produces the result when it is neither kept nor being fetched
+         *
+         * @throws std::runtime_error Thrown by the fetch, to every caller waiting for it
+         * @returns Copy of the result. Votes get a string table of their own, the kept result is never written to.
+         *          A hit copies every vote and username of the result, so a hit on a whole listing such as
+         *          serverVotes(slug) saves the request and the decoding, but still costs time linear in its size
+         */
+        template<typename T, typename Fetch>
+        T fetch(const std::string &key, Endpoint endpoint, Fetch fetch) {
+            auto value = find_or_fetch(key, endpoint, [&]() -> Value { return std::make_shared<const T>(fetch()); });
+            T result = *std::static_pointer_cast<const T>(value);
+            if constexpr (requires { result.votes.clone(); })
+                result.votes = result.votes.clone();
+            return result;
+        }
+
+        [[nodiscard]] Stats stats() const;
+
+        /**
+         * @returns Time to live of the endpoint kind
+         */
+        [[nodiscard]] std::chrono::seconds ttl(Endpoint endpoint) const;
+
+        /**
+         * Not synchronized with calls in progress, meant to be called before the cache is used.
+         * Zero only coalesces concurrent calls of the endpoint kind.
+         */
+        void setTtl(Endpoint endpoint, std::chrono::seconds ttl);
+
+        /**
+         * Drops every kept result. Fetches in progress still reach their waiting callers, but are not kept.
+         */
+        void clear();
+
+    private:
+        using Value = std::shared_ptr<const void>;
+        using Clock = std::chrono::steady_clock;
+
+        struct Slot {
+            std::shared_future<Value> pending; // valid while the result is being fetched
+            std::uint64_t flight = 0;          // identifies the fetch, so a cleared slot is not overwritten
+            Value value;
+            Clock::time_point expires;
+            std::list<const std::string *>::iterator position; // in the order of its shard, once kept
+        };
+
+        // least recently used results are at the back of the order, results being fetched are not in it
+        struct Shard {
+            std::mutex lock;
+            std::unordered_map<std::string, Slot> slots;
+            std::list<const std::string *> order;
+        };
+
+        static constexpr std::size_t SHARDS = 16;
+
+        Value find_or_fetch(const std::string &key, Endpoint endpoint, const std::function<Value()> &fetch);
+        void keep(Shard &shard, const std::string &key, std::uint64_t flight, Value value, Endpoint endpoint);
+
+        Shard &shard(const std::string &key) const;
+
+        mutable std::array<Shard, SHARDS> shards;
+        std::size_t shard_capacity;
+        std::atomic<std::uint64_t> flights{0};
+        std::atomic<std::uint64_t> hits{0};
+        std::atomic<std::uint64_t> misses{0};
+        std::atomic<std::uint64_t> coalesced{0};
+        std::array<std::chrono::seconds, 6> ttls = {
+                std::chrono::minutes(5),    // server_info
+                std::chrono::minutes(5),    // server_votes
+                std::chrono::hours(1),      // top_voters
+                std::chrono::minutes(5),    // user_votes
+                std::chrono::minutes(1),    // next_vote
+                std::chrono::seconds::max() // past_month
+        };
+    };
+}
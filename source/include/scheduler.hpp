@@ -0,0 +1,123 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <random>
+
+#include <curl/curl.h>
+
+namespace ccapi {
+
+    /**
+     * Admission and retry policy shared by every transfer of a client.
+     *
+     * Limits how many requests are in flight with additive increase and multiplicative decrease.
+     * The limit doubles with every round of successful responses until the first sign of congestion, then
+     * grows by one per round. It is cut when the API answers 429 or 5xx, a transfer times out, or the time
+     * to the first byte climbs well above the lowest one seen, which means requests queue up on the server.
+     * A Retry-After header holds back new requests of the whole client until the time it gives.
+     * Failed requests are repeated after an exponential backoff with full jitter, every API call is an idempotent GET.
+     * Safe to use from multiple threads.
+     */
+    class RequestScheduler {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+        /**
+         * @param max_in_flight Most requests the limit may grow to
+         * @param initial Limit the scheduler starts with
+         * @param attempts Number of attempts of a request, including the first one
+         */
+        explicit RequestScheduler(std::size_t max_in_flight = 64, std::size_t initial = 8, int attempts = 4);
+
+        /**
+         * Waits until a request may start, for threads performing blocking transfers.
+         * Every acquired request has to be released once its transfer finished.
+         */
+        void acquire();
+
+        /**
+         * @returns Whether a request may start now, for event loops which cannot block
+         */
+        bool tryAcquire();
+
+        void release();
+
+        struct Decision {
+            bool retry = false;
+            clock_type::duration delay{}; // before the next attempt
+        };
+
+        /**
+         * Records how a transfer went, adjusting the limit, and decides whether to repeat it.
+         * Responses the API meant to give, such as 404, count as successes and are not repeated.
+         *
+         * @param attempt Number of the attempt which finished, starting with 1
+         * @param restartable Whether the transfer can be repeated, which it cannot once a part of its body was used
+         */
+        Decision finished(CURL *handle, CURLcode code, int attempt, bool restartable = true);
+
+        /**
+         * @returns Time until which new requests wait because the API asked for it, in the past when they need not
+         */
+        [[nodiscard]] clock_type::time_point resumeAt() const;
+
+        struct Stats {
+            std::size_t limit;
+            std::size_t in_flight;
+            std::size_t retries;
+            std::size_t throttled; // responses 429 and 503
+        };
+
+        [[nodiscard]] Stats stats() const;
+
+    private:
+        [[nodiscard]] bool admits(clock_type::time_point now) const;
+        void decrease(clock_type::time_point now, double factor);
+
+        mutable std::mutex lock;
+        std::condition_variable changed;
+
+        const double max_limit;
+        const int attempts;
+        double limit;
+        bool slow_start = true; // until the first sign of congestion
+        std::size_t in_flight = 0;
+
+        clock_type::time_point resume{};
+        clock_type::time_point last_decrease{};
+        clock_type::duration baseline{};   // low envelope of the time to the first byte
+        clock_type::duration smoothed{};   // moving average of the time to the first byte
+        std::size_t samples = 0;
+
+        std::size_t retries = 0;
+        std::size_t throttled = 0;
+        std::minstd_rand random;
+    };
+
+    namespace detail {
+
+        /**
+         * Admission of a blocking transfer, held until it finishes. Does nothing without a scheduler.
+         */
+        class SchedulerPermit {
+        public:
+            explicit SchedulerPermit(RequestScheduler *scheduler) : scheduler(scheduler) {
+                if (scheduler)
+                    scheduler->acquire();
+            }
+            ~SchedulerPermit() {
+                if (scheduler)
+                    scheduler->release();
+            }
+
+            SchedulerPermit(const SchedulerPermit &) = delete;
+            SchedulerPermit &operator=(const SchedulerPermit &) = delete;
+
+        private:
+            RequestScheduler *scheduler;
+        };
+    }
+}
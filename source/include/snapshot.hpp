@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+#include "cache.hpp"
+#include "ccapi.hpp"
+
+namespace ccapi {
+
+    /**
+     * Columnar binary snapshot of server votes, read in place from a memory mapping.
+     *
+     * A file holds a header and sections aligned to 8 bytes, all little-endian: dates as epoch seconds sorted
+     * from the oldest vote, username ids of every vote, delivered flags as a bitmap of 64-bit words, the
+     * dictionary of usernames sorted by name with the offsets of every name, and a table of offsets of the
+     * first vote of every month from the first to the last one. Opening a snapshot checks the header and
+     * the bounds of the sections only, columns are then read straight from the mapping.
+     */
+    class VoteSnapshot {
+    public:
+        static constexpr std::uint32_t VERSION = 1;
+
+        /**
+         * Writes votes into a snapshot, replacing the file atomically.
+         *
+         * @param votes Votes in any order
+         * @param vote_count Vote count reported by the API
+         *
+         * @throws std::runtime_error Thrown when the file cannot be written
+         */
+        static void write(const std::filesystem::path &path, const VoteColumns &votes, int vote_count);
+
+        /**
+         * @throws std::runtime_error Thrown when the file cannot be mapped, or is not a snapshot of this version
+         */
+        static VoteSnapshot open(const std::filesystem::path &path);
+
+        [[nodiscard]] std::size_t size() const { return dates.size(); }
+        [[nodiscard]] bool empty() const { return dates.empty(); }
+
+        /**
+         * @returns Vote count reported by the API when the snapshot was taken
+         */
+        [[nodiscard]] int voteCount() const { return vote_count; }
+
+        [[nodiscard]] std::span<const std::int64_t> date_column() const { return dates; }
+        [[nodiscard]] std::span<const std::uint32_t> user_column() const { return users; }
+        [[nodiscard]] std::span<const std::uint64_t> delivered_column() const { return delivered_bits; }
+        [[nodiscard]] bool delivered(std::size_t index) const { return delivered_bits[index / 64] >> (index % 64) & 1; }
+
+        /**
+         * @throws std::out_of_range Thrown when the dictionary has no such id
+         */
+        [[nodiscard]] std::string_view username(std::uint32_t id) const;
+
+        /**
+         * @returns Number of usernames in the dictionary
+         */
+        [[nodiscard]] std::size_t users_size() const { return name_offsets.empty() ? 0 : name_offsets.size() - 1; }
+
+        /**
+         * Looks the username up in the sorted dictionary.
+         *
+         * @returns Id of the username, or nothing when it did not vote
+         */
+        [[nodiscard]] std::optional<std::uint32_t> find(std::string_view username) const;
+
+        /**
+         * @throws std::out_of_range Thrown when index is not below size()
+         */
+        [[nodiscard]] Vote operator[](std::size_t index) const;
+
+        /**
+         * Seeks votes of a range of months with the offset table.
+         *
+         * @returns Indexes [first, last) of votes dated within the months from and to, both included
+         */
+        [[nodiscard]] std::pair<std::size_t, std::size_t> range(YearMonth from, YearMonth to) const;
+
+        /**
+         * Copies votes [first, last) into a container for the analyses taking one, interning their usernames.
+         */
+        [[nodiscard]] VoteColumns votes(std::size_t first, std::size_t last) const;
+        [[nodiscard]] VoteColumns votes() const { return votes(0, size()); }
+
+    private:
+        MappedFile file;
+        int vote_count = 0;
+        std::span<const std::int64_t> dates;
+        std::span<const std::uint32_t> users;
+        std::span<const std::uint64_t> delivered_bits;
+        std::span<const std::uint32_t> name_offsets; // name of id i spans [name_offsets[i], name_offsets[i + 1])
+        std::string_view names;
+        std::int64_t first_month = 0;                // year * 12 + month - 1 of months[0]
+        std::span<const std::uint64_t> months;       // first vote of every month, then the number of votes
+    };
+}
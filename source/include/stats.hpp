@@ -0,0 +1,61 @@
+#pragma once
+
+#include "votes.hpp"
+
+#include <array>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace ccapi {
+
+    /**
+     * Distribution of votes over the calendar. Times are taken as the API reports them, without any time zone.
+     */
+    struct VoteHistogram {
+        std::array<std::uint64_t, 24> hours{};
+        std::array<std::uint64_t, 7> weekdays{}; // monday first
+        std::array<std::uint64_t, 31> days{};    // day of the month, the first one at index 0
+        std::uint64_t total = 0;
+        std::uint64_t delivered = 0;
+        std::int64_t first = std::numeric_limits<std::int64_t>::max(); // date of the earliest vote
+        std::int64_t last = std::numeric_limits<std::int64_t>::min();  // date of the latest vote
+
+        /**
+         * Adds counts of a partial result.
+         */
+        void merge(const VoteHistogram &other);
+    };
+
+    /**
+     * Voting days of a single user.
+     */
+    struct VoteStreak {
+        StringTable::Id user;
+        std::uint32_t days = 0;        // days with at least one vote
+        std::uint32_t longest = 0;     // longest run of consecutive days with a vote
+        std::int64_t longest_end = 0;  // midnight of the last day of the longest run
+        std::uint32_t current = 0;     // run still going on the last day of the listing, or the day before
+    };
+
+    /**
+     * Builds the histograms of votes dated within [from, to), splitting large inputs between threads.
+     *
+     * Dates are bucketed a block at a time with 32-bit arithmetic relative to the earliest day, so the
+     * per-vote work is a branch-free loop the compiler vectorizes. Votes are first counted per day, the
+     * weekdays and days of the month are then resolved once per distinct day.
+     *
+     * @param threads number of worker threads, 0 for the hardware concurrency
+     */
+    VoteHistogram voteHistogram(VoteSpan votes, std::int64_t from = std::numeric_limits<std::int64_t>::min(),
+                                std::int64_t to = std::numeric_limits<std::int64_t>::max(), unsigned threads = 0);
+
+    /**
+     * Finds voting streaks of every user with a vote dated within [from, to).
+     * Votes ordered by date either way are read in one pass, other orders are sorted first.
+     *
+     * @returns Streaks ordered by the longest run, then by the number of days, then by user id
+     */
+    std::vector<VoteStreak> voteStreaks(VoteSpan votes, std::int64_t from = std::numeric_limits<std::int64_t>::min(),
+                                        std::int64_t to = std::numeric_limits<std::int64_t>::max());
+}
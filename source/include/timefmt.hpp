@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <ctime>
+#include <optional>
+#include <string_view>
+
+namespace ccapi {
+
+    /**
+     * Length of a timestamp in the "%Y-%m-%d %H:%M:%S" layout used by the API.
+     */
+    constexpr std::size_t TIME_LENGTH = 19;
+
+    /**
+     * Parses a timestamp in the "%Y-%m-%d %H:%M:%S" layout, without locale and without allocating.
+     *
+     * @param text Timestamp, exactly TIME_LENGTH characters long
+     * @returns Seconds since the epoch, or nothing when the text is not a valid timestamp, such as a day past the end of its month
+     */
+    std::optional<std::int64_t> parseTime(std::string_view text);
+
+    /**
+     * Formats a timestamp in the "%Y-%m-%d %H:%M:%S" layout. Years outside of 0-9999 are not supported.
+     *
+     * @param epoch Seconds since the epoch
+     * @param out Buffer of at least TIME_LENGTH characters, no terminating null is written
+     * @returns View of the written characters
+     */
+    std::string_view formatTime(std::int64_t epoch, char *out);
+
+    /**
+     * Converts calendar time to seconds since the epoch. Fields are taken as they are, without any time zone.
+     */
+    std::int64_t toEpoch(const std::tm &tm);
+
+    /**
+     * Converts seconds since the epoch back to calendar time, the inverse of toEpoch().
+     */
+    std::tm fromEpoch(std::int64_t epoch);
+
+    /**
+     * Converts seconds since the epoch to the frame of timestamps of the API. The API writes wall-clock time of
+     * Prague, UTC+1 and UTC+2 in summer by the EU rules, which parseTime() and toEpoch() read as if it were UTC.
+     */
+    std::int64_t toApiTime(std::int64_t epoch);
+
+    /**
+     * Converts a timestamp of the API back to seconds since the epoch, the inverse of toApiTime().
+     * Wall-clock times repeated when summer time ends are taken as the first of the two.
+     */
+    std::int64_t fromApiTime(std::int64_t time);
+
+    /**
+     * @returns Current time in the frame of timestamps of the API
+     */
+    std::int64_t apiNow();
+
+    /**
+     * @returns Days since 1970-01-01 of a proleptic gregorian date
+     */
+    constexpr std::int64_t daysFromCivil(std::int64_t year, unsigned month, unsigned day) {
+        year -= month <= 2;
+        const std::int64_t era = (year >= 0 ? year : year - 399) / 400;
+        const auto yoe = static_cast<unsigned>(year - era * 400);
+        const unsigned doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+        const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+    }
+}
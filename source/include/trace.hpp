@@ -0,0 +1,188 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include <curl/curl.h>
+
+namespace ccapi {
+
+    /**
+     * Collects timings of requests and of the phases around them, for --stats and --trace.
+     *
+     * Nothing is measured unless a tracer is set on the client, every instrumented site only checks
+     * a null pointer otherwise. Safe to use from multiple threads.
+     */
+    class Tracer {
+    public:
+        using clock_type = std::chrono::steady_clock;
+
+        enum class Source { network, not_modified, cache };
+
+        struct Request {
+            std::string context;
+            Source source = Source::cache;
+            std::uint32_t lane = 0;
+            clock_type::time_point start;
+            // network phases as reported by CURL, zero for phases the transfer skipped
+            std::chrono::microseconds dns{}, connect{}, tls{}, wait{}, transfer{}, total{};
+            std::chrono::nanoseconds parse{};
+            std::int64_t bytes = 0; // received, before decompression
+            long connects = 0;      // connections the transfer opened, none when it reused one
+            bool http2 = false;
+            bool streamed = false; // parsed while being received, so parse overlaps the transfer
+        };
+
+        struct Span {
+            std::string name;
+            std::string category;
+            clock_type::time_point start;
+            clock_type::time_point end;
+            std::uint32_t lane = 0;
+        };
+
+        Tracer() : origin(clock_type::now()) {}
+
+        /**
+         * @returns Fresh lane, concurrent requests are laid out on separate lanes of the timeline
+         */
+        std::uint32_t lane();
+
+        void record(Request request);
+        void record(Span span);
+
+        struct Totals {
+            std::size_t requests = 0; // which went over the network
+            std::size_t http2 = 0;    // of them over HTTP/2
+            std::size_t connections = 0;
+            std::int64_t bytes = 0;
+        };
+
+        [[nodiscard]] Totals totals() const;
+
+        /**
+         * Fills network phases of a finished transfer.
+         */
+        static void measure(CURL *handle, Request &request);
+
+        /**
+         * Prints a per-phase breakdown of every request and span.
+         */
+        void writeStats(std::FILE *out) const;
+
+        /**
+         * Writes everything recorded as Chrome trace-event JSON, viewable in chrome://tracing or Perfetto.
+         *
+         * @throws std::runtime_error Thrown in case the file cannot be written
+         */
+        void writeTrace(const std::string &path) const;
+
+    private:
+        clock_type::time_point origin;
+        mutable std::mutex lock;
+        std::uint32_t lanes = 0;
+        std::vector<Request> requests;
+        std::vector<Span> spans;
+    };
+
+    /**
+     * Measures the enclosing scope as a span, does nothing without a tracer.
+     */
+    class TraceScope {
+    public:
+        TraceScope(Tracer *tracer, std::string_view name, std::string_view category) : tracer(tracer) {
+            if (tracer)
+                span = Tracer::Span{std::string(name), std::string(category), Tracer::clock_type::now(), {}, 0};
+        }
+
+        ~TraceScope() {
+            if (tracer) {
+                span.end = Tracer::clock_type::now();
+                tracer->record(std::move(span));
+            }
+        }
+
+        TraceScope(const TraceScope &) = delete;
+        TraceScope &operator=(const TraceScope &) = delete;
+
+    private:
+        Tracer *tracer;
+        Tracer::Span span;
+    };
+
+    namespace detail {
+
+        /**
+         * Timings of a single request, recorded when it finishes or is destroyed.
+         */
+        class RequestTrace {
+        public:
+            RequestTrace() = default;
+            RequestTrace(Tracer *tracer, const std::string &context) : tracer(tracer) {
+                if (tracer)
+                    request = Tracer::Request{context, Tracer::Source::cache, tracer->lane(), Tracer::clock_type::now()};
+            }
+
+            RequestTrace(RequestTrace &&other) noexcept
+            : tracer(std::exchange(other.tracer, nullptr)), request(std::move(other.request)) {}
+            RequestTrace &operator=(RequestTrace &&other) noexcept {
+                finish();
+                tracer = std::exchange(other.tracer, nullptr);
+                request = std::move(other.request);
+                return *this;
+            }
+            ~RequestTrace() { finish(); }
+
+            [[nodiscard]] bool enabled() const { return tracer != nullptr; }
+
+            void transferred(CURL *handle, bool not_modified) {
+                if (tracer) {
+                    request.source = not_modified ? Tracer::Source::not_modified : Tracer::Source::network;
+                    Tracer::measure(handle, request);
+                }
+            }
+
+            /**
+             * Runs the decoder, adding its duration to the parse phase.
+             */
+            template<typename Decode>
+            auto parse(Decode &&decode) {
+                if (!tracer)
+                    return decode();
+                auto start = Tracer::clock_type::now();
+                if constexpr (std::is_void_v<decltype(decode())>) {
+                    decode();
+                    request.parse += Tracer::clock_type::now() - start;
+                } else {
+                    auto result = decode();
+                    request.parse += Tracer::clock_type::now() - start;
+                    return result;
+                }
+            }
+
+            /**
+             * Adds time spent parsing a chunk of a streamed response.
+             */
+            void add_parse(std::chrono::nanoseconds duration) {
+                request.parse += duration;
+                request.streamed = true;
+            }
+
+            void finish() {
+                if (tracer)
+                    std::exchange(tracer, nullptr)->record(std::move(request));
+            }
+
+        private:
+            Tracer *tracer = nullptr;
+            Tracer::Request request;
+        };
+    }
+}
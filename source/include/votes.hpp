@@ -0,0 +1,209 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace ccapi {
+
+    /**
+     * Interns strings, every distinct string is stored once and referred to by a dense id.
+     * Characters and index entries are carved out of one arena, so a table of many users costs a few
+     * large allocations, all released at once with the table.
+     * Not synchronized, tables shared between threads must be guarded by the caller.
+     */
+    class StringTable {
+    public:
+        using Id = std::uint32_t;
+
+        StringTable() = default;
+        StringTable(const StringTable &) = delete;
+        StringTable &operator=(const StringTable &) = delete;
+
+        /**
+         * @returns Id of the string, adding it to the table when seen for the first time
+         */
+        Id intern(std::string_view value);
+
+        /**
+         * @returns Id of the string, or nothing when it is not in the table
+         */
+        [[nodiscard]] std::optional<Id> find(std::string_view value) const;
+
+        [[nodiscard]] std::string_view operator[](Id id) const { return strings[id]; }
+        [[nodiscard]] std::size_t size() const { return strings.size(); }
+
+    private:
+        std::pmr::monotonic_buffer_resource arena; // never moves what it handed out, so the views stay valid
+        std::vector<std::string_view> strings;
+        std::pmr::unordered_map<std::string_view, Id> index{&arena};
+    };
+
+    /**
+     * Single vote, a view of a row of VoteColumns.
+     */
+    struct Vote {
+        std::string_view username;
+        std::int64_t date; // seconds since the epoch
+        bool delivered;
+    };
+
+    class VoteSpan;
+
+    /**
+     * Struct-of-arrays vote container.
+     *
+     * Dates are stored as epoch seconds, usernames as ids into a string table which may be shared
+     * between containers, and delivered flags as a bitset. Rows are materialized as Vote views on access.
+     */
+    class VoteColumns {
+    public:
+        class iterator {
+        public:
+            using iterator_category = std::random_access_iterator_tag;
+            using value_type = Vote;
+            using difference_type = std::ptrdiff_t;
+            using reference = Vote;
+            using pointer = void;
+
+            iterator() = default;
+            iterator(const VoteColumns *columns, std::size_t index) : columns(columns), index(index) {}
+
+            Vote operator*() const { return (*columns)[index]; }
+            Vote operator[](difference_type offset) const { return (*columns)[index + offset]; }
+
+            iterator &operator++() { ++index; return *this; }
+            iterator operator++(int) { auto copy = *this; ++index; return copy; }
+            iterator &operator--() { --index; return *this; }
+            iterator operator--(int) { auto copy = *this; --index; return copy; }
+            iterator &operator+=(difference_type offset) { index += offset; return *this; }
+            iterator &operator-=(difference_type offset) { index -= offset; return *this; }
+            iterator operator+(difference_type offset) const { return {columns, index + offset}; }
+            iterator operator-(difference_type offset) const { return {columns, index - offset}; }
+            difference_type operator-(const iterator &other) const { return static_cast<difference_type>(index - other.index); }
+
+            bool operator==(const iterator &other) const { return index == other.index; }
+            auto operator<=>(const iterator &other) const { return index <=> other.index; }
+
+        private:
+            const VoteColumns *columns = nullptr;
+            std::size_t index = 0;
+        };
+
+        explicit VoteColumns(std::shared_ptr<StringTable> names = std::make_shared<StringTable>())
+        : names(std::move(names)) {}
+
+        void push_back(std::string_view username, std::int64_t date, bool delivered) {
+            push_back(names->intern(username), date, delivered);
+        }
+
+        void push_back(StringTable::Id user, std::int64_t date, bool delivered) {
+            if (dates.size() % 64 == 0)
+                delivered_bits.push_back(0);
+            delivered_bits.back() |= static_cast<std::uint64_t>(delivered) << (dates.size() % 64);
+            dates.push_back(date);
+            users.push_back(user);
+        }
+
+        /**
+         * Appends all votes of another container, re-interning usernames when the tables differ.
+         */
+        void append(const VoteColumns &other);
+
+        void reserve(std::size_t count);
+
+        /**
+         * @returns Copy of the votes with a string table of its own, which may be used on another thread than this one
+         */
+        [[nodiscard]] VoteColumns clone() const;
+
+        /**
+         * Reverses order of the votes.
+         */
+        void reverse();
+
+        void clear();
+
+        [[nodiscard]] Vote operator[](std::size_t index) const {
+            return Vote{(*names)[users[index]], dates[index], delivered(index)};
+        }
+
+        [[nodiscard]] std::size_t size() const { return dates.size(); }
+        [[nodiscard]] bool empty() const { return dates.empty(); }
+
+        [[nodiscard]] iterator begin() const { return {this, 0}; }
+        [[nodiscard]] iterator end() const { return {this, size()}; }
+
+        [[nodiscard]] VoteSpan view() const;
+
+        [[nodiscard]] bool delivered(std::size_t index) const { return delivered_bits[index / 64] >> (index % 64) & 1; }
+
+        /**
+         * @returns Number of delivered votes among count votes from offset, counted a word of flags at a time
+         */
+        [[nodiscard]] std::size_t count_delivered(std::size_t offset, std::size_t count) const;
+        [[nodiscard]] std::span<const std::int64_t> date_column() const { return dates; }
+        [[nodiscard]] std::span<const StringTable::Id> user_column() const { return users; }
+        [[nodiscard]] std::span<const std::uint64_t> delivered_column() const { return delivered_bits; }
+
+        [[nodiscard]] const StringTable &table() const { return *names; }
+        [[nodiscard]] const std::shared_ptr<StringTable> &shared_table() const { return names; }
+
+    private:
+        std::shared_ptr<StringTable> names;
+        std::vector<std::int64_t> dates;
+        std::vector<StringTable::Id> users;
+        std::vector<std::uint64_t> delivered_bits;
+    };
+
+    /**
+     * Non-owning view of a contiguous range of votes, in the manner of std::span.
+     */
+    class VoteSpan {
+    public:
+        using iterator = VoteColumns::iterator;
+
+        VoteSpan() = default;
+        VoteSpan(const VoteColumns &columns) : VoteSpan(columns, 0, columns.size()) {}
+        VoteSpan(const VoteColumns &columns, std::size_t offset, std::size_t count)
+        : columns(&columns), offset(offset), count(count) {}
+
+        [[nodiscard]] Vote operator[](std::size_t index) const { return (*columns)[offset + index]; }
+        [[nodiscard]] std::size_t size() const { return count; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+
+        [[nodiscard]] iterator begin() const { return {columns, offset}; }
+        [[nodiscard]] iterator end() const { return {columns, offset + count}; }
+
+        /**
+         * @returns View of at most the first n votes
+         */
+        [[nodiscard]] VoteSpan first(std::size_t n) const { return {*columns, offset, std::min(n, count)}; }
+
+        [[nodiscard]] VoteSpan subspan(std::size_t from, std::size_t n = SIZE_MAX) const {
+            from = std::min(from, count);
+            return {*columns, offset + from, std::min(n, count - from)};
+        }
+
+        [[nodiscard]] std::span<const std::int64_t> date_column() const { return columns->date_column().subspan(offset, count); }
+        [[nodiscard]] std::span<const StringTable::Id> user_column() const { return columns->user_column().subspan(offset, count); }
+        [[nodiscard]] bool delivered(std::size_t index) const { return columns->delivered(offset + index); }
+        [[nodiscard]] std::size_t delivered_count() const { return count ? columns->count_delivered(offset, count) : 0; }
+        [[nodiscard]] const StringTable &table() const { return columns->table(); }
+
+    private:
+        const VoteColumns *columns = nullptr;
+        std::size_t offset = 0;
+        std::size_t count = 0;
+    };
+
+    inline VoteSpan VoteColumns::view() const { return {*this}; }
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace ccapi {
+
+    struct VoterInfo;
+
+    /**
+     * Change of a leaderboard between two snapshots.
+     */
+    struct RankChange {
+        enum class Kind { entered, left, moved };
+
+        Kind kind;
+        std::string username;
+        std::size_t from = 0; // rank in the previous snapshot, 1 for the best voter, 0 when not there
+        std::size_t to = 0;   // rank in the current snapshot, 0 when not there
+        int votes = 0;        // votes in the current snapshot, or the previous one of a voter who left
+    };
+
+    /**
+     * Compares two leaderboards, each ordered from the best voter.
+     *
+     * Voters present in both are matched by username, the longest run of them keeping their relative order
+     * is found in O(n log n). Only the voters outside of it are reported as moved, so a voter entering or
+     * leaving does not also report every voter below shifting by one rank.
+     *
+     * @returns Voters who left, then voters who entered or moved, in the order of the current leaderboard
+     */
+    std::vector<RankChange> diffLeaderboards(const std::list<VoterInfo> &before, const std::list<VoterInfo> &after);
+
+    /**
+     * Hashed timing wheel of deadlines in epoch seconds.
+     *
+     * A deadline goes into the slot of its second, modulo the number of slots, so scheduling is O(1)
+     * and advancing the clock only visits the slots of the seconds that passed. Deadlines further away
+     * than one revolution wait in their slot until their round comes.
+     * Not synchronized, meant to be driven by one thread.
+     */
+    class TimerWheel {
+    public:
+        using Id = std::size_t;
+
+        /**
+         * @param now Current time, deadlines before it are due on the next advance
+         * @param slots Number of seconds one revolution covers
+         */
+        explicit TimerWheel(std::int64_t now, std::size_t slots = 4096);
+
+        /**
+         * Adds a deadline. An id may be scheduled more than once.
+         */
+        void schedule(Id id, std::int64_t when);
+
+        /**
+         * Moves the clock forward.
+         *
+         * @returns Ids whose deadlines are at or before now, earliest first
+         */
+        std::vector<Id> advance(std::int64_t now);
+
+        /**
+         * @returns Earliest deadline, or nothing when none is scheduled
+         */
+        [[nodiscard]] std::optional<std::int64_t> next() const;
+
+        [[nodiscard]] std::size_t size() const { return count; }
+        [[nodiscard]] bool empty() const { return count == 0; }
+
+    private:
+        struct Timer {
+            Id id;
+            std::int64_t when;
+        };
+
+        [[nodiscard]] std::vector<Timer> &slot(std::int64_t when) {
+            return slots[static_cast<std::size_t>(when % static_cast<std::int64_t>(slots.size()))];
+        }
+
+        std::vector<std::vector<Timer>> slots;
+        std::int64_t current; // every deadline up to this second has fired
+        std::size_t count = 0;
+    };
+}
@@ -0,0 +1,286 @@
+#include "json_stream.hpp"
+
+#include <cstring>
+#include <stdexcept>
+
+#include <fmt/format.h>
+
+using namespace ccapi::detail;
+
+static bool is_number_char(char c) {
+    return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+}
+
+static bool is_literal_char(char c) {
+    return c >= 'a' && c <= 'z';
+}
+
+static void append_utf8(std::string &out, std::uint32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+void
+JsonStream::feed(const char *data, std::size_t size) {
+    const char *p = data;
+    const char *end = data + size;
+
+    while (p < end && !handler.stopped()) {
+        switch (lex) {
+            case Lex::string: {
+                // a high surrogate escape must be followed by the escape of a low one
+                if (high_surrogate && *p != '\\')
+                    fail("invalid unicode escape");
+
+                // fast path, whole string inside this chunk without escapes is passed through without copying
+                auto q = p;
+                while (q < end && *q != '"' && *q != '\\') {
+                    if (static_cast<unsigned char>(*q) < 0x20)
+                        fail("control character in string");
+                    ++q;
+                }
+                if (q == end) {
+                    token.append(p, q);
+                } else if (*q == '"') {
+                    lex = Lex::none;
+                    if (token.empty()) {
+                        string_done({p, static_cast<std::size_t>(q - p)});
+                    } else {
+                        token.append(p, q);
+                        string_done(token);
+                        token.clear();
+                    }
+                    ++q;
+                } else {
+                    token.append(p, q);
+                    lex = Lex::escape;
+                    ++q;
+                }
+                p = q;
+                break;
+            }
+            case Lex::escape:
+                escape(*p++);
+                break;
+            case Lex::unicode:
+                unicode(*p++);
+                break;
+            case Lex::number: {
+                auto q = p;
+                while (q < end && is_number_char(*q))
+                    ++q;
+                token.append(p, q);
+                p = q;
+                if (q < end) {
+                    lex = Lex::none;
+                    handler.number(token);
+                    token.clear();
+                    value_done();
+                }
+                break;
+            }
+            case Lex::literal: {
+                auto q = p;
+                while (q < end && is_literal_char(*q))
+                    ++q;
+                token.append(p, q);
+                p = q;
+                if (q < end)
+                    literal_done();
+                break;
+            }
+            case Lex::none:
+                structural(*p++);
+                break;
+        }
+    }
+}
+
+void
+JsonStream::finish() {
+    if (handler.stopped())
+        return;
+
+    if (lex == Lex::number && stack.empty()) {
+        lex = Lex::none;
+        handler.number(token);
+        token.clear();
+        value_done();
+    } else if (lex == Lex::literal) {
+        literal_done();
+    }
+
+    if (lex != Lex::none || expect != Expect::end)
+        fail("unexpected end of document");
+}
+
+void
+JsonStream::structural(char c) {
+    switch (c) {
+        case ' ': case '\t': case '\n': case '\r':
+            return;
+        case '{':
+            if (expect != Expect::value && expect != Expect::first_value)
+                fail("unexpected '{'");
+            stack.push_back('{');
+            expect = Expect::first_key;
+            handler.begin_object();
+            return;
+        case '[':
+            if (expect != Expect::value && expect != Expect::first_value)
+                fail("unexpected '['");
+            stack.push_back('[');
+            expect = Expect::first_value;
+            handler.begin_array();
+            return;
+        case '}':
+            if ((expect != Expect::first_key && expect != Expect::next) || stack.empty() || stack.back() != '{')
+                fail("unexpected '}'");
+            stack.pop_back();
+            handler.end_object();
+            value_done();
+            return;
+        case ']':
+            if ((expect != Expect::first_value && expect != Expect::next) || stack.empty() || stack.back() != '[')
+                fail("unexpected ']'");
+            stack.pop_back();
+            handler.end_array();
+            value_done();
+            return;
+        case ',':
+            if (expect != Expect::next)
+                fail("unexpected ','");
+            expect = stack.back() == '{' ? Expect::key : Expect::value;
+            return;
+        case ':':
+            if (expect != Expect::colon)
+                fail("unexpected ':'");
+            expect = Expect::value;
+            return;
+        case '"':
+            if (expect == Expect::key || expect == Expect::first_key)
+                is_key = true;
+            else if (expect == Expect::value || expect == Expect::first_value)
+                is_key = false;
+            else
+                fail("unexpected string");
+            lex = Lex::string;
+            return;
+        default:
+            if (expect != Expect::value && expect != Expect::first_value)
+                fail("unexpected character");
+            if (is_number_char(c))
+                lex = Lex::number;
+            else if (is_literal_char(c))
+                lex = Lex::literal;
+            else
+                fail("unexpected character");
+            token.push_back(c);
+    }
+}
+
+void
+JsonStream::value_done() {
+    expect = stack.empty() ? Expect::end : Expect::next;
+}
+
+void
+JsonStream::string_done(std::string_view value) {
+    if (is_key) {
+        handler.key(value);
+        expect = Expect::colon;
+    } else {
+        handler.string(value);
+        value_done();
+    }
+}
+
+void
+JsonStream::escape(char c) {
+    if (high_surrogate && c != 'u')
+        fail("invalid unicode escape");
+    lex = Lex::string;
+    switch (c) {
+        case '"': token.push_back('"'); break;
+        case '\\': token.push_back('\\'); break;
+        case '/': token.push_back('/'); break;
+        case 'b': token.push_back('\b'); break;
+        case 'f': token.push_back('\f'); break;
+        case 'n': token.push_back('\n'); break;
+        case 'r': token.push_back('\r'); break;
+        case 't': token.push_back('\t'); break;
+        case 'u':
+            lex = Lex::unicode;
+            code_point = 0;
+            hex_digits = 0;
+            break;
+        default:
+            fail("invalid escape sequence");
+    }
+}
+
+void
+JsonStream::unicode(char c) {
+    std::uint32_t digit;
+    if (c >= '0' && c <= '9')
+        digit = c - '0';
+    else if (c >= 'a' && c <= 'f')
+        digit = c - 'a' + 10;
+    else if (c >= 'A' && c <= 'F')
+        digit = c - 'A' + 10;
+    else
+        fail("invalid unicode escape");
+
+    code_point = (code_point << 4) | digit;
+    if (++hex_digits < 4)
+        return;
+
+    lex = Lex::string;
+    bool high = code_point >= 0xD800 && code_point <= 0xDBFF;
+    bool low = code_point >= 0xDC00 && code_point <= 0xDFFF;
+    if (high_surrogate) {
+        if (!low)
+            fail("invalid unicode escape");
+        code_point = 0x10000 + ((high_surrogate - 0xD800) << 10) + (code_point - 0xDC00);
+        high_surrogate = 0;
+    } else if (high) {
+        high_surrogate = code_point;
+        return;
+    } else if (low) {
+        fail("invalid unicode escape");
+    }
+    append_utf8(token, code_point);
+}
+
+void
+JsonStream::literal_done() {
+    lex = Lex::none;
+    if (token == "true")
+        handler.boolean(true);
+    else if (token == "false")
+        handler.boolean(false);
+    else if (token == "null")
+        handler.null();
+    else
+        fail("invalid literal");
+    token.clear();
+    value_done();
+}
+
+void
+JsonStream::fail(const char *what) const {
+    throw std::runtime_error(fmt::format("Malformed JSON response: {}", what));
+}
@@ -1,30 +1,318 @@
 #include "ccapi.hpp"
+#include "aggregate.hpp"
+#include "archive.hpp"
+#include "batch.hpp"
+#include "cache.hpp"
+#include "daemon.hpp"
+#include "render.hpp"
+#include "snapshot.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
 #include "version.hpp"
+#include "watch.hpp"
 #include <fmt/format.h>
+#include <algorithm>
 #include <chrono>
+#include <cstdio>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <thread>
+#include <vector>
 
-void displayHelp() {
-    fmt::print( "CzechCraft CLI version {}.{}\n"
-               "Usage: cc-cli <command> [arguments]\n"
-               "Commands:\n"
-               " info                       display server information\n"
-               " votes                      display server or user votes\n"
-               " top  | topvoters           display server top voters\n"
-               " next | nextvote            display next vote date\n"
-               "Arguments:\n"
-               " -h, --help                 display overall help or command specific help\n"
-               " -s, --slug [slug]          specify server slug\n"
-               " -u, --username [username]  specify player username\n"
-               " -y, --year [year]          specify year span\n"
-               " -m, --month [month]        specify month span\n"
-               " -l, --limit [number|all]   specify limit\n",
+void displayHelp(std::FILE *output) {
+    fmt::print(output, "CzechCraft CLI version {}.{}\n"
+                       "Usage: cc-cli <command> [arguments]\n"
+                       "Commands:\n"
+                       " info                       display server information\n"
+                       " votes                      display server or user votes\n"
+                       " top  | topvoters           display server top voters\n"
+                       " next | nextvote            display next vote date\n"
+                       " player                     display standings of a player on every given server\n"
+                       " stats                      display vote distributions and voting streaks\n"
+                       " sync                       update local vote archive of a server\n"
+                       " export                     write all votes of a server, or a binary snapshot of them\n"
+                       " watch                      keep polling servers and players, printing what changes\n"
+                       " serve                      keep running and answer commands of other cc-cli processes\n"
+                       "Arguments:\n"
+                       " -h, --help                 display overall help or command specific help\n"
+                       " -s, --slug [slug,...]      specify server slug, or a comma separated list of them\n"
+                       " -u, --username [name,...]  specify player username, or a comma separated list of them\n"
+                       " -y, --year [year]          specify year span\n"
+                       " -m, --month [month]        specify month span\n"
+                       "     --from [YYYY-MM]       specify first month of a range\n"
+                       "     --to [YYYY-MM]         specify last month of a range, the current month by default\n"
+                       " -d, --days [number]        specify a range of the last given days\n"
+                       " -l, --limit [number|all]   specify limit\n"
+                       " -p, --parallel [number]    specify how many requests may run at once\n"
+                       " -i, --interval [seconds]   specify how often watch polls servers, 60 by default\n"
+                       " -f, --format [format]      specify output format: text, json, ndjson, csv or tsv, or ccbin for export\n"
+                       " -o, --output [file]        specify file of an export snapshot, <slug>.ccbin by default\n"
+                       "     --merged               rank voters of all the given servers together\n"
+                       "     --all-slugs            search the given servers and every server archived by sync\n"
+                       "     --indexed              look players up in one listing of the server votes, not a request each\n"
+                       "     --no-cache             always fetch fresh data, bypassing the response cache\n"
+                       "     --no-compression       receive responses uncompressed\n"
+                       "     --http1                use HTTP/1.1 instead of multiplexing requests over HTTP/2\n"
+                       "     --stats                print time spent in every phase of every request\n"
+                       "     --trace [file]         write a Chrome trace of the requests into file\n"
+                       "     --socket [path]        specify socket of the daemon\n"
+                       "     --local                run the command in this process even when a daemon is running\n",
                CC_CLI_VERSION_MAJOR, CC_CLI_VERSION_MINOR
     );
 }
 
-int main(int argc, char **argv) {
+std::vector<std::string> splitList(const std::string &list) {
+    std::vector<std::string> items;
+    std::size_t start = 0;
+    while (start <= list.size()) {
+        auto end = list.find(',', start);
+        if (end == std::string::npos)
+            end = list.size();
+        if (end > start)
+            items.emplace_back(list.substr(start, end - start));
+        start = end + 1;
+    }
+    return items;
+}
+
+std::optional<ccapi::YearMonth> parseYearMonth(const std::string &text) {
+    int year, month;
+    char separator;
+    std::istringstream input(text);
+    if (!(input >> year >> separator >> month) || separator != '-' || month < 1 || month > 12 || !input.eof())
+        return std::nullopt;
+    return ccapi::YearMonth{year, month};
+}
+
+// the month as the API counts it, months of its listings follow its wall clock
+ccapi::YearMonth currentMonth() {
+    auto now = ccapi::fromEpoch(ccapi::apiNow());
+    return {now.tm_year + 1900, now.tm_mon + 1};
+}
+
+// months of a range are fetched at once, months which are over come from the archive when it has them
+struct ServerVotes {
+    std::vector<std::optional<ccapi::VoteVector>> archived;
+    std::vector<std::size_t> requests;
+};
+
+ServerVotes queueServerVotes(ccapi::Batch &batch, const ccapi::VoteArchive &archive, const std::string &slug,
+                             std::optional<ccapi::YearMonth> from, std::optional<ccapi::YearMonth> to,
+                             std::optional<std::size_t> limit = std::nullopt) {
+    ServerVotes source;
+    if (!from) {
+        source.archived.emplace_back();
+        source.requests.push_back(limit ? batch.serverVotes(slug, *limit) : batch.serverVotes(slug));
+        return source;
+    }
+    for (auto month = *to; month >= *from; month = month.previous()) {
+        auto &archived = source.archived.emplace_back(archive.month(slug, month.month, month.year));
+        source.requests.push_back(archived ? 0 : batch.serverVotes(slug, month.month, month.year));
+    }
+    return source;
+}
+
+ccapi::VoteVector collectServerVotes(const ccapi::Batch &batch, const ServerVotes &source) {
+    std::vector<const ccapi::VoteVector *> months;
+    for (std::size_t month = 0; month < source.requests.size(); ++month) {
+        months.push_back(source.archived[month] ? &*source.archived[month]
+                                                : &batch.get<ccapi::VoteVector>(source.requests[month]));
+    }
+    return months.size() == 1 ? *months.front() : ccapi::mergeMonths(months);
+}
+
+/**
+ * @returns Votes dated since the given time, in the same order
+ */
+ccapi::VoteColumns votesSince(const ccapi::VoteColumns &votes, std::int64_t since) {
+    const auto dates = votes.date_column();
+    const auto users = votes.user_column();
+    ccapi::VoteColumns kept(votes.shared_table());
+    for (std::size_t index = 0; index < votes.size(); ++index) {
+        if (dates[index] >= since)
+            kept.push_back(users[index], dates[index], votes.delivered(index));
+    }
+    return kept;
+}
+
+// one listing of votes per server, grouped by player when a player of the server is first looked up
+struct ServerPlayers {
+    std::vector<ServerVotes> sources;
+    std::vector<std::optional<ccapi::PlayerIndex>> indexes;
+
+    const ccapi::PlayerIndex &index(const ccapi::Batch &batch, std::size_t server, ccapi::Tracer *tracer,
+                                    const std::string &slug) {
+        if (indexes.size() < sources.size())
+            indexes.resize(sources.size());
+        auto &players = indexes[server];
+        if (!players) {
+            auto votes = collectServerVotes(batch, sources[server]);
+            ccapi::TraceScope scope(tracer, slug, "index");
+            players.emplace(votes.votes);
+        }
+        return *players;
+    }
+};
+
+std::size_t resolveLimit(int limit, std::size_t fallback, std::size_t size) {
+    if (limit == -1)
+        return std::min(fallback, size);
+    if (limit == -2)
+        return size;
+    return std::min<std::size_t>(limit, size);
+}
+
+// number of rows a listing prints, passed down so that the transfer stops once they are received
+std::optional<std::size_t> rowLimit(int limit, std::size_t fallback) {
+    if (limit == -2)
+        return std::nullopt;
+    return resolveLimit(limit, fallback, std::numeric_limits<std::size_t>::max());
+}
+
+std::int64_t epochNow() {
+    return std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Polls leaderboards and server information every interval, and next vote dates of players when they are due,
+ * printing only what changed since the previous poll. Runs until the process is stopped.
+ *
+ * @param limit Number of leaderboard rows compared, or nothing for the whole leaderboard
+ */
+int watchChanges(Output &out, std::FILE *output, std::FILE *errors, const std::vector<std::string> &slugs,
+                 const std::vector<std::string> &usernames, std::optional<std::size_t> limit, int interval, int parallel) {
+    struct Server {
+        std::string slug;
+        std::optional<ccapi::ServerInfo> info;
+        std::optional<std::list<ccapi::VoterInfo>> voters;
+    };
+    struct Player {
+        std::size_t server;
+        std::string username;
+        std::optional<std::int64_t> next_vote; // as the API reports it
+        bool available = false; // announced that the next vote date passed
+    };
+    std::vector<Server> servers;
+    std::vector<Player> players;
+    for (const auto &slug : slugs) {
+        servers.push_back(Server{slug, std::nullopt, std::nullopt});
+        for (const auto &username : usernames)
+            players.push_back(Player{servers.size() - 1, username, std::nullopt});
+    }
+
+    // timers below the number of servers poll a server, the rest poll a player
+    auto now = epochNow();
+    ccapi::TimerWheel wheel(now - 1);
+    for (std::size_t id = 0; id < servers.size() + players.size(); ++id)
+        wheel.schedule(id, now);
+    if (out.text()) {
+        fmt::format_to(out.inserter(), "Watching {} servers and {} players, polling servers every {} s\n", servers.size(),
+                       players.size(), interval);
+    }
+
+    auto failed = [&](std::string_view title, const std::exception &ex) {
+        out.flush();
+        fmt::print(errors, "Failed to process request for {}. Cause: {}\n", title, ex.what());
+    };
+
+    for (;;) {
+        now = epochNow();
+        const auto stamp = ccapi::toApiTime(now); // events are dated like the next vote dates of the API
+        ccapi::Batch batch;
+        std::vector<std::pair<std::size_t, std::size_t>> polls; // timer and its first request
+        for (auto id : wheel.advance(now)) {
+            if (id < servers.size()) {
+                polls.emplace_back(id, batch.serverInfo(servers[id].slug));
+                limit ? batch.topVoters(servers[id].slug, *limit) : batch.topVoters(servers[id].slug);
+                continue;
+            }
+            // a known date passing needs no request, the player is polled again later to notice the vote
+            auto &player = players[id - servers.size()];
+            if (player.next_vote && ccapi::fromApiTime(*player.next_vote) <= now && !player.available) {
+                player.available = true;
+                renderWatchEvent(out, {WatchEvent::Kind::available, stamp, servers[player.server].slug, player.username});
+                wheel.schedule(id, now + interval);
+                continue;
+            }
+            polls.emplace_back(id, batch.nextVote(player.username, servers[player.server].slug));
+        }
+        batch.run(parallel);
+
+        for (const auto &[id, request] : polls) {
+            if (id < servers.size()) {
+                auto &server = servers[id];
+                wheel.schedule(id, now + interval);
+                try {
+                    const auto &info = batch.get<ccapi::ServerInfo>(request);
+                    if (server.info && server.info->position != info.position)
+                        renderWatchEvent(out, {WatchEvent::Kind::position, stamp, server.slug, {}, server.info->position, info.position});
+                    if (server.info && server.info->votes != info.votes)
+                        renderWatchEvent(out, {WatchEvent::Kind::votes, stamp, server.slug, {}, server.info->votes, info.votes});
+                    server.info = info;
+                } catch (std::exception &ex) {
+                    failed(server.slug, ex);
+                }
+                try {
+                    auto voters = batch.get<std::list<ccapi::VoterInfo>>(request + 1);
+                    if (server.voters) {
+                        for (const auto &change : ccapi::diffLeaderboards(*server.voters, voters)) {
+                            const auto kind = change.kind == ccapi::RankChange::Kind::entered ? WatchEvent::Kind::entered
+                                              : change.kind == ccapi::RankChange::Kind::left ? WatchEvent::Kind::left
+                                              : WatchEvent::Kind::moved;
+                            renderWatchEvent(out, {kind, stamp, server.slug, change.username,
+                                                   static_cast<std::int64_t>(change.from), static_cast<std::int64_t>(change.to)});
+                        }
+                    }
+                    server.voters = std::move(voters);
+                } catch (std::exception &ex) {
+                    failed(server.slug, ex);
+                }
+                continue;
+            }
+
+            auto &player = players[id - servers.size()];
+            const auto &slug = servers[player.server].slug;
+            try {
+                // timers run in UTC, the date is converted once and reported as the API wrote it
+                auto next_vote = batch.get<ccapi::PlayerInfo>(request).next_vote;
+                auto due = ccapi::fromApiTime(next_vote);
+                if (player.next_vote && *player.next_vote != next_vote && due > now)
+                    renderWatchEvent(out, {WatchEvent::Kind::voted, stamp, slug, player.username, 0, next_vote});
+                player.next_vote = next_vote;
+                if (due > now) {
+                    player.available = false;
+                    wheel.schedule(id, due);
+                } else {
+                    if (!player.available)
+                        renderWatchEvent(out, {WatchEvent::Kind::available, stamp, slug, player.username});
+                    player.available = true;
+                    wheel.schedule(id, now + interval);
+                }
+            } catch (std::exception &ex) {
+                failed(fmt::format("{}/{}", slug, player.username), ex);
+                wheel.schedule(id, now + interval);
+            }
+        }
+        out.flush();
+        std::fflush(output);
+
+        if (auto next = wheel.next())
+            std::this_thread::sleep_until(std::chrono::system_clock::time_point(std::chrono::seconds(*next)));
+    }
+}
+
+std::shared_ptr<ccapi::ResponseCache> sharedCache() {
+    static auto cache = std::make_shared<ccapi::ResponseCache>();
+    return cache;
+}
+
+/**
+ * Runs a command, printing into output and errors, which are the streams of the client a daemon serves.
+ */
+int run(int argc, char **argv, std::FILE *output, std::FILE *errors) {
     if(argc < 2) {
-        displayHelp();
+        displayHelp(output);
         return 0;
     }
     std::string action { argv[1] };
@@ -35,7 +323,23 @@ int main(int argc, char **argv) {
             int year = -1;
             int month = -1;
             int limit = -1;
+            std::optional<ccapi::YearMonth> from;
+            std::optional<ccapi::YearMonth> to;
+            int days = -1;
+            int parallel = 8;
+            int interval = 60;
             bool help = false;
+            bool cache = true;
+            bool compression = true;
+            bool http2 = true;
+            bool stats = false;
+            bool merged = false;
+            bool all_slugs = false;
+            bool indexed = false;
+            bool snapshot = false;
+            std::string trace;
+            std::string file;
+            Format format = Format::text;
     };
 
     auto params = args();
@@ -44,46 +348,46 @@ int main(int argc, char **argv) {
         std::string arg {argv[index]};
         if(arg == "--username" || arg == "-u") {
             if(index + 1 >= argc) {
-                fmt::print("Username requires an argument\n");
+                fmt::print(output, "Username requires an argument\n");
                 return 0;
             }
             else
                 params.username = argv[++index];
         } else if (arg == "--slug" || arg == "-s") {
             if(index + 1 >= argc) {
-                fmt::print("Slug requires an argument\n");
+                fmt::print(output, "Slug requires an argument\n");
                 return 0;
             }
             else
                 params.slug = argv[++index];
         } else if (arg == "--year" || arg == "-y") {
             if(index + 1 >= argc) {
-                fmt::print("Year requires an argument\n");
+                fmt::print(output, "Year requires an argument\n");
                 return 0;
             }
             else {
                 params.year = atoi(argv[++index]);
                 if(params.year == 0) {
-                    fmt::print("Bad value for parameter year\n");
+                    fmt::print(output, "Bad value for parameter year\n");
                     return 0;
                 }
             }
         } else if (arg == "--month" || arg == "-m") {
             if(index + 1 >= argc) {
-                fmt::print("Month requires an argument\n");
+                fmt::print(output, "Month requires an argument\n");
                 return 0;
             }
             else {
                 params.month = atoi(argv[++index]);
-                if(params.month == 0){
-                    fmt::print("Bad value for parameter month\n");
+                if(params.month < 1 || params.month > 12){
+                    fmt::print(output, "Bad value for parameter month\n");
                     return 0;
                 }
             }
         }
         else if (arg == "--limit" || arg == "-l") {
             if(index + 1 >= argc) {
-                fmt::print("Limit requires an argument\n");
+                fmt::print(output, "Limit requires an argument\n");
                 return 0;
             }
             else {
@@ -92,133 +396,578 @@ int main(int argc, char **argv) {
                     continue;
                 }
 
-                params.limit = atoi(argv[++index]);
-                if(params.limit == 0) {
-                    fmt::print("Bad value for parameter limit\n");
+                params.limit = atoi(argv[index]);
+                if(params.limit <= 0) {
+                    fmt::print(output, "Bad value for parameter limit\n");
+                    return 0;
+                }
+            }
+        } else if (arg == "--parallel" || arg == "-p") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "Parallel requires an argument\n");
+                return 0;
+            }
+            else {
+                params.parallel = atoi(argv[++index]);
+                if(params.parallel <= 0) {
+                    fmt::print(output, "Bad value for parameter parallel\n");
+                    return 0;
+                }
+            }
+        } else if (arg == "--interval" || arg == "-i") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "Interval requires an argument\n");
+                return 0;
+            }
+            else {
+                params.interval = atoi(argv[++index]);
+                if(params.interval <= 0) {
+                    fmt::print(output, "Bad value for parameter interval\n");
                     return 0;
                 }
             }
+        } else if (arg == "--from" || arg == "--to") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "{} requires an argument\n", arg == "--from" ? "From" : "To");
+                return 0;
+            }
+            else {
+                auto month = parseYearMonth(argv[++index]);
+                if(!month) {
+                    fmt::print(output, "Bad value for parameter {}, expected YYYY-MM\n", arg.substr(2));
+                    return 0;
+                }
+                (arg == "--from" ? params.from : params.to) = month;
+            }
+        } else if (arg == "--days" || arg == "-d") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "Days requires an argument\n");
+                return 0;
+            }
+            else {
+                params.days = atoi(argv[++index]);
+                if(params.days <= 0) {
+                    fmt::print(output, "Bad value for parameter days\n");
+                    return 0;
+                }
+            }
+        } else if (arg == "--format" || arg == "-f") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "Format requires an argument\n");
+                return 0;
+            }
+            else if(std::string(argv[++index]) == "ccbin")
+                params.snapshot = true;
+            else {
+                auto format = parseFormat(argv[index]);
+                if(!format) {
+                    fmt::print(output, "Bad value for parameter format, expected text, json, ndjson, csv or tsv\n");
+                    return 0;
+                }
+                params.format = *format;
+            }
+        } else if (arg == "--no-cache") {
+            params.cache = false;
+        } else if (arg == "--no-compression") {
+            params.compression = false;
+        } else if (arg == "--http1") {
+            params.http2 = false;
+        } else if (arg == "--stats") {
+            params.stats = true;
+        } else if (arg == "--merged") {
+            params.merged = true;
+        } else if (arg == "--all-slugs") {
+            params.all_slugs = true;
+        } else if (arg == "--indexed") {
+            params.indexed = true;
+        } else if (arg == "--output" || arg == "-o") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "Output requires an argument\n");
+                return 0;
+            }
+            else
+                params.file = argv[++index];
+        } else if (arg == "--trace") {
+            if(index + 1 >= argc) {
+                fmt::print(output, "Trace requires an argument\n");
+                return 0;
+            }
+            else
+                params.trace = argv[++index];
         } else if (arg == "--help" || arg == "-h") {
             params.help = true;
         }
     }
 
     if(action == "--help") {
-        displayHelp();
+        displayHelp(output);
         return 0;
     }
 
+    ccapi::defaultClient().setCache(params.cache ? sharedCache() : nullptr);
+    ccapi::defaultClient().setCompression(params.compression);
+    ccapi::defaultClient().setHttpVersion(params.http2 ? ccapi::Client::HttpVersion::http2 : ccapi::Client::HttpVersion::http1);
+
+    // reports collected timings once the command is done, whichever way it returns
+    struct TraceReport {
+        std::shared_ptr<ccapi::Tracer> tracer;
+        bool stats;
+        std::string path;
+        std::FILE *output;
+        std::FILE *errors;
+
+        ~TraceReport() {
+            if (!tracer)
+                return;
+            std::fflush(output);
+            if (stats)
+                tracer->writeStats(errors);
+            try {
+                if (!path.empty())
+                    tracer->writeTrace(path);
+            } catch (std::exception &ex) {
+                fmt::print(errors, "{}\n", ex.what());
+            }
+        }
+    } trace_report{params.stats || !params.trace.empty() ? std::make_shared<ccapi::Tracer>() : nullptr,
+                   params.stats, params.trace, output, errors};
+    ccapi::defaultClient().setTracer(trace_report.tracer);
+    auto tracer = trace_report.tracer.get();
+
+    // votes of the rolling window are fetched by whole months and cut by date afterwards, both in the frame
+    // of the vote dates of the API
+    std::int64_t since = std::numeric_limits<std::int64_t>::min();
+    if (params.days > 0) {
+        since = ccapi::apiNow() - params.days * std::int64_t{86400};
+        auto first = ccapi::fromEpoch(since);
+        params.from = ccapi::YearMonth{first.tm_year + 1900, first.tm_mon + 1};
+        params.to.reset();
+    }
+    if (params.snapshot && action != "export") {
+        fmt::print(output, "Format ccbin is supported by export only\n");
+        return 0;
+    }
+    if (params.to && !params.from) {
+        fmt::print(output, "Range requires parameter from\n");
+        return 0;
+    }
+    if (params.from && !params.to)
+        params.to = currentMonth();
+    if (!params.from && params.month > 0 && params.year > 0)
+        params.from = params.to = ccapi::YearMonth{params.year, params.month};
+    if (params.from && *params.from > *params.to) {
+        fmt::print(output, "Range ends before it begins\n");
+        return 0;
+    }
+
+    auto slugs = splitList(params.slug);
+    auto usernames = splitList(params.username);
+    ccapi::Batch batch;
+
+    // written out before the timings are reported
+    Output out(output, params.format);
+
+    // renders every result in the order it was requested, failures of machine-readable output go to errors
+    auto report = [&](const std::vector<std::string> &titles, auto render) {
+        int status = 0;
+        for (std::size_t index = 0; index < titles.size(); ++index) {
+            out.begin(titles[index], titles.size());
+            try {
+                ccapi::TraceScope scope(tracer, titles[index], "render");
+                render(index);
+            } catch (std::exception &ex) {
+                if (out.text()) {
+                    fmt::format_to(out.inserter(), "Failed to process request. Cause: {}\n", ex.what());
+                } else {
+                    out.discard();
+                    out.flush();
+                    fmt::print(errors, "Failed to process request for {}. Cause: {}\n", titles[index], ex.what());
+                }
+                status = 1;
+            }
+        }
+        return status;
+    };
+
     try {
         if(action == "info") {
             if(params.slug == "N/S" || params.help)
-                fmt::print("Required parameters: slug\n");
+                fmt::print(output, "Required parameters: slug\n");
             else {
-                auto info = ccapi::serverInfo(params.slug);
-                fmt::print("Name: {}\nAddress: {}\nPosition: {}\nVotes: {}\n", info.name, info.address, info.position,
-                           info.votes);
+                for (const auto &slug : slugs)
+                    batch.serverInfo(slug);
+                batch.run(params.parallel);
 
+                return report(slugs, [&](std::size_t index) {
+                    renderServerInfo(out, slugs[index], batch.get<ccapi::ServerInfo>(index));
+                });
             }
             return 0;
         }
 
         if(action == "votes") {
             if(params.slug == "N/S" || params.help)
-                fmt::print("Required parameters: slug\n"
-                           "Optional parameters: username, limit\n");
+                fmt::print(output, "Required parameters: slug\n"
+                                   "Optional parameters: username, limit, year, month, from, to, days, parallel, indexed\n");
             else if(params.username == "N/S") { // server votes
-                ccapi::VoteVector voteInfo;
-                if(params.month > 0 && params.year > 0)
-                    voteInfo = ccapi::serverVotes(params.slug, params.month, params.year);
-                else
-                    voteInfo = ccapi::serverVotes(params.slug);
-
-                fmt::print("Total vote count: {}\n", voteInfo.vote_count);
-
-                if (params.limit == -1)
-                    params.limit = 100;
+                ccapi::VoteArchive archive;
+                std::vector<ServerVotes> sources;
+                for (const auto &slug : slugs)
+                    sources.push_back(queueServerVotes(batch, archive, slug, params.from, params.to, rowLimit(params.limit, 100)));
+                batch.run(params.parallel);
 
-                if(params.limit > voteInfo.votes.size() || params.limit == -2)
-                    params.limit = voteInfo.votes.size();
-
-                char buffer[32] = {0};
-                int index = 0;
-                for (const auto &item : voteInfo.votes) {
-                    if(index++ >= params.limit)
-                        break;
-                    std::strftime(buffer, 32, ccapi::TIME_FORMAT, &item.date);
-                    fmt::print(" |{}| {} - {}\n", std::string(buffer), item.username,
-                               item.delivered ? "Delivered" : "Not delivered");
+                return report(slugs, [&](std::size_t index) {
+                    auto votes = collectServerVotes(batch, sources[index]);
+                    if (params.days > 0) {
+                        votes.votes = votesSince(votes.votes, since);
+                        votes.vote_count = static_cast<int>(votes.votes.size());
+                    }
+                    renderServerVotes(out, slugs[index], votes, resolveLimit(params.limit, 100, votes.votes.size()));
+                });
+            } else if (params.indexed) { // player votes, from the votes of the whole server
+                ccapi::VoteArchive archive;
+                ServerPlayers servers;
+                std::vector<std::string> titles;
+                for (const auto &slug : slugs) {
+                    servers.sources.push_back(queueServerVotes(batch, archive, slug, params.from, params.to));
+                    for (const auto &username : usernames)
+                        titles.emplace_back(fmt::format("{}/{}", slug, username));
                 }
-                return 0;
+                batch.run(params.parallel);
+
+                const auto now = ccapi::apiNow(); // vote dates are in the frame of the API
+                return report(titles, [&](std::size_t index) {
+                    const auto server = index / usernames.size();
+                    const auto &username = usernames[index % usernames.size()];
+                    auto profile = servers.index(batch, server, tracer, slugs[server]).player(username, now);
+                    if (params.days > 0) {
+                        profile.votes = votesSince(profile.votes, since);
+                        profile.vote_count = static_cast<int>(profile.votes.size());
+                    }
+                    renderPlayerVotes(out, slugs[server], username, profile,
+                                      resolveLimit(params.limit, 10, profile.votes.size()));
+                });
             } else { // player votes
-                auto profile = ccapi::userVotes(params.username, params.slug);
-                if (params.limit == -1)
-                    params.limit = 10;
-                if(params.limit > profile.votes.size() || params.limit == -2)
-                    params.limit = profile.votes.size();
-
-                if(profile.votes.empty()) {
-                    fmt::print("No votes found for player {}\n", params.username);
-                    return 0;
+                struct Source {
+                    std::string slug;
+                    std::string username;
+                    std::size_t next_vote;
+                    std::vector<std::size_t> requests;
+                };
+                std::vector<Source> sources;
+                std::vector<std::string> titles;
+                for (const auto &slug : slugs) {
+                    for (const auto &username : usernames) {
+                        auto &source = sources.emplace_back(Source{slug, username, 0, {}});
+                        titles.emplace_back(fmt::format("{}/{}", slug, username));
+                        if (!params.from) {
+                            source.requests.push_back(batch.userVotes(username, slug));
+                            continue;
+                        }
+                        source.next_vote = batch.nextVote(username, slug);
+                        for (auto month = *params.to; month >= *params.from; month = month.previous())
+                            source.requests.push_back(batch.userVotes(username, slug, month.month, month.year));
+                    }
                 }
+                batch.run(params.parallel);
 
-                char buffer[32] = {0};
-                std::strftime(buffer, 32, ccapi::TIME_FORMAT, &profile.next_vote);
-                fmt::print("Vote count: {}\n"
-                           "Next vote: {}\n"
-                           "Votes:\n", profile.vote_count, std::string(buffer));
+                return report(titles, [&](std::size_t index) {
+                    const auto &source = sources[index];
+                    if (!params.from) {
+                        const auto &profile = batch.get<ccapi::PlayerInfo>(source.requests.front());
+                        renderPlayerVotes(out, source.slug, source.username, profile,
+                                          resolveLimit(params.limit, 10, profile.votes.size()));
+                        return;
+                    }
 
-                int index = 0;
-                for (const auto &item : profile.votes) {
-                    if(index++ >= params.limit)
-                        break;
-                    std::strftime(buffer, 32, ccapi::TIME_FORMAT, &item.date);
-                    fmt::print(" |{}| - {}\n", std::string(buffer), item.delivered ? "Delivered" : "Not delivered");
-                }
+                    ccapi::PlayerInfo profile{source.username, batch.get<ccapi::PlayerInfo>(source.next_vote).next_vote, 0, ccapi::VoteColumns()};
+                    for (auto request : source.requests) {
+                        const auto &month = batch.get<ccapi::PlayerInfo>(request);
+                        profile.votes.append(month.votes);
+                        profile.vote_count += month.vote_count;
+                    }
+                    if (params.days > 0) {
+                        profile.votes = votesSince(profile.votes, since);
+                        profile.vote_count = static_cast<int>(profile.votes.size());
+                    }
+                    renderPlayerVotes(out, source.slug, source.username, profile,
+                                      resolveLimit(params.limit, 10, profile.votes.size()));
+                });
             }
             return 0;
         }
 
         if(action == "top" || action == "topvoters"){
             if(params.slug == "N/S" || params.help)
-                fmt::print("Required parameters: slug\n"
-                           "Optional parameters: limit\n");
-            else {
-                auto topvoters = ccapi::topVoters(params.slug);
-                fmt::print("Total vote count: {}\n", topvoters.size());
+                fmt::print(output, "Required parameters: slug\n"
+                                   "Optional parameters: limit, year, month, from, to, days, parallel, merged\n");
+            else if(params.merged) { // one leaderboard of all the servers, from their whole leaderboards
+                ccapi::VoteArchive archive;
+                std::vector<ServerVotes> sources;
+                ccapi::VoterIndex index;
+                if (params.from) {
+                    for (const auto &slug : slugs)
+                        sources.push_back(queueServerVotes(batch, archive, slug, params.from, params.to));
+                    batch.run(params.parallel);
+                } else {
+                    // fetched before rendering, so traces count the transfers as such
+                    ccapi::indexTopVoters(index, slugs, params.parallel);
+                }
 
-                if (params.limit == -1)
-                    params.limit = 100;
+                return report({params.slug}, [&](std::size_t) {
+                    for (std::size_t server = 0; server < sources.size(); ++server) {
+                        auto votes = collectServerVotes(batch, sources[server]);
+                        auto counter = ccapi::countVotes(votes.votes.view(), since);
+                        index.add(slugs[server], ccapi::topVoters(counter, votes.votes.table(), counter.size()));
+                    }
+                    auto count = resolveLimit(params.limit, 100, index.totals().size());
+                    renderTopVoters(out, params.slug, index.top(count), index.totals().size(), count);
+                });
+            } else if(!params.from) { // leaderboard computed by the server
+                // an explicit limit fetches just the rows printed, only text and JSON print the size of the
+                // leaderboard, which counts the rest of it without keeping it
+                const bool total = out.format() == Format::text || out.format() == Format::json;
+                const bool counted = params.limit > 0 && total;
+                for (const auto &slug : slugs) {
+                    if (counted)
+                        batch.countedTopVoters(slug, params.limit);
+                    else
+                        params.limit > 0 ? batch.topVoters(slug, params.limit) : batch.topVoters(slug);
+                }
+                batch.run(params.parallel);
 
-                if(params.limit > topvoters.size() || params.limit == -2)
-                    params.limit = topvoters.size();
+                return report(slugs, [&](std::size_t index) {
+                    if (counted) {
+                        const auto &leaderboard = batch.get<ccapi::VoterList>(index);
+                        renderTopVoters(out, slugs[index], leaderboard.voters, leaderboard.voter_count,
+                                        resolveLimit(params.limit, 100, leaderboard.voters.size()));
+                        return;
+                    }
+                    const auto &voters = batch.get<std::list<ccapi::VoterInfo>>(index);
+                    renderTopVoters(out, slugs[index], voters, voters.size(),
+                                    resolveLimit(params.limit, 100, voters.size()));
+                });
+            } else { // leaderboard of a range, counted locally
+                ccapi::VoteArchive archive;
+                std::vector<ServerVotes> sources;
+                for (const auto &slug : slugs)
+                    sources.push_back(queueServerVotes(batch, archive, slug, params.from, params.to));
+                batch.run(params.parallel);
 
-                int index = 0;
-                for (const auto &item : topvoters) {
-                    if(++index > params.limit)
-                        break;
-                    fmt::print(" {}. {}, votes: {}\n", index, item.username, item.vote_count); //note index fucked prob
-                }
+                return report(slugs, [&](std::size_t index) {
+                    auto votes = collectServerVotes(batch, sources[index]);
+                    auto counter = [&] {
+                        ccapi::TraceScope scope(tracer, slugs[index], "count");
+                        return ccapi::countVotes(votes.votes.view(), since);
+                    }();
+                    auto count = resolveLimit(params.limit, 100, counter.size());
+                    renderTopVoters(out, slugs[index], ccapi::topVoters(counter, votes.votes.table(), count),
+                                    counter.size(), count);
+                });
             }
             return 0;
         }
 
         if(action == "nextvote" || action == "next") {
             if(params.slug == "N/S" || params.username == "N/S" || params.help)
-                fmt::print("Required parameters: slug, username\n");
+                fmt::print(output, "Required parameters: slug, username\n"
+                                   "Optional parameters: parallel, indexed\n");
+            else if (params.indexed) { // estimated from the last vote, one listing per server
+                // a vote within the interval may fall into the previous month
+                ccapi::VoteArchive archive;
+                ServerPlayers servers;
+                std::vector<std::string> titles;
+                const auto month = currentMonth();
+                for (const auto &slug : slugs) {
+                    servers.sources.push_back(queueServerVotes(batch, archive, slug, month.previous(), month));
+                    for (const auto &username : usernames)
+                        titles.emplace_back(fmt::format("{}/{}", slug, username));
+                }
+                batch.run(params.parallel);
+
+                const auto now = ccapi::apiNow(); // vote dates are in the frame of the API
+                return report(titles, [&](std::size_t index) {
+                    const auto server = index / usernames.size();
+                    const auto &username = usernames[index % usernames.size()];
+                    renderNextVote(out, slugs[server], username,
+                                   servers.index(batch, server, tracer, slugs[server]).player(username, now));
+                });
+            } else {
+                std::vector<std::string> titles;
+                std::vector<std::pair<std::string, std::string>> players;
+                for (const auto &slug : slugs) {
+                    for (const auto &username : usernames) {
+                        batch.nextVote(username, slug);
+                        titles.emplace_back(fmt::format("{}/{}", slug, username));
+                        players.emplace_back(slug, username);
+                    }
+                }
+                batch.run(params.parallel);
+
+                return report(titles, [&](std::size_t index) {
+                    const auto &[slug, username] = players[index];
+                    renderNextVote(out, slug, username, batch.get<ccapi::PlayerInfo>(index));
+                });
+            }
+            return 0;
+        }
+        if(action == "player") {
+            if(params.username == "N/S" || (params.slug == "N/S" && !params.all_slugs) || params.help)
+                fmt::print(output, "Required parameters: username, slug or all-slugs\n"
+                                   "Optional parameters: parallel\n");
             else {
-                auto info = ccapi::nextVote(params.username, params.slug);
-                char buffer[32] = {0};
-                std::strftime(buffer, 32, ccapi::TIME_FORMAT, &info.next_vote);
-                fmt::print("Next vote: {}\n", std::string(buffer));
+                if (params.all_slugs) {
+                    if (params.slug == "N/S")
+                        slugs.clear();
+                    for (auto &slug : ccapi::VoteArchive().slugs()) {
+                        if (std::find(slugs.begin(), slugs.end(), slug) == slugs.end())
+                            slugs.push_back(std::move(slug));
+                    }
+                }
+                if (slugs.empty()) {
+                    fmt::print(output, "No servers to search, give them with slug or archive them with sync\n");
+                    return 0;
+                }
+
+                // every player is looked up in the same leaderboards, fetched once per server
+                ccapi::VoterIndex voters;
+                ccapi::indexTopVoters(voters, slugs, params.parallel);
+                return report(usernames, [&](std::size_t player) {
+                    renderPlayerStandings(out, usernames[player], voters);
+                });
+            }
+            return 0;
+        }
+        if(action == "stats") {
+            if(params.slug == "N/S" || params.help)
+                fmt::print(output, "Required parameters: slug\n"
+                                   "Optional parameters: limit, year, month, from, to, days, parallel\n");
+            else {
+                ccapi::VoteArchive archive;
+                std::vector<ServerVotes> sources;
+                for (const auto &slug : slugs)
+                    sources.push_back(queueServerVotes(batch, archive, slug, params.from, params.to));
+                batch.run(params.parallel);
+
+                return report(slugs, [&](std::size_t index) {
+                    auto votes = collectServerVotes(batch, sources[index]);
+                    auto [histogram, streaks] = [&] {
+                        ccapi::TraceScope scope(tracer, slugs[index], "count");
+                        return std::pair(ccapi::voteHistogram(votes.votes.view(), since),
+                                         ccapi::voteStreaks(votes.votes.view(), since));
+                    }();
+                    renderVoteStats(out, slugs[index], histogram, streaks, votes.votes.table(),
+                                    resolveLimit(params.limit, 10, streaks.size()));
+                });
+            }
+            return 0;
+        }
+        if(action == "sync") {
+            if(params.slug == "N/S" || params.help)
+                fmt::print(output, "Required parameters: slug\n"
+                                   "Optional parameters: parallel\n");
+            else {
+                ccapi::VoteArchive archive;
+                return report(slugs, [&](std::size_t index) {
+                    renderSyncReport(out, slugs[index], archive.sync(slugs[index], params.parallel));
+                });
+            }
+            return 0;
+        }
+        if(action == "export") {
+            if(params.slug == "N/S" || params.help)
+                fmt::print(output, "Required parameters: slug\n"
+                                   "Optional parameters: format, output, year, month, from, to, days, parallel\n");
+            else if(!params.file.empty() && slugs.size() > 1)
+                fmt::print(output, "Output requires a single slug\n");
+            else {
+                ccapi::VoteArchive archive;
+                std::vector<ServerVotes> sources;
+                for (const auto &slug : slugs)
+                    sources.push_back(queueServerVotes(batch, archive, slug, params.from, params.to));
+                batch.run(params.parallel);
+
+                return report(slugs, [&](std::size_t index) {
+                    auto votes = collectServerVotes(batch, sources[index]);
+                    if (!params.snapshot) {
+                        renderServerVotes(out, slugs[index], votes, votes.votes.size());
+                        return;
+                    }
+                    auto path = params.file.empty() ? slugs[index] + ".ccbin" : params.file;
+                    {
+                        ccapi::TraceScope scope(tracer, slugs[index], "snapshot");
+                        ccapi::VoteSnapshot::write(path, votes.votes, votes.vote_count);
+                    }
+                    fmt::format_to(out.inserter(), "Exported {} votes to {}\n", votes.votes.size(), path);
+                });
+            }
+            return 0;
+        }
+        if(action == "watch") {
+            if(params.slug == "N/S" || params.help)
+                fmt::print(output, "Required parameters: slug\n"
+                                   "Optional parameters: username, limit, interval, parallel\n");
+            else if(out.format() == Format::json)
+                fmt::print(output, "Watch prints changes as they come, use format ndjson instead of json\n");
+            else {
+                // every poll revalidates its cached response, unchanged ones cost a 304 without a body
+                if (params.cache) {
+                    for (auto endpoint : {ccapi::Endpoint::server_info, ccapi::Endpoint::top_voters, ccapi::Endpoint::next_vote})
+                        sharedCache()->setTtl(endpoint, std::chrono::seconds(0));
+                }
+                return watchChanges(out, output, errors, slugs, params.username == "N/S" ? std::vector<std::string>() : usernames,
+                                    rowLimit(params.limit, 100), params.interval, params.parallel);
             }
             return 0;
         }
-        fmt::print("Unknown command\n");
+        fmt::print(output, "Unknown command\n");
 
     } catch (std::exception &ex) {
-        fmt::print("Failed to process request. Cause: {}\n", ex.what());
+        out.flush();
+        fmt::print(output, "Failed to process request. Cause: {}\n", ex.what());
         return 1;
     }
     return 0;
 }
+
+int main(int argc, char **argv) {
+    std::string action { argc > 1 ? argv[1] : "" };
+    std::filesystem::path socket = defaultSocketPath();
+    bool local = false;
+    for (int index = 2; index < argc; ++index) {
+        std::string arg {argv[index]};
+        if (arg == "--socket" && index + 1 < argc)
+            socket = argv[++index];
+        else if (arg == "--local")
+            local = true;
+    }
+
+    // a daemon answers only clients which would fetch from the same API into the same caches
+    std::string environment;
+    try {
+        environment = fmt::format("{}\n{}\n{}", ccapi::defaultClient().baseUrl(),
+                                  ccapi::ResponseCache::defaultDirectory().string(),
+                                  ccapi::VoteArchive::defaultDirectory().string());
+    } catch (std::exception &ex) {
+        fmt::print("Failed to process request. Cause: {}\n", ex.what());
+        return 1;
+    }
+    if (action == "serve") {
+        sharedCache()->setMemoryEntries(4096);
+        try {
+            return serveCommands(socket, environment, run);
+        } catch (std::exception &ex) {
+            fmt::print("Failed to serve commands. Cause: {}\n", ex.what());
+            return 1;
+        }
+    }
+
+    // commands answered from the network go to a running daemon, which has warm connections and caches
+    const bool forwarded = action == "info" || action == "votes" || action == "top" || action == "topvoters"
+                           || action == "next" || action == "nextvote" || action == "stats" || action == "player";
+    if (forwarded && !local) {
+        if (auto status = forwardCommand(socket, environment, argc, argv))
+            return *status;
+    }
+    return run(argc, argv, stdout, stderr);
+}
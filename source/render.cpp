@@ -0,0 +1,661 @@
+#include "render.hpp"
+#include "timefmt.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+
+// written out once this much is buffered, large enough for the writes to cost nothing next to formatting
+static constexpr std::size_t FLUSH_SIZE = 1 << 18;
+
+static constexpr std::array<std::string_view, 7> WEEKDAYS = {"Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+std::optional<Format>
+parseFormat(std::string_view name) {
+    if (name == "text")
+        return Format::text;
+    if (name == "json")
+        return Format::json;
+    if (name == "ndjson")
+        return Format::ndjson;
+    if (name == "csv")
+        return Format::csv;
+    if (name == "tsv")
+        return Format::tsv;
+    return std::nullopt;
+}
+
+Output::~Output() {
+    if (output_format == Format::json && results > 0)
+        append("]\n");
+    flush();
+}
+
+std::back_insert_iterator<fmt::memory_buffer>
+Output::inserter() {
+    next_row();
+    return std::back_inserter(buffer);
+}
+
+void
+Output::string(std::string_view value) {
+    static constexpr char HEX[] = "0123456789abcdef";
+    buffer.push_back('"');
+    const char *safe = value.data(), *end = value.data() + value.size();
+    for (auto it = safe; it != end; ++it) {
+        auto c = static_cast<unsigned char>(*it);
+        if (c >= 0x20 && c != '"' && c != '\\')
+            continue;
+        buffer.append(safe, it);
+        safe = it + 1;
+        if (c == '"' || c == '\\') {
+            buffer.push_back('\\');
+            buffer.push_back(static_cast<char>(c));
+        } else {
+            const char escaped[] = {'\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15]};
+            buffer.append(escaped, escaped + sizeof(escaped));
+        }
+    }
+    buffer.append(safe, end);
+    buffer.push_back('"');
+}
+
+void
+Output::field(std::string_view value, bool last) {
+    if (output_format == Format::csv) {
+        if (value.find_first_of(",\"\r\n") == std::string_view::npos) {
+            append(value);
+        } else {
+            buffer.push_back('"');
+            for (auto c : value) {
+                if (c == '"')
+                    buffer.push_back('"');
+                buffer.push_back(c);
+            }
+            buffer.push_back('"');
+        }
+        buffer.push_back(last ? '\n' : ',');
+        return;
+    }
+
+    // there is no quoting in TSV, separators inside of a field are replaced
+    for (auto c : value)
+        buffer.push_back(c == '\t' || c == '\r' || c == '\n' ? ' ' : c);
+    buffer.push_back(last ? '\n' : '\t');
+}
+
+void
+Output::next_row() {
+    if (buffer.size() >= FLUSH_SIZE)
+        flush();
+}
+
+void
+Output::begin(std::string_view title, std::size_t count) {
+    mark = Mark{buffer.size(), results, header_written};
+    if (output_format == Format::text && count > 1)
+        fmt::format_to(inserter(), "{}[{}]\n", results ? "\n" : "", title);
+    else if (output_format == Format::json)
+        append(results ? ",\n" : "[");
+    ++results;
+}
+
+void
+Output::discard() {
+    if (!mark)
+        return;
+    buffer.resize(mark->size);
+    results = mark->results;
+    header_written = mark->header_written;
+    mark.reset();
+}
+
+void
+Output::header(std::string_view columns) {
+    if (header_written || (output_format != Format::csv && output_format != Format::tsv))
+        return;
+    header_written = true;
+    for (auto c : columns)
+        buffer.push_back(c == ',' && output_format == Format::tsv ? '\t' : c);
+    buffer.push_back('\n');
+}
+
+void
+Output::flush() {
+    if (buffer.size())
+        std::fwrite(buffer.data(), 1, buffer.size(), file);
+    buffer.clear();
+    mark.reset();
+}
+
+static std::string_view delivered_text(bool delivered) {
+    return delivered ? "Delivered" : "Not delivered";
+}
+
+static std::string_view boolean(bool value) {
+    return value ? "true" : "false";
+}
+
+// closes a JSON result, which takes a line of its own in NDJSON
+static void end_object(Output &out) {
+    out.append('}');
+    if (out.format() == Format::ndjson)
+        out.append('\n');
+}
+
+void
+renderServerInfo(Output &out, const std::string &slug, const ccapi::ServerInfo &info) {
+    switch (out.format()) {
+        case Format::text:
+            fmt::format_to(out.inserter(), "Name: {}\nAddress: {}\nPosition: {}\nVotes: {}\n", info.name, info.address,
+                           info.position, info.votes);
+            break;
+        case Format::json:
+        case Format::ndjson:
+            out.append("{\"slug\":");
+            out.string(slug);
+            out.append(",\"name\":");
+            out.string(info.name);
+            out.append(",\"address\":");
+            out.string(info.address);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"position\":{},\"votes\":{}"), info.position, info.votes);
+            end_object(out);
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("slug,name,address,position,votes");
+            out.field(slug);
+            out.field(info.name);
+            out.field(info.address);
+            out.field(info.position); // -1 when unknown, as in text and JSON
+            out.field(info.votes, true);
+            break;
+    }
+}
+
+void
+renderServerVotes(Output &out, const std::string &slug, const ccapi::VoteVector &votes, std::size_t count) {
+    char time[ccapi::TIME_LENGTH];
+    const auto rows = votes.votes.view().first(count);
+    switch (out.format()) {
+        case Format::text:
+            fmt::format_to(out.inserter(), FMT_COMPILE("Total vote count: {}\n"), votes.vote_count);
+            for (const auto item : rows) {
+                fmt::format_to(out.inserter(), FMT_COMPILE(" |{}| {} - {}\n"), ccapi::formatTime(item.date, time),
+                               item.username, delivered_text(item.delivered));
+            }
+            break;
+        case Format::json:
+            out.append("{\"slug\":");
+            out.string(slug);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"vote_count\":{},\"votes\":["), votes.vote_count);
+            for (std::size_t index = 0; index < rows.size(); ++index) {
+                const auto item = rows[index];
+                fmt::format_to(out.inserter(), FMT_COMPILE("{}{{\"date\":\"{}\",\"username\":"), index ? "," : "",
+                               ccapi::formatTime(item.date, time));
+                out.string(item.username);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"delivered\":{}}}"), boolean(item.delivered));
+            }
+            out.append("]}");
+            break;
+        case Format::ndjson:
+            for (const auto item : rows) {
+                out.next_row();
+                out.append("{\"slug\":");
+                out.string(slug);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"date\":\"{}\",\"username\":"), ccapi::formatTime(item.date, time));
+                out.string(item.username);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"delivered\":{}}}\n"), boolean(item.delivered));
+            }
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("slug,date,username,delivered");
+            for (const auto item : rows) {
+                out.next_row();
+                out.field(slug);
+                out.field(ccapi::formatTime(item.date, time));
+                out.field(item.username);
+                out.field(boolean(item.delivered), true);
+            }
+            break;
+    }
+}
+
+void
+renderPlayerVotes(Output &out, const std::string &slug, const std::string &username, const ccapi::PlayerInfo &profile,
+                  std::size_t count) {
+    char time[ccapi::TIME_LENGTH];
+    const auto rows = profile.votes.view().first(count);
+    switch (out.format()) {
+        case Format::text:
+            if (profile.votes.empty()) {
+                fmt::format_to(out.inserter(), "No votes found for player {}\n", username);
+                break;
+            }
+            fmt::format_to(out.inserter(), "Vote count: {}\nNext vote: {}\nVotes:\n", profile.vote_count,
+                           ccapi::formatTime(profile.next_vote, time));
+            for (const auto item : rows) {
+                fmt::format_to(out.inserter(), FMT_COMPILE(" |{}| - {}\n"), ccapi::formatTime(item.date, time),
+                               delivered_text(item.delivered));
+            }
+            break;
+        case Format::json:
+            out.append("{\"slug\":");
+            out.string(slug);
+            out.append(",\"username\":");
+            out.string(username);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"vote_count\":{},\"next_vote\":\"{}\",\"votes\":["),
+                           profile.vote_count, ccapi::formatTime(profile.next_vote, time));
+            for (std::size_t index = 0; index < rows.size(); ++index) {
+                const auto item = rows[index];
+                fmt::format_to(out.inserter(), FMT_COMPILE("{}{{\"date\":\"{}\",\"delivered\":{}}}"), index ? "," : "",
+                               ccapi::formatTime(item.date, time), boolean(item.delivered));
+            }
+            out.append("]}");
+            break;
+        case Format::ndjson:
+            for (const auto item : rows) {
+                out.next_row();
+                out.append("{\"slug\":");
+                out.string(slug);
+                out.append(",\"username\":");
+                out.string(username);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"date\":\"{}\",\"delivered\":{}}}\n"),
+                               ccapi::formatTime(item.date, time), boolean(item.delivered));
+            }
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("slug,username,date,delivered");
+            for (const auto item : rows) {
+                out.next_row();
+                out.field(slug);
+                out.field(username);
+                out.field(ccapi::formatTime(item.date, time));
+                out.field(boolean(item.delivered), true);
+            }
+            break;
+    }
+}
+
+void
+renderTopVoters(Output &out, const std::string &slug, const std::list<ccapi::VoterInfo> &voters,
+                std::optional<std::size_t> total, std::size_t count) {
+    std::size_t rank = 0;
+    switch (out.format()) {
+        case Format::text:
+            if (total)
+                fmt::format_to(out.inserter(), FMT_COMPILE("Total vote count: {}\n"), *total);
+            for (const auto &item : voters) {
+                if (++rank > count)
+                    break;
+                fmt::format_to(out.inserter(), FMT_COMPILE(" {}. {}, votes: {}\n"), rank, item.username, item.vote_count);
+            }
+            break;
+        case Format::json:
+            out.append("{\"slug\":");
+            out.string(slug);
+            if (total)
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"total\":{}"), *total);
+            out.append(",\"voters\":[");
+            for (const auto &item : voters) {
+                if (++rank > count)
+                    break;
+                fmt::format_to(out.inserter(), FMT_COMPILE("{}{{\"rank\":{},\"username\":"), rank > 1 ? "," : "", rank);
+                out.string(item.username);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"votes\":{}}}"), item.vote_count);
+            }
+            out.append("]}");
+            break;
+        case Format::ndjson:
+            for (const auto &item : voters) {
+                if (++rank > count)
+                    break;
+                out.next_row();
+                out.append("{\"slug\":");
+                out.string(slug);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"rank\":{},\"username\":"), rank);
+                out.string(item.username);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"votes\":{}}}\n"), item.vote_count);
+            }
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("slug,rank,username,votes");
+            for (const auto &item : voters) {
+                if (++rank > count)
+                    break;
+                out.next_row();
+                out.field(slug);
+                out.field(rank);
+                out.field(item.username);
+                out.field(item.vote_count, true);
+            }
+            break;
+    }
+}
+
+void
+renderPlayerStandings(Output &out, const std::string &username, const ccapi::VoterIndex &index) {
+    const auto standings = index.find(username);
+    const auto &servers = index.servers();
+    std::uint64_t total = 0;
+    for (const auto &standing : standings)
+        total += static_cast<std::uint64_t>(standing.votes);
+
+    switch (out.format()) {
+        case Format::text:
+            if (standings.empty()) {
+                fmt::format_to(out.inserter(), "Player {} is not ranked on any of {} servers\n", username, servers.size());
+                break;
+            }
+            fmt::format_to(out.inserter(), "Total vote count: {}\nRanked on {} of {} servers:\n", total, standings.size(),
+                           servers.size());
+            for (const auto &standing : standings) {
+                fmt::format_to(out.inserter(), FMT_COMPILE(" {}: #{}, votes: {}\n"), servers[standing.server],
+                               standing.rank, standing.votes);
+            }
+            break;
+        case Format::json:
+            out.append("{\"username\":");
+            out.string(username);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"total\":{},\"servers\":["), total);
+            for (std::size_t row = 0; row < standings.size(); ++row) {
+                out.append(row ? ",{\"slug\":" : "{\"slug\":");
+                out.string(servers[standings[row].server]);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"rank\":{},\"votes\":{}}}"), standings[row].rank,
+                               standings[row].votes);
+            }
+            out.append("]}");
+            break;
+        case Format::ndjson:
+            for (const auto &standing : standings) {
+                out.next_row();
+                out.append("{\"username\":");
+                out.string(username);
+                out.append(",\"slug\":");
+                out.string(servers[standing.server]);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"rank\":{},\"votes\":{}}}\n"), standing.rank, standing.votes);
+            }
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("username,slug,rank,votes");
+            for (const auto &standing : standings) {
+                out.next_row();
+                out.field(username);
+                out.field(servers[standing.server]);
+                out.field(standing.rank);
+                out.field(standing.votes, true);
+            }
+            break;
+    }
+}
+
+void
+renderNextVote(Output &out, const std::string &slug, const std::string &username, const ccapi::PlayerInfo &info) {
+    char time[ccapi::TIME_LENGTH];
+    switch (out.format()) {
+        case Format::text:
+            fmt::format_to(out.inserter(), FMT_COMPILE("Next vote: {}\n"), ccapi::formatTime(info.next_vote, time));
+            break;
+        case Format::json:
+        case Format::ndjson:
+            out.append("{\"slug\":");
+            out.string(slug);
+            out.append(",\"username\":");
+            out.string(username);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"next_vote\":\"{}\""), ccapi::formatTime(info.next_vote, time));
+            end_object(out);
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("slug,username,next_vote");
+            out.field(slug);
+            out.field(username);
+            out.field(ccapi::formatTime(info.next_vote, time), true);
+            break;
+    }
+}
+
+static void text_histogram(Output &out, std::string_view title, std::size_t size, const std::uint64_t *counts,
+                           const std::function<void(std::size_t)> &label) {
+    constexpr std::size_t WIDTH = 40;
+    auto peak = *std::max_element(counts, counts + size);
+    fmt::format_to(out.inserter(), "{}:\n", title);
+    for (std::size_t index = 0; index < size; ++index) {
+        auto bar = peak ? static_cast<std::size_t>(counts[index] * WIDTH / peak) : 0;
+        out.append(' ');
+        label(index);
+        out.append(' ');
+        out.append(std::string_view("########################################").substr(0, bar));
+        fmt::format_to(out.inserter(), "{:{}} {}\n", "", WIDTH - bar, counts[index]);
+    }
+}
+
+template<std::size_t Size>
+static void json_array(Output &out, std::string_view name, const std::array<std::uint64_t, Size> &counts) {
+    fmt::format_to(out.inserter(), FMT_COMPILE(",\"{}\":["), name);
+    for (std::size_t index = 0; index < Size; ++index)
+        fmt::format_to(out.inserter(), FMT_COMPILE("{}{}"), index ? "," : "", counts[index]);
+    out.append(']');
+}
+
+void
+renderVoteStats(Output &out, const std::string &slug, const ccapi::VoteHistogram &histogram,
+                const std::vector<ccapi::VoteStreak> &streaks, const ccapi::StringTable &table, std::size_t count) {
+    char first[ccapi::TIME_LENGTH], last[ccapi::TIME_LENGTH];
+    const auto not_delivered = histogram.total - histogram.delivered;
+    count = std::min(count, streaks.size());
+
+    switch (out.format()) {
+        case Format::text: {
+            fmt::format_to(out.inserter(), "Total vote count: {}\n", histogram.total);
+            if (!histogram.total)
+                break;
+            fmt::format_to(out.inserter(), "First vote: {}\nLast vote: {}\n"
+                                           "Delivered: {} ({:.1f} %)\nNot delivered: {} ({:.1f} %)\n",
+                           ccapi::formatTime(histogram.first, first), ccapi::formatTime(histogram.last, last),
+                           histogram.delivered, 100.0 * histogram.delivered / histogram.total,
+                           not_delivered, 100.0 * not_delivered / histogram.total);
+
+            text_histogram(out, "By hour", histogram.hours.size(), histogram.hours.data(), [&](std::size_t hour) {
+                fmt::format_to(out.inserter(), " {:02}", hour);
+            });
+            text_histogram(out, "By weekday", histogram.weekdays.size(), histogram.weekdays.data(), [&](std::size_t day) {
+                out.append(WEEKDAYS[day]);
+            });
+            text_histogram(out, "By day of month", histogram.days.size(), histogram.days.data(), [&](std::size_t day) {
+                fmt::format_to(out.inserter(), "{:>3}", day + 1);
+            });
+
+            out.append("Longest streaks:\n");
+            for (std::size_t index = 0; index < count; ++index) {
+                const auto &streak = streaks[index];
+                fmt::format_to(out.inserter(), " {}. {}, {} days until {}, voted on {} days, current streak: {}\n",
+                               index + 1, table[streak.user], streak.longest,
+                               ccapi::formatTime(streak.longest_end, first).substr(0, 10), streak.days, streak.current);
+            }
+            break;
+        }
+        case Format::json:
+        case Format::ndjson:
+            out.append("{\"slug\":");
+            out.string(slug);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"total\":{},\"delivered\":{}"), histogram.total, histogram.delivered);
+            if (histogram.total) {
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"first\":\"{}\",\"last\":\"{}\""),
+                               ccapi::formatTime(histogram.first, first), ccapi::formatTime(histogram.last, last));
+            }
+            json_array(out, "hours", histogram.hours);
+            json_array(out, "weekdays", histogram.weekdays);
+            json_array(out, "days", histogram.days);
+            out.append(",\"streaks\":[");
+            for (std::size_t index = 0; index < count; ++index) {
+                const auto &streak = streaks[index];
+                out.append(index ? ",{\"username\":" : "{\"username\":");
+                out.string(table[streak.user]);
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"longest\":{},\"longest_end\":\"{}\",\"days\":{},\"current\":{}}}"),
+                               streak.longest, ccapi::formatTime(streak.longest_end, first).substr(0, 10), streak.days,
+                               streak.current);
+            }
+            out.append(']');
+            end_object(out);
+            break;
+        case Format::csv:
+        case Format::tsv: {
+            // long format, one value per row, so that histograms and streaks share the columns
+            out.header("slug,metric,key,value");
+            auto row = [&](std::string_view metric, std::string_view key, auto value) {
+                out.field(slug);
+                out.field(metric);
+                out.field(key);
+                out.field(value, true);
+            };
+            row("total", "", histogram.total);
+            row("delivered", "", histogram.delivered);
+            row("not_delivered", "", not_delivered);
+            if (histogram.total) {
+                row("first", "", ccapi::formatTime(histogram.first, first));
+                row("last", "", ccapi::formatTime(histogram.last, last));
+            }
+            char key[4];
+            for (std::size_t hour = 0; hour < histogram.hours.size(); ++hour) {
+                auto end = fmt::format_to(key, FMT_COMPILE("{:02}"), hour);
+                row("hour", std::string_view(key, end - key), histogram.hours[hour]);
+            }
+            for (std::size_t day = 0; day < histogram.weekdays.size(); ++day)
+                row("weekday", WEEKDAYS[day], histogram.weekdays[day]);
+            for (std::size_t day = 0; day < histogram.days.size(); ++day) {
+                auto end = fmt::format_to(key, FMT_COMPILE("{}"), day + 1);
+                row("day", std::string_view(key, end - key), histogram.days[day]);
+            }
+            for (std::size_t index = 0; index < count; ++index) {
+                const auto &streak = streaks[index];
+                const auto username = table[streak.user];
+                out.next_row();
+                row("streak_longest", username, std::uint64_t{streak.longest});
+                row("streak_end", username, ccapi::formatTime(streak.longest_end, first).substr(0, 10));
+                row("streak_days", username, std::uint64_t{streak.days});
+                row("streak_current", username, std::uint64_t{streak.current});
+            }
+            break;
+        }
+    }
+}
+
+void
+renderSyncReport(Output &out, const std::string &slug, const ccapi::VoteArchive::SyncReport &report) {
+    switch (out.format()) {
+        case Format::text:
+            fmt::format_to(out.inserter(), "Requests: {}\nArchived months: {}\nArchived votes: {}\n", report.requests,
+                           report.archived_months, report.archived_votes);
+            break;
+        case Format::json:
+        case Format::ndjson:
+            out.append("{\"slug\":");
+            out.string(slug);
+            fmt::format_to(out.inserter(), FMT_COMPILE(",\"requests\":{},\"archived_months\":{},\"archived_votes\":{}"),
+                           report.requests, report.archived_months, report.archived_votes);
+            end_object(out);
+            break;
+        case Format::csv:
+        case Format::tsv:
+            out.header("slug,requests,archived_months,archived_votes");
+            out.field(slug);
+            out.field(report.requests);
+            out.field(report.archived_months);
+            out.field(report.archived_votes, true);
+            break;
+    }
+}
+
+static std::string_view watch_kind(WatchEvent::Kind kind) {
+    switch (kind) {
+        case WatchEvent::Kind::entered: return "entered";
+        case WatchEvent::Kind::left: return "left";
+        case WatchEvent::Kind::moved: return "moved";
+        case WatchEvent::Kind::position: return "position";
+        case WatchEvent::Kind::votes: return "votes";
+        case WatchEvent::Kind::available: return "available";
+        case WatchEvent::Kind::voted: return "voted";
+    }
+    return "";
+}
+
+void
+renderWatchEvent(Output &out, const WatchEvent &event) {
+    using Kind = WatchEvent::Kind;
+    char time[ccapi::TIME_LENGTH], next[ccapi::TIME_LENGTH];
+    out.next_row();
+    switch (out.format()) {
+        case Format::text:
+            fmt::format_to(out.inserter(), "[{}] {}", ccapi::formatTime(event.time, time), event.slug);
+            switch (event.kind) {
+                case Kind::entered:
+                    fmt::format_to(out.inserter(), ": {} entered the leaderboard at #{}\n", event.username, event.to);
+                    break;
+                case Kind::left:
+                    fmt::format_to(out.inserter(), ": {} left the leaderboard, was #{}\n", event.username, event.from);
+                    break;
+                case Kind::moved:
+                    fmt::format_to(out.inserter(), ": {} moved #{} -> #{}\n", event.username, event.from, event.to);
+                    break;
+                case Kind::position:
+                    fmt::format_to(out.inserter(), ": position {} -> {}\n", event.from, event.to);
+                    break;
+                case Kind::votes:
+                    fmt::format_to(out.inserter(), ": votes {} -> {}\n", event.from, event.to);
+                    break;
+                case Kind::available:
+                    fmt::format_to(out.inserter(), "/{}: can vote now\n", event.username);
+                    break;
+                case Kind::voted:
+                    fmt::format_to(out.inserter(), "/{}: voted, next vote at {}\n", event.username,
+                                   ccapi::formatTime(event.to, next));
+                    break;
+            }
+            break;
+        case Format::json:
+        case Format::ndjson:
+            fmt::format_to(out.inserter(), FMT_COMPILE("{{\"time\":\"{}\",\"event\":\"{}\",\"slug\":"),
+                           ccapi::formatTime(event.time, time), watch_kind(event.kind));
+            out.string(event.slug);
+            if (!event.username.empty()) {
+                out.append(",\"username\":");
+                out.string(event.username);
+            }
+            if (event.kind == Kind::voted)
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"next_vote\":\"{}\""), ccapi::formatTime(event.to, next));
+            else if (event.kind != Kind::available)
+                fmt::format_to(out.inserter(), FMT_COMPILE(",\"from\":{},\"to\":{}"), event.from, event.to);
+            end_object(out);
+            break;
+        case Format::csv:
+        case Format::tsv: {
+            // the next vote date of a player who voted goes into the to column
+            out.header("time,event,slug,username,from,to");
+            out.field(ccapi::formatTime(event.time, time));
+            out.field(watch_kind(event.kind));
+            out.field(event.slug);
+            out.field(event.username);
+            char digits[24];
+            auto number = [&](std::int64_t value) {
+                auto end = fmt::format_to(digits, FMT_COMPILE("{}"), value);
+                return std::string_view(digits, static_cast<std::size_t>(end - digits));
+            };
+            if (event.kind == Kind::voted) {
+                out.field(std::string_view());
+                out.field(ccapi::formatTime(event.to, next), true);
+            } else if (event.kind == Kind::available) {
+                out.field(std::string_view());
+                out.field(std::string_view(), true);
+            } else {
+                out.field(number(event.from));
+                out.field(number(event.to), true);
+            }
+            break;
+        }
+    }
+}
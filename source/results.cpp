@@ -0,0 +1,115 @@
+#include "results.hpp"
+
+using namespace ccapi;
+
+ResultCache::ResultCache(std::size_t capacity) : shard_capacity((capacity + SHARDS - 1) / SHARDS) {}
+
+ResultCache::Value
+ResultCache::find_or_fetch(const std::string &key, Endpoint endpoint, const std::function<Value()> &fetch) {
+    auto &shard = this->shard(key);
+    std::promise<Value> promise;
+    std::uint64_t flight;
+    {
+        std::unique_lock guard(shard.lock);
+        if (auto found = shard.slots.find(key); found != shard.slots.end()) {
+            auto &slot = found->second;
+            if (slot.pending.valid()) {
+                auto pending = slot.pending;
+                guard.unlock();
+                ++coalesced;
+                return pending.get();
+            }
+            if (Clock::now() < slot.expires) {
+                shard.order.splice(shard.order.begin(), shard.order, slot.position);
+                ++hits;
+                return slot.value;
+            }
+            shard.order.erase(slot.position);
+            shard.slots.erase(found);
+        }
+
+        // later callers wait for this fetch until it is done
+        flight = ++flights;
+        auto &slot = shard.slots[key];
+        slot.pending = promise.get_future().share();
+        slot.flight = flight;
+    }
+
+    ++misses;
+    Value value;
+    try {
+        value = fetch();
+    } catch (...) {
+        promise.set_exception(std::current_exception());
+        std::lock_guard guard(shard.lock);
+        if (auto found = shard.slots.find(key); found != shard.slots.end() && found->second.flight == flight)
+            shard.slots.erase(found);
+        throw;
+    }
+    promise.set_value(value);
+    keep(shard, key, flight, value, endpoint);
+    return value;
+}
+
+void
+ResultCache::keep(Shard &shard, const std::string &key, std::uint64_t flight, Value value, Endpoint endpoint) {
+    const auto ttl = this->ttl(endpoint);
+    std::lock_guard guard(shard.lock);
+    auto found = shard.slots.find(key);
+    if (found == shard.slots.end() || found->second.flight != flight)
+        return; // cleared while being fetched
+    if (shard_capacity == 0 || ttl <= std::chrono::seconds::zero()) {
+        shard.slots.erase(found);
+        return;
+    }
+
+    auto &slot = found->second;
+    const auto now = Clock::now();
+    slot.pending = {};
+    slot.value = std::move(value);
+    slot.expires = ttl >= std::chrono::duration_cast<std::chrono::seconds>(Clock::time_point::max() - now)
+                   ? Clock::time_point::max() : now + ttl;
+    shard.order.push_front(&found->first); // keys of an unordered_map stay in place until erased
+    slot.position = shard.order.begin();
+
+    while (shard.order.size() > shard_capacity) {
+        auto evicted = shard.order.back();
+        shard.order.pop_back();
+        shard.slots.erase(*evicted);
+    }
+}
+
+ResultCache::Shard &
+ResultCache::shard(const std::string &key) const {
+    return shards[std::hash<std::string>{}(key) % SHARDS];
+}
+
+ResultCache::Stats
+ResultCache::stats() const {
+    Stats stats{hits, misses, coalesced, 0};
+    for (auto &shard : shards) {
+        std::lock_guard guard(shard.lock);
+        stats.entries += shard.order.size();
+    }
+    return stats;
+}
+
+std::chrono::seconds
+ResultCache::ttl(Endpoint endpoint) const {
+    return ttls[static_cast<std::size_t>(endpoint)];
+}
+
+void
+ResultCache::setTtl(Endpoint endpoint, std::chrono::seconds ttl) {
+    ttls[static_cast<std::size_t>(endpoint)] = ttl;
+}
+
+void
+ResultCache::clear() {
+    // callers waiting for a fetch hold its future, dropping the slot only keeps the result from being stored
+    for (auto &shard : shards) {
+        std::lock_guard guard(shard.lock);
+        shard.slots.clear();
+        shard.order.clear();
+    }
+}
@@ -0,0 +1,147 @@
+#include "scheduler.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace ccapi;
+using namespace std::chrono_literals;
+
+static constexpr auto BASE_DELAY = std::chrono::milliseconds(250);
+static constexpr auto MAX_DELAY = std::chrono::milliseconds(30000);
+
+// the time to the first byte signals queueing once it is this far above the lowest one, small jitter of a fast
+// server is not congestion
+static constexpr double LATENCY_TOLERANCE = 2.0;
+static constexpr auto LATENCY_SLACK = std::chrono::milliseconds(20);
+static constexpr std::size_t WARMUP_SAMPLES = 8;
+
+static bool transient(CURLcode code) {
+    switch (code) {
+        case CURLE_COULDNT_RESOLVE_HOST:
+        case CURLE_COULDNT_CONNECT:
+        case CURLE_OPERATION_TIMEDOUT:
+        case CURLE_SEND_ERROR:
+        case CURLE_RECV_ERROR:
+        case CURLE_GOT_NOTHING:
+        case CURLE_PARTIAL_FILE:
+        case CURLE_SSL_CONNECT_ERROR:
+        case CURLE_HTTP2:
+        case CURLE_HTTP2_STREAM:
+            return true;
+        default:
+            return false;
+    }
+}
+
+RequestScheduler::RequestScheduler(std::size_t max_in_flight, std::size_t initial, int attempts)
+: max_limit(static_cast<double>(std::max<std::size_t>(max_in_flight, 1))), attempts(std::max(attempts, 1)),
+  limit(std::clamp(static_cast<double>(initial), 1.0, max_limit)), random(std::random_device{}()) {}
+
+bool
+RequestScheduler::admits(clock_type::time_point now) const {
+    return now >= resume && static_cast<double>(in_flight) < std::floor(limit);
+}
+
+void
+RequestScheduler::acquire() {
+    std::unique_lock guard(lock);
+    for (;;) {
+        auto now = clock_type::now();
+        if (admits(now))
+            break;
+        if (now < resume)
+            changed.wait_until(guard, resume);
+        else
+            changed.wait(guard);
+    }
+    ++in_flight;
+}
+
+bool
+RequestScheduler::tryAcquire() {
+    std::lock_guard guard(lock);
+    if (!admits(clock_type::now()))
+        return false;
+    ++in_flight;
+    return true;
+}
+
+void
+RequestScheduler::release() {
+    {
+        std::lock_guard guard(lock);
+        --in_flight;
+    }
+    changed.notify_all();
+}
+
+RequestScheduler::Decision
+RequestScheduler::finished(CURL *handle, CURLcode code, int attempt, bool restartable) {
+    long status = 0;
+    curl_off_t first_byte = 0, retry_after = 0;
+    curl_easy_getinfo(handle, CURLINFO_RESPONSE_CODE, &status);
+    curl_easy_getinfo(handle, CURLINFO_STARTTRANSFER_TIME_T, &first_byte);
+    curl_easy_getinfo(handle, CURLINFO_RETRY_AFTER, &retry_after);
+
+    const auto now = clock_type::now();
+    const bool overloaded = status == 429 || status == 503;
+    std::unique_lock guard(lock);
+
+    if (code == CURLE_OK && status < 500 && status != 429) {
+        if (first_byte > 0) {
+            clock_type::duration latency = std::chrono::microseconds(first_byte);
+            baseline = samples == 0 ? latency : std::min(latency, baseline + (latency - baseline) / 64);
+            smoothed = samples == 0 ? latency : smoothed + (latency - smoothed) / 8;
+            if (++samples > WARMUP_SAMPLES
+                && latency > std::chrono::duration_cast<clock_type::duration>(baseline * LATENCY_TOLERANCE) + LATENCY_SLACK) {
+                decrease(now, 0.9);
+                return {};
+            }
+        }
+        limit = std::min(max_limit, limit + (slow_start ? 1.0 : 1.0 / limit));
+        guard.unlock();
+        changed.notify_all();
+        return {};
+    }
+
+    if (overloaded)
+        ++throttled;
+    if (overloaded || status >= 500 || code == CURLE_OPERATION_TIMEDOUT)
+        decrease(now, overloaded ? 0.5 : 0.75);
+    if (retry_after > 0)
+        resume = std::max(resume, now + std::chrono::seconds(retry_after));
+
+    if (!restartable || attempt >= attempts || (code != CURLE_OK && !transient(code)))
+        return {};
+
+    // full jitter spreads the attempts of requests which failed together
+    auto ceiling = std::min<clock_type::duration>(MAX_DELAY, BASE_DELAY * (1 << std::min(attempt - 1, 16)));
+    std::uniform_int_distribution<clock_type::rep> jitter(0, ceiling.count());
+    clock_type::duration delay(jitter(random));
+    if (retry_after > 0)
+        delay = std::max<clock_type::duration>(delay, std::chrono::seconds(retry_after));
+    ++retries;
+    return {true, delay};
+}
+
+void
+RequestScheduler::decrease(clock_type::time_point now, double factor) {
+    // responses of requests sent before the last cut tell nothing new about the limit
+    if (now - last_decrease < std::max<clock_type::duration>(smoothed, 100ms))
+        return;
+    limit = std::max(1.0, limit * factor);
+    slow_start = false;
+    last_decrease = now;
+}
+
+RequestScheduler::clock_type::time_point
+RequestScheduler::resumeAt() const {
+    std::lock_guard guard(lock);
+    return resume;
+}
+
+RequestScheduler::Stats
+RequestScheduler::stats() const {
+    std::lock_guard guard(lock);
+    return Stats{static_cast<std::size_t>(limit), in_flight, retries, throttled};
+}
@@ -0,0 +1,287 @@
+#include "snapshot.hpp"
+#include "timefmt.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fmt/format.h>
+
+using namespace ccapi;
+
+namespace {
+
+    // byte range of a column, from the start of the file
+    struct Section {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    /**
+     * Header at the start of a snapshot, followed by the sections it points to.
+     */
+    struct SnapshotHeader {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t header_size;
+        std::uint64_t vote_count;     // rows of every column
+        std::int64_t reported_count;  // vote count reported by the API
+        std::uint64_t user_count;
+        std::int64_t first_month;     // year * 12 + month - 1
+        std::uint64_t month_count;
+        Section dates;                // int64 epoch seconds, oldest first
+        Section users;                // uint32 ids into the dictionary
+        Section delivered;            // uint64 words, bit i % 64 of word i / 64
+        Section name_offsets;         // uint32, user_count + 1 of them
+        Section names;                // characters of the usernames, sorted
+        Section months;               // uint64 index of the first vote of every month, then vote_count
+    };
+
+    constexpr char MAGIC[8] = {'C', 'C', 'V', 'O', 'T', 'E', 'S', '\x1a'};
+    constexpr std::uint32_t NO_ID = std::numeric_limits<std::uint32_t>::max();
+
+    constexpr std::uint64_t aligned(std::uint64_t size) {
+        return (size + 7) / 8 * 8;
+    }
+
+    std::int64_t month_of(std::int64_t date) {
+        auto tm = fromEpoch(date);
+        return (tm.tm_year + 1900) * std::int64_t{12} + tm.tm_mon;
+    }
+
+    std::int64_t month_start(std::int64_t month) {
+        return daysFromCivil(month / 12, static_cast<unsigned>(month % 12 + 1), 1) * 86400;
+    }
+
+    void require_little_endian() {
+        if constexpr (std::endian::native != std::endian::little)
+            throw std::runtime_error("Vote snapshots are supported on little-endian hosts only");
+    }
+}
+
+void
+VoteSnapshot::write(const std::filesystem::path &path, const VoteColumns &votes, int vote_count) {
+    require_little_endian();
+    const auto source_dates = votes.date_column();
+    const auto source_users = votes.user_column();
+
+    std::vector<std::size_t> order(votes.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](auto left, auto right) {
+        return source_dates[left] < source_dates[right];
+    });
+
+    // the dictionary holds only names which voted, sorted so that a lookup is a binary search of the mapping
+    std::vector<std::uint32_t> ids(votes.table().size(), NO_ID);
+    std::vector<StringTable::Id> voters;
+    for (auto user : source_users) {
+        if (ids[user] == NO_ID) {
+            ids[user] = 0;
+            voters.push_back(user);
+        }
+    }
+    std::sort(voters.begin(), voters.end(), [&](auto left, auto right) {
+        return votes.table()[left] < votes.table()[right];
+    });
+    std::string names;
+    std::vector<std::uint32_t> name_offsets{0};
+    for (std::size_t id = 0; id < voters.size(); ++id) {
+        ids[voters[id]] = static_cast<std::uint32_t>(id);
+        names += votes.table()[voters[id]];
+        if (names.size() > std::numeric_limits<std::uint32_t>::max())
+            throw std::runtime_error("Too many usernames for a vote snapshot");
+        name_offsets.push_back(static_cast<std::uint32_t>(names.size()));
+    }
+
+    std::vector<std::int64_t> dates;
+    std::vector<std::uint32_t> users;
+    std::vector<std::uint64_t> delivered((order.size() + 63) / 64, 0);
+    dates.reserve(order.size());
+    users.reserve(order.size());
+    for (auto index : order) {
+        delivered[dates.size() / 64] |= static_cast<std::uint64_t>(votes.delivered(index)) << (dates.size() % 64);
+        dates.push_back(source_dates[index]);
+        users.push_back(ids[source_users[index]]);
+    }
+
+    // every month between the first and the last vote has an entry, so a seek is an index into the table
+    std::vector<std::uint64_t> months;
+    std::int64_t first_month = 0;
+    if (!dates.empty()) {
+        first_month = month_of(dates.front());
+        for (auto month = first_month; month <= month_of(dates.back()); ++month) {
+            auto first = std::lower_bound(dates.begin(), dates.end(), month_start(month));
+            months.push_back(static_cast<std::uint64_t>(first - dates.begin()));
+        }
+    }
+    months.push_back(dates.size());
+
+    SnapshotHeader header{};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.header_size = sizeof(header);
+    header.vote_count = dates.size();
+    header.reported_count = vote_count;
+    header.user_count = voters.size();
+    header.first_month = first_month;
+    header.month_count = months.size() - 1;
+
+    std::uint64_t offset = aligned(sizeof(header));
+    auto place = [&](Section &section, std::uint64_t size) {
+        section = {offset, size};
+        offset += aligned(size);
+    };
+    place(header.dates, dates.size() * sizeof(std::int64_t));
+    place(header.users, users.size() * sizeof(std::uint32_t));
+    place(header.delivered, delivered.size() * sizeof(std::uint64_t));
+    place(header.name_offsets, name_offsets.size() * sizeof(std::uint32_t));
+    place(header.names, names.size());
+    place(header.months, months.size() * sizeof(std::uint64_t));
+
+    static thread_local std::mt19937_64 random{std::random_device{}()};
+    auto temporary = path;
+    temporary += fmt::format(".{:016x}.tmp", random());
+    {
+        std::ofstream output(temporary, std::ios::binary | std::ios::trunc);
+        const char padding[8] = {};
+        auto put = [&](const void *data, std::uint64_t size) {
+            output.write(static_cast<const char *>(data), static_cast<std::streamsize>(size));
+            output.write(padding, static_cast<std::streamsize>(aligned(size) - size));
+        };
+        put(&header, sizeof(header));
+        put(dates.data(), header.dates.size);
+        put(users.data(), header.users.size);
+        put(delivered.data(), header.delivered.size);
+        put(name_offsets.data(), header.name_offsets.size);
+        put(names.data(), header.names.size);
+        put(months.data(), header.months.size);
+        output.close();
+        if (!output) {
+            std::error_code error;
+            std::filesystem::remove(temporary, error);
+            throw std::runtime_error(fmt::format("Failed to write vote snapshot {}", path.string()));
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary, path, error);
+    if (error) {
+        std::filesystem::remove(temporary, error);
+        throw std::runtime_error(fmt::format("Failed to write vote snapshot {}", path.string()));
+    }
+}
+
+VoteSnapshot
+VoteSnapshot::open(const std::filesystem::path &path) {
+    require_little_endian();
+    auto file = MappedFile::open(path);
+    if (!file)
+        throw std::runtime_error(fmt::format("Failed to open vote snapshot {}", path.string()));
+
+    const auto data = file->data();
+    SnapshotHeader header{};
+    if (data.size() < sizeof(header) || std::memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0)
+        throw std::runtime_error(fmt::format("{} is not a vote snapshot", path.string()));
+    std::memcpy(&header, data.data(), sizeof(header));
+    if (header.version != VERSION || header.header_size != sizeof(header))
+        throw std::runtime_error(fmt::format("Vote snapshot {} has version {}, version {} is supported", path.string(),
+                                             header.version, VERSION));
+
+    // only the bounds are checked, the columns are used as they are mapped
+    auto column = [&](const Section &section, std::size_t element, std::uint64_t count) {
+        if (section.offset % 8 != 0 || section.offset > data.size() || section.size > data.size() - section.offset
+            || count > data.size() / element || section.size != count * element)
+            throw std::runtime_error(fmt::format("Vote snapshot {} is damaged", path.string()));
+        return data.data() + section.offset;
+    };
+
+    VoteSnapshot snapshot;
+    const auto count = static_cast<std::size_t>(header.vote_count);
+    snapshot.dates = {reinterpret_cast<const std::int64_t *>(column(header.dates, sizeof(std::int64_t), count)), count};
+    snapshot.users = {reinterpret_cast<const std::uint32_t *>(column(header.users, sizeof(std::uint32_t), count)), count};
+    const auto words = (count + 63) / 64;
+    snapshot.delivered_bits = {reinterpret_cast<const std::uint64_t *>(column(header.delivered, sizeof(std::uint64_t), words)), words};
+    const auto offsets = static_cast<std::size_t>(header.user_count) + 1;
+    snapshot.name_offsets = {reinterpret_cast<const std::uint32_t *>(column(header.name_offsets, sizeof(std::uint32_t), offsets)), offsets};
+    snapshot.names = {column(header.names, 1, header.names.size), static_cast<std::size_t>(header.names.size)};
+    const auto months = static_cast<std::size_t>(header.month_count) + 1;
+    snapshot.months = {reinterpret_cast<const std::uint64_t *>(column(header.months, sizeof(std::uint64_t), months)), months};
+    if (snapshot.name_offsets.back() > snapshot.names.size() || snapshot.months.back() != count)
+        throw std::runtime_error(fmt::format("Vote snapshot {} is damaged", path.string()));
+
+    snapshot.vote_count = static_cast<int>(header.reported_count);
+    snapshot.first_month = header.first_month;
+    snapshot.file = std::move(*file); // the mapping stays where it is, so the spans remain valid
+    return snapshot;
+}
+
+std::string_view
+VoteSnapshot::username(std::uint32_t id) const {
+    if (id >= users_size())
+        throw std::out_of_range(fmt::format("Vote snapshot has no username {}", id));
+    const auto begin = name_offsets[id], end = name_offsets[id + 1];
+    if (begin > end || end > names.size())
+        throw std::out_of_range(fmt::format("Vote snapshot has a damaged username {}", id));
+    return names.substr(begin, end - begin);
+}
+
+std::optional<std::uint32_t>
+VoteSnapshot::find(std::string_view username) const {
+    std::uint32_t low = 0, high = static_cast<std::uint32_t>(users_size());
+    while (low < high) {
+        auto middle = low + (high - low) / 2;
+        if (this->username(middle) < username)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    if (low < users_size() && this->username(low) == username)
+        return low;
+    return std::nullopt;
+}
+
+Vote
+VoteSnapshot::operator[](std::size_t index) const {
+    if (index >= size())
+        throw std::out_of_range(fmt::format("Vote snapshot has no vote {}", index));
+    return Vote{username(users[index]), dates[index], delivered(index)};
+}
+
+std::pair<std::size_t, std::size_t>
+VoteSnapshot::range(YearMonth from, YearMonth to) const {
+    if (from > to)
+        return {0, 0};
+    const auto last = static_cast<std::int64_t>(months.size() - 1);
+    auto seek = [&](YearMonth month) {
+        auto index = month.year * std::int64_t{12} + month.month - 1 - first_month;
+        return static_cast<std::size_t>(months[static_cast<std::size_t>(std::clamp<std::int64_t>(index, 0, last))]);
+    };
+    return {seek(from), seek(to.next())};
+}
+
+VoteColumns
+VoteSnapshot::votes(std::size_t first, std::size_t last) const {
+    last = std::min(last, size());
+    first = std::min(first, last);
+
+    // every name is interned once, not once per vote
+    VoteColumns columns;
+    std::vector<StringTable::Id> interned(users_size(), NO_ID);
+    columns.reserve(last - first);
+    for (auto index = first; index < last; ++index) {
+        auto user = users[index];
+        if (user >= interned.size())
+            throw std::out_of_range(fmt::format("Vote snapshot has no username {}", user));
+        if (interned[user] == NO_ID)
+            interned[user] = columns.shared_table()->intern(username(user));
+        columns.push_back(interned[user], dates[index], delivered(index));
+    }
+    return columns;
+}
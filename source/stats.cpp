@@ -0,0 +1,225 @@
+#include "stats.hpp"
+#include "parallel.hpp"
+#include "timefmt.hpp"
+
+#include <algorithm>
+#include <thread>
+
+using namespace ccapi;
+
+static constexpr std::int64_t DAY = 86400;
+
+// votes are bucketed in blocks small enough for the scratch arrays to stay in L1
+static constexpr std::size_t BLOCK = 512;
+
+static std::int64_t day_of(std::int64_t epoch) {
+    return (epoch >= 0 ? epoch : epoch - (DAY - 1)) / DAY;
+}
+
+static void add_day(VoteHistogram &histogram, std::int64_t day, std::uint64_t count) {
+    auto tm = fromEpoch(day * DAY);
+    histogram.weekdays[(tm.tm_wday + 6) % 7] += count;
+    histogram.days[tm.tm_mday - 1] += count;
+}
+
+// fallback for listings spanning more than 136 years, which do not fit the 32-bit offsets
+static VoteHistogram histogram_scalar(VoteSpan votes, std::int64_t from, std::int64_t to) {
+    VoteHistogram histogram;
+    const auto dates = votes.date_column();
+    for (std::size_t index = 0; index < dates.size(); ++index) {
+        const auto date = dates[index];
+        if (date < from || date >= to)
+            continue;
+        auto tm = fromEpoch(date);
+        ++histogram.hours[tm.tm_hour];
+        ++histogram.weekdays[(tm.tm_wday + 6) % 7];
+        ++histogram.days[tm.tm_mday - 1];
+        ++histogram.total;
+        histogram.delivered += votes.delivered(index);
+        histogram.first = std::min(histogram.first, date);
+        histogram.last = std::max(histogram.last, date);
+    }
+    return histogram;
+}
+
+static VoteHistogram histogram_of(VoteSpan votes, std::int64_t from, std::int64_t to) {
+    VoteHistogram histogram;
+    const auto dates = votes.date_column();
+    if (dates.empty())
+        return histogram;
+
+    auto low = dates[0], high = dates[0];
+    for (auto date : dates) {
+        low = std::min(low, date);
+        high = std::max(high, date);
+    }
+    const auto base_day = day_of(low);
+    const auto base = base_day * DAY;
+    if (static_cast<std::uint64_t>(high - base) >= UINT32_MAX)
+        return histogram_scalar(votes, from, to);
+
+    // the range as offsets from the base, so that the whole kernel works on 32-bit lanes
+    const auto clamp_offset = [&](std::int64_t date) {
+        return date > high ? static_cast<std::uint32_t>(high - base) + 1
+                           : static_cast<std::uint32_t>(std::max(date, base) - base);
+    };
+    const auto range_start = clamp_offset(from);
+    const auto range_size = clamp_offset(to) - std::min(range_start, clamp_offset(to));
+    const bool unfiltered = low >= from && high < to;
+
+    // per-vote work is only the offset arithmetic, days are resolved to the calendar once each
+    std::vector<std::uint64_t> per_day(static_cast<std::size_t>((high - base) / DAY + 1));
+    std::uint64_t hours[4][24] = {}; // interleaved copies, consecutive votes of one hour do not wait on each other
+    std::uint32_t offsets[BLOCK];
+    std::uint32_t day_index[BLOCK];
+    std::uint8_t hour_index[BLOCK];
+    std::uint8_t weight[BLOCK];
+    std::fill(std::begin(weight), std::end(weight), 1);
+
+    for (std::size_t start = 0; start < dates.size(); start += BLOCK) {
+        const auto count = std::min(BLOCK, dates.size() - start);
+        const auto block = dates.data() + start;
+        for (std::size_t index = 0; index < count; ++index)
+            offsets[index] = static_cast<std::uint32_t>(block[index] - base);
+        for (std::size_t index = 0; index < count; ++index) {
+            day_index[index] = offsets[index] / static_cast<std::uint32_t>(DAY);
+            hour_index[index] = static_cast<std::uint8_t>(offsets[index] % static_cast<std::uint32_t>(DAY) / 3600);
+        }
+        if (!unfiltered) {
+            for (std::size_t index = 0; index < count; ++index)
+                weight[index] = static_cast<std::uint8_t>(offsets[index] - range_start < range_size);
+            for (std::size_t index = 0; index < count; ++index)
+                histogram.delivered += weight[index] & static_cast<std::uint8_t>(votes.delivered(start + index));
+        }
+        for (std::size_t index = 0; index < count; ++index) {
+            per_day[day_index[index]] += weight[index];
+            hours[index % 4][hour_index[index]] += weight[index];
+        }
+    }
+
+    for (std::size_t hour = 0; hour < 24; ++hour)
+        histogram.hours[hour] = hours[0][hour] + hours[1][hour] + hours[2][hour] + hours[3][hour];
+    for (std::size_t day = 0; day < per_day.size(); ++day) {
+        if (per_day[day]) {
+            add_day(histogram, base_day + static_cast<std::int64_t>(day), per_day[day]);
+            histogram.total += per_day[day];
+        }
+    }
+
+    if (unfiltered) {
+        histogram.delivered = votes.delivered_count();
+        histogram.first = low;
+        histogram.last = high;
+    } else {
+        for (auto date : dates) {
+            const bool included = date >= from && date < to;
+            histogram.first = std::min(histogram.first, included ? date : histogram.first);
+            histogram.last = std::max(histogram.last, included ? date : histogram.last);
+        }
+    }
+    return histogram;
+}
+
+void
+VoteHistogram::merge(const VoteHistogram &other) {
+    for (std::size_t index = 0; index < hours.size(); ++index)
+        hours[index] += other.hours[index];
+    for (std::size_t index = 0; index < weekdays.size(); ++index)
+        weekdays[index] += other.weekdays[index];
+    for (std::size_t index = 0; index < days.size(); ++index)
+        days[index] += other.days[index];
+    total += other.total;
+    delivered += other.delivered;
+    first = std::min(first, other.first);
+    last = std::max(last, other.last);
+}
+
+VoteHistogram
+ccapi::voteHistogram(VoteSpan votes, std::int64_t from, std::int64_t to, unsigned threads) {
+    threads = detail::voteThreads(votes.size(), threads);
+    if (threads == 1)
+        return histogram_of(votes, from, to);
+
+    std::vector<VoteHistogram> partials(threads);
+    std::vector<std::thread> workers;
+    const auto chunk = (votes.size() + threads - 1) / threads;
+    for (unsigned index = 0; index < threads; ++index) {
+        workers.emplace_back([&, index] {
+            partials[index] = histogram_of(votes.subspan(index * chunk, chunk), from, to);
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+
+    for (unsigned index = 1; index < threads; ++index)
+        partials.front().merge(partials[index]);
+    return partials.front();
+}
+
+std::vector<VoteStreak>
+ccapi::voteStreaks(VoteSpan votes, std::int64_t from, std::int64_t to) {
+    const auto dates = votes.date_column();
+    const auto users = votes.user_column();
+
+    // ids are dense, so the state of every user is a plain array slot
+    std::vector<VoteStreak> streaks(votes.table().size());
+    std::vector<std::int64_t> last_day(streaks.size());
+    std::vector<std::uint32_t> run(streaks.size());
+    auto final_day = std::numeric_limits<std::int64_t>::min();
+
+    auto visit = [&](StringTable::Id user, std::int64_t date) {
+        if (date < from || date >= to)
+            return;
+        const auto day = day_of(date);
+        auto &streak = streaks[user];
+        if (streak.days && day == last_day[user])
+            return;
+        run[user] = streak.days && day == last_day[user] + 1 ? run[user] + 1 : 1;
+        last_day[user] = day;
+        ++streak.days;
+        if (run[user] > streak.longest) {
+            streak.longest = run[user];
+            streak.longest_end = day * DAY;
+        }
+        final_day = std::max(final_day, day);
+    };
+
+    bool ascending = true, descending = true;
+    for (std::size_t index = 1; index < dates.size(); ++index) {
+        ascending &= dates[index - 1] <= dates[index];
+        descending &= dates[index - 1] >= dates[index];
+    }
+    if (ascending) {
+        for (std::size_t index = 0; index < dates.size(); ++index)
+            visit(users[index], dates[index]);
+    } else if (descending) {
+        for (auto index = dates.size(); index-- > 0;)
+            visit(users[index], dates[index]);
+    } else {
+        std::vector<std::pair<std::int64_t, StringTable::Id>> ordered;
+        ordered.reserve(dates.size());
+        for (std::size_t index = 0; index < dates.size(); ++index)
+            ordered.emplace_back(dates[index], users[index]);
+        std::sort(ordered.begin(), ordered.end());
+        for (const auto &[date, user] : ordered)
+            visit(user, date);
+    }
+
+    std::vector<VoteStreak> result;
+    for (std::size_t user = 0; user < streaks.size(); ++user) {
+        auto &streak = streaks[user];
+        if (!streak.days)
+            continue;
+        streak.user = static_cast<StringTable::Id>(user);
+        streak.current = last_day[user] >= final_day - 1 ? run[user] : 0;
+        result.push_back(streak);
+    }
+    std::sort(result.begin(), result.end(), [](const VoteStreak &left, const VoteStreak &right) {
+        if (left.longest != right.longest)
+            return left.longest > right.longest;
+        if (left.days != right.days)
+            return left.days > right.days;
+        return left.user < right.user;
+    });
+    return result;
+}
@@ -0,0 +1,155 @@
+#include "timefmt.hpp"
+
+#include <chrono>
+#include <cstring>
+
+using namespace ccapi;
+
+static constexpr char DIGIT_PAIRS[] =
+        "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+        "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+        "8081828384858687888990919293949596979899";
+
+static void write_pair(char *out, unsigned value) {
+    std::memcpy(out, DIGIT_PAIRS + value * 2, 2);
+}
+
+static std::uint64_t load_word(const char *data) {
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    return word;
+}
+
+static unsigned days_in_month(std::int64_t year, unsigned month) {
+    const auto next = month == 12 ? daysFromCivil(year + 1, 1, 1) : daysFromCivil(year, month + 1, 1);
+    return static_cast<unsigned>(next - daysFromCivil(year, month, 1));
+}
+
+std::optional<std::int64_t>
+ccapi::parseTime(std::string_view text) {
+    if (text.size() != TIME_LENGTH)
+        return std::nullopt;
+
+    // Validates sixteen characters at once, eight per word. XOR with the template turns digits into
+    // their values and correct separators into zero, so every byte then has to be at most 9.
+    // Byte order of the words does not matter as long as the template is loaded the same way.
+    static constexpr char TEMPLATE[] = "0000-00-00 00:00:00";
+    static constexpr char SEPARATORS[] = "\0\0\0\0\xff\0\0\xff\0\0\xff\0\0\xff\0\0";
+    constexpr std::uint64_t HIGH = 0x8080808080808080ull;
+    constexpr std::uint64_t ABOVE_NINE = 0x7676767676767676ull;
+
+    std::uint8_t digits[TIME_LENGTH];
+    for (std::size_t offset = 0; offset < 16; offset += 8) {
+        auto value = load_word(text.data() + offset) ^ load_word(TEMPLATE + offset);
+        if (((value | (value + ABOVE_NINE)) & HIGH) || (value & load_word(SEPARATORS + offset)))
+            return std::nullopt;
+        std::memcpy(digits + offset, &value, sizeof(value));
+    }
+    if (text[16] != ':')
+        return std::nullopt;
+    for (std::size_t offset = 17; offset < TIME_LENGTH; ++offset) {
+        digits[offset] = static_cast<std::uint8_t>(text[offset] - '0');
+        if (digits[offset] > 9)
+            return std::nullopt;
+    }
+
+    auto pair = [&](std::size_t offset) { return static_cast<unsigned>(digits[offset] * 10 + digits[offset + 1]); };
+    const unsigned year = pair(0) * 100 + pair(2);
+    const unsigned month = pair(5);
+    const unsigned day = pair(8);
+    const unsigned hour = pair(11);
+    const unsigned minute = pair(14);
+    const unsigned second = pair(17);
+    if (month < 1 || month > 12 || day < 1 || day > days_in_month(year, month) || hour > 23 || minute > 59 || second > 60)
+        return std::nullopt;
+
+    return daysFromCivil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+}
+
+std::string_view
+ccapi::formatTime(std::int64_t epoch, char *out) {
+    const auto tm = fromEpoch(epoch);
+    const auto year = static_cast<unsigned>(tm.tm_year + 1900);
+
+    write_pair(out, year / 100 % 100);
+    write_pair(out + 2, year % 100);
+    out[4] = '-';
+    write_pair(out + 5, tm.tm_mon + 1);
+    out[7] = '-';
+    write_pair(out + 8, tm.tm_mday);
+    out[10] = ' ';
+    write_pair(out + 11, tm.tm_hour);
+    out[13] = ':';
+    write_pair(out + 14, tm.tm_min);
+    out[16] = ':';
+    write_pair(out + 17, tm.tm_sec);
+    return {out, TIME_LENGTH};
+}
+
+std::int64_t
+ccapi::toEpoch(const std::tm &tm) {
+    return daysFromCivil(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday) * 86400
+           + tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec;
+}
+
+std::tm
+ccapi::fromEpoch(std::int64_t epoch) {
+    auto days = epoch / 86400;
+    auto seconds = epoch % 86400;
+    if (seconds < 0) {
+        seconds += 86400;
+        --days;
+    }
+
+    const auto weekday = static_cast<int>((days % 7 + 11) % 7); // 1970-01-01 was a thursday
+
+    // inverse of daysFromCivil
+    days += 719468;
+    const std::int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const auto doe = static_cast<unsigned>(days - era * 146097);
+    const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    const unsigned mp = (5 * doy + 2) / 153;
+    const unsigned day = doy - (153 * mp + 2) / 5 + 1;
+    const unsigned month = mp < 10 ? mp + 3 : mp - 9;
+    const std::int64_t year = static_cast<std::int64_t>(yoe) + era * 400 + (month <= 2);
+
+    std::tm tm{};
+    tm.tm_year = static_cast<int>(year - 1900);
+    tm.tm_mon = static_cast<int>(month - 1);
+    tm.tm_mday = static_cast<int>(day);
+    tm.tm_hour = static_cast<int>(seconds / 3600);
+    tm.tm_min = static_cast<int>(seconds / 60 % 60);
+    tm.tm_sec = static_cast<int>(seconds % 60);
+    tm.tm_yday = static_cast<int>(daysFromCivil(year, month, day) - daysFromCivil(year, 1, 1));
+    tm.tm_wday = weekday;
+    return tm;
+}
+
+// days since the epoch of the last sunday of a month with 31 days
+static std::int64_t last_sunday(std::int64_t year, unsigned month) {
+    const auto last = daysFromCivil(year, month, 31);
+    return last - (last % 7 + 11) % 7;
+}
+
+// summer time starts on the last sunday of march and ends on the last sunday of october, both at 01:00 UTC
+static bool summer_time(std::int64_t epoch) {
+    const auto year = static_cast<std::int64_t>(fromEpoch(epoch).tm_year) + 1900;
+    return epoch >= last_sunday(year, 3) * 86400 + 3600 && epoch < last_sunday(year, 10) * 86400 + 3600;
+}
+
+std::int64_t
+ccapi::toApiTime(std::int64_t epoch) {
+    return epoch + (summer_time(epoch) ? 7200 : 3600);
+}
+
+std::int64_t
+ccapi::fromApiTime(std::int64_t time) {
+    return summer_time(time - 7200) ? time - 7200 : time - 3600;
+}
+
+std::int64_t
+ccapi::apiNow() {
+    return toApiTime(std::chrono::duration_cast<std::chrono::seconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+}
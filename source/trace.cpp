@@ -0,0 +1,181 @@
+#include "trace.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+
+#include <fmt/format.h>
+#include <nlohmann/json.hpp>
+
+using namespace ccapi;
+
+static std::chrono::microseconds info_time(CURL *handle, CURLINFO info) {
+    curl_off_t value = 0;
+    curl_easy_getinfo(handle, info, &value);
+    return std::chrono::microseconds(value);
+}
+
+static double milliseconds(std::chrono::nanoseconds duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+static const char *source_name(Tracer::Source source) {
+    switch (source) {
+        case Tracer::Source::network:
+            return "network";
+        case Tracer::Source::not_modified:
+            return "304";
+        default:
+            return "cache";
+    }
+}
+
+std::uint32_t
+Tracer::lane() {
+    std::lock_guard guard(lock);
+    return ++lanes;
+}
+
+void
+Tracer::record(Request request) {
+    std::lock_guard guard(lock);
+    requests.push_back(std::move(request));
+}
+
+void
+Tracer::record(Span span) {
+    std::lock_guard guard(lock);
+    spans.push_back(std::move(span));
+}
+
+void
+Tracer::measure(CURL *handle, Request &request) {
+    // CURL reports every point as time elapsed since the start of the transfer
+    const auto lookup = info_time(handle, CURLINFO_NAMELOOKUP_TIME_T);
+    const auto connect = info_time(handle, CURLINFO_CONNECT_TIME_T);
+    const auto app_connect = info_time(handle, CURLINFO_APPCONNECT_TIME_T);
+    const auto pre_transfer = info_time(handle, CURLINFO_PRETRANSFER_TIME_T);
+    const auto start_transfer = info_time(handle, CURLINFO_STARTTRANSFER_TIME_T);
+    const auto total = info_time(handle, CURLINFO_TOTAL_TIME_T);
+
+    const std::chrono::microseconds zero{};
+    request.dns = lookup;
+    request.connect = std::max(connect - lookup, zero);
+    request.tls = app_connect > zero ? std::max(app_connect - connect, zero) : zero;
+    request.wait = std::max(start_transfer - pre_transfer, zero);
+    request.transfer = std::max(total - start_transfer, zero);
+    request.total = total;
+
+    curl_off_t bytes = 0;
+    curl_easy_getinfo(handle, CURLINFO_SIZE_DOWNLOAD_T, &bytes);
+    request.bytes = bytes;
+
+    long connects = 0, version = 0;
+    curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+    curl_easy_getinfo(handle, CURLINFO_HTTP_VERSION, &version);
+    request.connects = connects;
+    request.http2 = version == CURL_HTTP_VERSION_2_0;
+}
+
+Tracer::Totals
+Tracer::totals() const {
+    std::lock_guard guard(lock);
+    Totals totals;
+    for (const auto &request : requests) {
+        if (request.source == Source::cache)
+            continue;
+        ++totals.requests;
+        totals.http2 += request.http2;
+        totals.connections += static_cast<std::size_t>(request.connects);
+        totals.bytes += request.bytes;
+    }
+    return totals;
+}
+
+void
+Tracer::writeStats(std::FILE *out) const {
+    std::lock_guard guard(lock);
+
+    std::size_t width = 7;
+    for (const auto &request : requests)
+        width = std::max(width, request.context.size());
+    for (const auto &span : spans)
+        width = std::max(width, span.name.size());
+
+    auto sorted = requests;
+    std::sort(sorted.begin(), sorted.end(), [](const auto &left, const auto &right) { return left.start < right.start; });
+
+    fmt::print(out, "{:<{}}  {:>7}  {:>8}  {:>8}  {:>8}  {:>8}  {:>8}  {:>8}  {:>8}  {:>10}\n", "request", width,
+               "source", "dns", "connect", "tls", "wait", "transfer", "parse", "total", "bytes");
+    for (const auto &request : sorted) {
+        fmt::print(out, "{:<{}}  {:>7}  {:>8.2f}  {:>8.2f}  {:>8.2f}  {:>8.2f}  {:>8.2f}  {:>8.2f}  {:>8.2f}  {:>10}\n",
+                   request.context, width, source_name(request.source), milliseconds(request.dns),
+                   milliseconds(request.connect), milliseconds(request.tls), milliseconds(request.wait),
+                   milliseconds(request.transfer), milliseconds(request.parse),
+                   milliseconds(request.streamed ? request.total : request.total + request.parse), request.bytes);
+    }
+    std::size_t connections = 0, http2 = 0;
+    for (const auto &request : requests) {
+        connections += static_cast<std::size_t>(request.connects);
+        http2 += request.http2;
+    }
+    fmt::print(out, "{} requests, {} over HTTP/2, {} connections opened\n", requests.size(), http2, connections);
+
+    if (spans.empty())
+        return;
+    fmt::print(out, "\n{:<{}}  {:>8}  {:>8}\n", "phase", width, "category", "time");
+    for (const auto &span : spans)
+        fmt::print(out, "{:<{}}  {:>8}  {:>8.2f}\n", span.name, width, span.category, milliseconds(span.end - span.start));
+    fmt::print(out, "(times in milliseconds)\n");
+}
+
+void
+Tracer::writeTrace(const std::string &path) const {
+    std::lock_guard guard(lock);
+
+    auto timestamp = [this](clock_type::time_point point) {
+        return std::chrono::duration<double, std::micro>(point - origin).count();
+    };
+    auto events = nlohmann::json::array();
+    auto event = [&](std::string_view name, std::string_view category, double start, double duration,
+                     std::uint32_t lane) -> nlohmann::json & {
+        return events.emplace_back(nlohmann::json{
+                {"name", std::string(name)}, {"cat", std::string(category)}, {"ph", "X"}, {"ts", start}, {"dur", duration}, {"pid", 1}, {"tid", lane}
+        });
+    };
+
+    for (const auto &request : requests) {
+        auto start = timestamp(request.start);
+        const auto parse = std::chrono::duration<double, std::micro>(request.parse).count();
+        const auto length = static_cast<double>(request.total.count()) + (request.streamed ? 0 : parse);
+        event(request.context, "request", start, length, request.lane)["args"] = {
+                {"source", source_name(request.source)}, {"bytes", request.bytes}, {"connects", request.connects},
+                {"http2", request.http2}, {"streamed", request.streamed}
+        };
+
+        // connection phases start the transfer, waiting for the response and receiving it end it
+        auto offset = start;
+        for (auto [name, duration] : {std::pair{"dns", request.dns}, {"connect", request.connect}, {"tls", request.tls}}) {
+            if (duration.count())
+                event(name, "network", offset, static_cast<double>(duration.count()), request.lane);
+            offset += static_cast<double>(duration.count());
+        }
+        offset = start + static_cast<double>((request.total - request.transfer - request.wait).count());
+        const auto response = offset + static_cast<double>(request.wait.count());
+        for (auto [name, duration] : {std::pair{"wait", request.wait}, {"transfer", request.transfer}}) {
+            if (duration.count())
+                event(name, "network", offset, static_cast<double>(duration.count()), request.lane);
+            offset += static_cast<double>(duration.count());
+        }
+        // streamed responses are parsed while they arrive, their parse time is shown summed up from the first byte
+        if (request.parse.count())
+            event("parse", "parse", request.streamed ? response : offset, parse, request.lane);
+    }
+    for (const auto &span : spans)
+        event(span.name, span.category, timestamp(span.start), timestamp(span.end) - timestamp(span.start), span.lane);
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << nlohmann::json{{"traceEvents", events}, {"displayTimeUnit", "ms"}}.dump();
+    if (!file)
+        throw std::runtime_error(fmt::format("Failed to write trace file {}", path));
+}
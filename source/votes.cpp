@@ -0,0 +1,107 @@
+#include "votes.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+using namespace ccapi;
+
+StringTable::Id
+StringTable::intern(std::string_view value) {
+    auto found = index.find(value);
+    if (found != index.end())
+        return found->second;
+
+    auto id = static_cast<Id>(strings.size());
+    std::string_view stored;
+    if (!value.empty()) {
+        auto characters = static_cast<char *>(arena.allocate(value.size(), 1));
+        std::memcpy(characters, value.data(), value.size());
+        stored = {characters, value.size()};
+    }
+    index.emplace(strings.emplace_back(stored), id);
+    return id;
+}
+
+std::optional<StringTable::Id>
+StringTable::find(std::string_view value) const {
+    auto found = index.find(value);
+    if (found == index.end())
+        return std::nullopt;
+    return found->second;
+}
+
+void
+VoteColumns::append(const VoteColumns &other) {
+    reserve(size() + other.size());
+
+    if (names == other.names) {
+        for (std::size_t index = 0; index < other.size(); ++index)
+            push_back(other.users[index], other.dates[index], other.delivered(index));
+        return;
+    }
+
+    // translate every id of the other table once
+    std::vector<StringTable::Id> translated(other.names->size(), UINT32_MAX);
+    for (std::size_t index = 0; index < other.size(); ++index) {
+        auto &id = translated[other.users[index]];
+        if (id == UINT32_MAX)
+            id = names->intern((*other.names)[other.users[index]]);
+        push_back(id, other.dates[index], other.delivered(index));
+    }
+}
+
+VoteColumns
+VoteColumns::clone() const {
+    // strings are interned in the order of their ids, so the ids stay the same
+    auto table = std::make_shared<StringTable>();
+    for (StringTable::Id id = 0; id < names->size(); ++id)
+        table->intern((*names)[id]);
+    VoteColumns copy(std::move(table));
+    copy.dates = dates;
+    copy.users = users;
+    copy.delivered_bits = delivered_bits;
+    return copy;
+}
+
+void
+VoteColumns::reserve(std::size_t count) {
+    dates.reserve(count);
+    users.reserve(count);
+    delivered_bits.reserve((count + 63) / 64);
+}
+
+void
+VoteColumns::reverse() {
+    std::reverse(dates.begin(), dates.end());
+    std::reverse(users.begin(), users.end());
+
+    std::vector<std::uint64_t> reversed(delivered_bits.size(), 0);
+    for (std::size_t index = 0, last = size() - 1; index < size(); ++index)
+        reversed[(last - index) / 64] |= static_cast<std::uint64_t>(delivered(index)) << ((last - index) % 64);
+    delivered_bits = std::move(reversed);
+}
+
+void
+VoteColumns::clear() {
+    dates.clear();
+    users.clear();
+    delivered_bits.clear();
+}
+
+std::size_t
+VoteColumns::count_delivered(std::size_t offset, std::size_t count) const {
+    if (count == 0)
+        return 0;
+
+    const auto first = offset / 64, last = (offset + count - 1) / 64;
+    const auto head = ~std::uint64_t{0} << (offset % 64);
+    const auto tail = ~std::uint64_t{0} >> (63 - (offset + count - 1) % 64);
+    if (first == last)
+        return static_cast<std::size_t>(std::popcount(delivered_bits[first] & head & tail));
+
+    std::size_t delivered = std::popcount(delivered_bits[first] & head) + std::popcount(delivered_bits[last] & tail);
+    for (auto word = first + 1; word < last; ++word)
+        delivered += std::popcount(delivered_bits[word]);
+    return delivered;
+}
@@ -0,0 +1,133 @@
+#include "watch.hpp"
+#include "ccapi.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+#include <unordered_map>
+
+using namespace ccapi;
+
+std::vector<RankChange>
+ccapi::diffLeaderboards(const std::list<VoterInfo> &before, const std::list<VoterInfo> &after) {
+    struct Previous {
+        std::size_t rank;
+        int votes;
+        bool present = false; // still on the current leaderboard
+    };
+    std::unordered_map<std::string_view, Previous> previous;
+    previous.reserve(before.size());
+    std::size_t rank = 0;
+    for (const auto &voter : before)
+        previous.try_emplace(voter.username, Previous{++rank, voter.vote_count});
+
+    // previous ranks of the remaining voters in their current order, and where each of them is
+    std::vector<std::size_t> sequence;
+    std::vector<std::size_t> positions;
+    rank = 0;
+    for (const auto &voter : after) {
+        ++rank;
+        auto found = previous.find(voter.username);
+        if (found == previous.end())
+            continue;
+        found->second.present = true;
+        sequence.push_back(found->second.rank);
+        positions.push_back(rank);
+    }
+
+    // longest increasing subsequence by patience sorting, its voters kept their order among themselves
+    std::vector<std::size_t> tails, tail_index, parent(sequence.size(), SIZE_MAX);
+    for (std::size_t index = 0; index < sequence.size(); ++index) {
+        auto pile = static_cast<std::size_t>(std::lower_bound(tails.begin(), tails.end(), sequence[index]) - tails.begin());
+        if (pile > 0)
+            parent[index] = tail_index[pile - 1];
+        if (pile == tails.size()) {
+            tails.push_back(sequence[index]);
+            tail_index.push_back(index);
+        } else {
+            tails[pile] = sequence[index];
+            tail_index[pile] = index;
+        }
+    }
+    std::vector<bool> kept(sequence.size(), false);
+    for (auto index = tail_index.empty() ? SIZE_MAX : tail_index.back(); index != SIZE_MAX; index = parent[index])
+        kept[index] = true;
+
+    std::vector<RankChange> changes;
+    rank = 0;
+    for (const auto &voter : before) {
+        ++rank;
+        auto found = previous.find(voter.username);
+        if (!found->second.present && found->second.rank == rank)
+            changes.push_back({RankChange::Kind::left, voter.username, rank, 0, voter.vote_count});
+    }
+    rank = 0;
+    std::size_t matched = 0;
+    for (const auto &voter : after) {
+        ++rank;
+        if (matched < positions.size() && positions[matched] == rank) {
+            if (!kept[matched])
+                changes.push_back({RankChange::Kind::moved, voter.username, sequence[matched], rank, voter.vote_count});
+            ++matched;
+        } else {
+            changes.push_back({RankChange::Kind::entered, voter.username, 0, rank, voter.vote_count});
+        }
+    }
+    return changes;
+}
+
+TimerWheel::TimerWheel(std::int64_t now, std::size_t slots) : slots(std::max<std::size_t>(1, slots)), current(now) {}
+
+void
+TimerWheel::schedule(Id id, std::int64_t when) {
+    // a deadline already passed fires on the next advance
+    when = std::max(when, current + 1);
+    slot(when).push_back(Timer{id, when});
+    ++count;
+}
+
+std::vector<TimerWheel::Id>
+TimerWheel::advance(std::int64_t now) {
+    std::vector<Timer> due;
+    // a jump over a whole revolution visits every slot once
+    const auto last = std::min(now, current + static_cast<std::int64_t>(slots.size()));
+    for (auto second = current + 1; second <= last; ++second) {
+        auto &timers = slot(second);
+        auto remaining = std::partition(timers.begin(), timers.end(), [&](const Timer &timer) { return timer.when > now; });
+        due.insert(due.end(), remaining, timers.end());
+        timers.erase(remaining, timers.end());
+    }
+    current = std::max(current, now);
+    count -= due.size();
+
+    std::stable_sort(due.begin(), due.end(), [](const Timer &left, const Timer &right) { return left.when < right.when; });
+    std::vector<Id> ids;
+    ids.reserve(due.size());
+    for (const auto &timer : due)
+        ids.push_back(timer.id);
+    return ids;
+}
+
+std::optional<std::int64_t>
+TimerWheel::next() const {
+    if (count == 0)
+        return std::nullopt;
+
+    // within the coming revolution the first slot with a deadline of this round has the earliest one
+    const auto size = static_cast<std::int64_t>(slots.size());
+    for (auto second = current + 1; second <= current + size; ++second) {
+        for (const auto &timer : slots[static_cast<std::size_t>(second % size)]) {
+            if (timer.when == second)
+                return second;
+        }
+    }
+
+    // everything is further away, which only happens with few timers
+    auto earliest = std::numeric_limits<std::int64_t>::max();
+    for (const auto &timers : slots) {
+        for (const auto &timer : timers)
+            earliest = std::min(earliest, timer.when);
+    }
+    return earliest;
+}